@@ -0,0 +1,458 @@
+﻿// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QTextStream>
+#include <QDir>
+#include <QJsonDocument>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <version.h>
+#include "Cleaner.h"
+#include "ReportWatcher.h"
+
+#include <stdexcept>
+#include <regex>
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * \brief Clean every file matched by \a patterns into \a outputDirectory, and print a summary of each
+ */
+static int runBatch(const QStringList& patterns, const QString& outputDirectory, const SARIF::FilterProfile& profile, unsigned int jobs)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    QStringList infiles;
+    for (const auto& pattern : patterns)
+        infiles.append(Cleaner::ExpandBatchInputs(pattern));
+    if (infiles.isEmpty()) {
+        err << "No SARIF files matched" << Qt::endl;
+        return 1;
+    }
+    if (!QDir().mkpath(outputDirectory)) {
+        err << "Could not create the output directory " << outputDirectory << Qt::endl;
+        return 1;
+    }
+
+    Cleaner::BatchSummary summary;
+    try {
+        summary = Cleaner::CleanBatch(infiles, outputDirectory, profile, jobs);
+    }
+    catch (const std::runtime_error& e) {
+        err << e.what() << Qt::endl;
+        return 2;
+    }
+    for (const auto& file : summary.files) {
+        if (file.error.isEmpty())
+            out << file.infile << ": " << file.statistics.resultsWritten << "/" << file.statistics.resultsRead << " results, "
+                << QString::number(file.seconds * 1000.0, 'f', 1) << " ms" << Qt::endl;
+        else
+            out << file.infile << ": FAILED: " << file.error << Qt::endl;
+    }
+    out << summary.files.size() << " files (" << summary.failures << " failed), "
+        << QString::number(static_cast<double>(summary.bytesRead) / (1024.0 * 1024.0), 'f', 1) << " MB in "
+        << QString::number(summary.seconds, 'f', 2) << " s: "
+        << QString::number(summary.MegabytesPerSecond(), 'f', 1) << " MB/s" << Qt::endl;
+    return summary.failures == 0 ? 0 : 1;
+}
+
+/**
+ * \brief Merge every file matched by \a patterns into \a outfile, or standard output if it is -
+ */
+static int runMerge(const QStringList& patterns, const QString& outfile, const SARIF::FilterProfile& profile, bool stats)
+{
+    QTextStream err(stderr);
+    // The output may match one of the patterns when it is written next to the inputs, but it is never an input
+    const QString outputPath = outfile == "-" ? QString() : QFileInfo(outfile).absoluteFilePath();
+    QStringList infiles;
+    for (const auto& pattern : patterns) {
+        for (const auto& infile : Cleaner::ExpandBatchInputs(pattern)) {
+            if (QFileInfo(infile).absoluteFilePath() != outputPath)
+                infiles.append(infile);
+        }
+    }
+    if (infiles.isEmpty()) {
+        err << "No SARIF files matched" << Qt::endl;
+        return 1;
+    }
+
+    // A file is only replaced once the merge has succeeded
+    QFile standardOutput;
+    QSaveFile fileOutput(outfile);
+    QFileDevice& output = outfile == "-" ? static_cast<QFileDevice&>(standardOutput) : fileOutput;
+    const bool opened = outfile == "-" ? standardOutput.open(stdout, QIODevice::WriteOnly) : fileOutput.open(QIODevice::WriteOnly);
+    if (!opened) {
+        err << "Could not write " << outfile << Qt::endl;
+        return 1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    try {
+        auto statistics = Cleaner::Merge(infiles, output, profile);
+        if (outfile != "-" && !fileOutput.commit())
+            throw std::runtime_error("Could not write " + outfile.toStdString());
+        if (stats) {
+            err << "Merged " << infiles.size() << " files in " << timer.elapsed() << " ms" << Qt::endl;
+            err << "Results read: " << statistics.resultsRead << Qt::endl;
+            err << "Results written: " << statistics.resultsWritten << Qt::endl;
+            if (profile.baseline)
+                err << "Results in the baseline: " << statistics.unchanged << Qt::endl;
+            for (const auto& rule : statistics.duplicates)
+                err << "Duplicates removed: " << QString::fromStdString(rule.first) << " " << rule.second << Qt::endl;
+        }
+    }
+    catch (const std::runtime_error& e) {
+        err << e.what() << Qt::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * \brief Load \a infile and report how the filters in \a profile overlap, optionally writing the overlap matrix to \a csvFile
+ */
+static int runAnalysis(const QString& infile, const SARIF::FilterProfile& profile, size_t similarity, const QString& csvFile)
+{
+    QTextStream err(stderr);
+    Cleaner cleaner;
+    cleaner.SetFilterProfile(profile);
+    cleaner.SetInfile(infile);
+    bool failed = false;
+    QObject::connect(&cleaner, &Cleaner::errorOccurred, [&](const QString& message) {
+        err << message << Qt::endl;
+        failed = true;
+    });
+    cleaner.run();
+    if (failed)
+        return 1;
+
+    try {
+        auto analysis = cleaner.AnalyzeFilters(similarity);
+        QTextStream(stdout) << Cleaner::DescribeFilterAnalysis(analysis);
+        if (!csvFile.isEmpty()) {
+            QFile csv(csvFile);
+            if (!csv.open(QIODevice::WriteOnly | QIODevice::Text)) {
+                err << "Could not write " << csvFile << Qt::endl;
+                return 1;
+            }
+            QTextStream(&csv) << Cleaner::FilterOverlapCsv(analysis);
+        }
+    }
+    catch (const std::regex_error& e) {
+        err << "Invalid file filter: " << e.what() << Qt::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * \brief Load \a infile and list the tags of its rules, with the number of rules and results that have each one
+ */
+static int runListTags(const QString& infile)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    Cleaner cleaner;
+    cleaner.SetInfile(infile);
+    bool failed = false;
+    QObject::connect(&cleaner, &Cleaner::errorOccurred, [&](const QString& message) {
+        err << message << Qt::endl;
+        failed = true;
+    });
+    cleaner.run();
+    if (failed)
+        return 1;
+
+    auto report = cleaner.Snapshot();
+    const auto& tags = report->DistinctTags();
+    auto results = report->ResultsPerTag();
+    std::vector<uint32_t> order(tags.size());
+    for (uint32_t tag = 0; tag < order.size(); ++tag)
+        order[tag] = tag;
+    std::stable_sort(order.begin(), order.end(), [&results](uint32_t a, uint32_t b) { return results[a] > results[b]; });
+    out << "results\trules\ttag" << Qt::endl;
+    for (auto tag : order)
+        out << results[tag] << "\t" << report->RulesWithTag(tag).Count() << "\t" << QString::fromStdString(tags[tag]) << Qt::endl;
+    return 0;
+}
+
+/**
+ * \brief A command-line front end to Cleaner, for use where no display is available (e.g. CI)
+ *
+ * Runs the Cleaner on the calling thread, so the only Qt module it needs is QtCore.
+ */
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("Pioneer Library System");
+    QCoreApplication::setOrganizationDomain("pioneerlibrarysystem.org");
+    QCoreApplication::setApplicationName("cleansarif-cli");
+    QCoreApplication::setApplicationVersion(QString::fromLatin1("%1.%2.%3")
+        .arg(CleanSARIF_VERSION_MAJOR).arg(CleanSARIF_VERSION_MINOR).arg(CleanSARIF_VERSION_PATCH));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Clean a SARIF file without the graphical interface.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("input", "The SARIF file to clean, or - for standard input. With --batch, one or more directories or wildcard patterns.");
+    parser.addPositionalArgument("output", "The cleaned file to write, or - for standard output. If omitted, the input is only loaded.", "[output]");
+    QCommandLineOption filtersOption(QStringList() << "f" << "filters",
+        "Apply the filters saved from CleanSARIF in <file>.", "file");
+    QCommandLineOption baseOption(QStringList() << "b" << "base",
+        "Replace the common base of the result locations with <path>. Overrides any base in the filter file.", "path");
+    QCommandLineOption pruneOption("prune-rules", "Remove the descriptions of rules that no remaining result uses.");
+    QCommandLineOption removeTagOption("remove-tag", "Remove the results of rules with a tag matching <pattern>, e.g. \"cwe-*\". May be given more than once.", "pattern");
+    QCommandLineOption keepTagOption("keep-tag", "Only keep the results of rules with a tag matching <pattern>. May be given more than once.", "pattern");
+    QCommandLineOption listTagsOption("list-tags", "List the tags of the input's rules, with their rule and result counts, instead of cleaning.");
+    QCommandLineOption whereOption("remove-where", "Remove the results that match a filter expression, e.g. \"level == note && line in 1..20\". May be given more than once.", "expression");
+    QCommandLineOption minLevelOption("min-level", "Remove the results below <level>: none, note, warning or error.", "level");
+    QCommandLineOption minRankOption("min-rank", "Remove the results with a rank below <rank>, from 0 to 100. Results without a rank are kept.", "rank");
+    QCommandLineOption onlyLinesOption("only-lines", "Only keep the results on the lines in <file>: a unified diff (for the lines it adds or changes) or a JSON object of line ranges by file.", "file");
+    QCommandLineOption dedupOption("dedup", "Remove results with the same fingerprint as an earlier result: their partialFingerprints if they have them, otherwise their rule, location and message.");
+    QCommandLineOption baselineOption("baseline", "Only keep the results that are not in the SARIF file <file>, e.g. the report of the last release. Results are matched by fingerprint, as for --dedup.", "file");
+    QCommandLineOption statsOption("stats", "Print timing and result counts to standard error.");
+    QCommandLineOption mergeOption("merge", "Merge every input (files, directories or wildcard patterns) into <output>, or - for standard output, combining the runs of each tool.", "output");
+    QCommandLineOption batchOption("batch", "Clean many files at once, writing them to the --output-dir directory.");
+    QCommandLineOption outputDirOption("output-dir", "Where --batch writes the cleaned files.", "directory");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs", "The number of files --batch cleans at once. Defaults to one per core.", "count", "0");
+    QCommandLineOption watchOption("watch", "Keep running, and clean the input again each time it changes.");
+    QCommandLineOption analyzeOption("analyze-filters", "Report the filters that match nothing, duplicate or contain each other, instead of cleaning.");
+    QCommandLineOption similarOption("similar", "With --analyze-filters, report pairs of filters that differ by at most <count> results.", "count", "5");
+    QCommandLineOption overlapOption("overlap-csv", "With --analyze-filters, write the number of results each pair of filters has in common to <file>.", "file");
+    QCommandLineOption debounceOption("debounce-ms", "How long --watch waits for the input to stop changing before cleaning it.", "milliseconds", "500");
+    parser.addOption(filtersOption);
+    parser.addOption(baseOption);
+    parser.addOption(pruneOption);
+    parser.addOption(whereOption);
+    parser.addOption(removeTagOption);
+    parser.addOption(keepTagOption);
+    parser.addOption(listTagsOption);
+    parser.addOption(minLevelOption);
+    parser.addOption(minRankOption);
+    parser.addOption(onlyLinesOption);
+    parser.addOption(dedupOption);
+    parser.addOption(baselineOption);
+    parser.addOption(statsOption);
+    parser.addOption(batchOption);
+    parser.addOption(mergeOption);
+    parser.addOption(outputDirOption);
+    parser.addOption(jobsOption);
+    parser.addOption(watchOption);
+    parser.addOption(debounceOption);
+    parser.addOption(analyzeOption);
+    parser.addOption(similarOption);
+    parser.addOption(overlapOption);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const auto arguments = parser.positionalArguments();
+
+    SARIF::FilterProfile profile;
+    try {
+        if (parser.isSet(filtersOption))
+            profile = Cleaner::LoadFilterProfile(parser.value(filtersOption));
+    }
+    catch (const std::runtime_error& e) {
+        err << e.what() << Qt::endl;
+        return 1;
+    }
+    if (parser.isSet(baseOption)) {
+        profile.overrideBase = true;
+        profile.base = parser.value(baseOption).toStdString();
+    }
+    if (parser.isSet(pruneOption))
+        profile.pruneRules = true;
+    if (parser.isSet(dedupOption))
+        profile.deduplicate = true;
+    if (parser.isSet(baselineOption)) {
+        try {
+            profile.baseline = Cleaner::LoadBaseline(parser.value(baselineOption));
+        }
+        catch (const std::runtime_error& e) {
+            err << e.what() << Qt::endl;
+            return 2;
+        }
+    }
+    if (parser.isSet(minLevelOption)) {
+        try {
+            profile.minimumLevel = SARIF::LevelFromName(parser.value(minLevelOption).toLower().toStdString());
+        }
+        catch (const std::runtime_error& e) {
+            err << e.what() << Qt::endl;
+            return 2;
+        }
+    }
+    if (parser.isSet(minRankOption)) {
+        bool ok = false;
+        profile.minimumRank = parser.value(minRankOption).toInt(&ok);
+        if (!ok || profile.minimumRank < 0 || profile.minimumRank > 100) {
+            err << "--min-rank needs a number from 0 to 100" << Qt::endl;
+            return 2;
+        }
+    }
+    if (parser.isSet(onlyLinesOption)) {
+        try {
+            profile.lineRanges = std::make_shared<const LineRanges>(LineRanges::Load(parser.value(onlyLinesOption).toStdString()));
+        }
+        catch (const std::runtime_error& e) {
+            err << e.what() << Qt::endl;
+            return 2;
+        }
+    }
+    for (const auto& expression : parser.values(whereOption))
+        profile.expressionFilters.push_back(expression.toStdString());
+
+    // Tag filters are expression filters
+    for (const auto& pattern : parser.values(removeTagOption))
+        profile.expressionFilters.push_back("tags contains " + FilterExpression::Quote(pattern.toStdString()));
+    if (parser.isSet(keepTagOption)) {
+        std::string anyTag;
+        for (const auto& pattern : parser.values(keepTagOption))
+            anyTag += (anyTag.empty() ? "" : " or ") + std::string("tags contains ") + FilterExpression::Quote(pattern.toStdString());
+        profile.expressionFilters.push_back("not (" + anyTag + ")");
+    }
+
+    // Check every filter before any work starts
+    try {
+        profile.Compile();
+    }
+    catch (const std::regex_error& e) {
+        err << "Invalid regular expression in a filter: " << e.what() << Qt::endl;
+        return 2;
+    }
+    catch (const std::runtime_error& e) {
+        err << e.what() << Qt::endl;
+        return 2;
+    }
+
+    if (parser.isSet(batchOption)) {
+        if (arguments.isEmpty() || !parser.isSet(outputDirOption)) {
+            err << "--batch needs at least one input and an --output-dir" << Qt::endl;
+            return 2;
+        }
+        return runBatch(arguments, parser.value(outputDirOption), profile, parser.value(jobsOption).toUInt());
+    }
+
+    if (parser.isSet(mergeOption)) {
+        if (arguments.isEmpty()) {
+            err << "--merge needs at least one input" << Qt::endl;
+            return 2;
+        }
+        return runMerge(arguments, parser.value(mergeOption), profile, parser.isSet(statsOption));
+    }
+
+    if (parser.isSet(listTagsOption)) {
+        if (arguments.size() != 1) {
+            err << "--list-tags needs a single input file" << Qt::endl;
+            return 2;
+        }
+        return runListTags(arguments[0]);
+    }
+
+    if (parser.isSet(analyzeOption)) {
+        if (arguments.size() != 1) {
+            err << "--analyze-filters needs a single input file" << Qt::endl;
+            return 2;
+        }
+        return runAnalysis(arguments[0], profile, parser.value(similarOption).toULongLong(), parser.value(overlapOption));
+    }
+
+    if (arguments.isEmpty() || arguments.size() > 2) {
+        err << "Expected an input file and an optional output file" << Qt::endl;
+        return 2;
+    }
+
+    const bool watch = parser.isSet(watchOption);
+    if (watch && (arguments.size() < 2 || arguments.contains("-") || arguments[0] == arguments[1])) {
+        err << "--watch needs an input file and a different output file" << Qt::endl;
+        return 2;
+    }
+
+    Cleaner cleaner;
+    cleaner.SetIncrementalReload(watch);
+    cleaner.SetFilterProfile(profile);
+    cleaner.SetInfile(arguments[0]);
+    if (arguments.size() > 1)
+        cleaner.SetOutfile(arguments[1]);
+
+    // Run on this thread: the signals are delivered directly, so they can be used to time each stage
+    QElapsedTimer timer;
+    qint64 loadTime = 0;
+    qint64 exportTime = 0;
+    bool failed = false;
+    QObject::connect(&cleaner, &Cleaner::fileLoaded, [&]() { loadTime = timer.restart(); });
+    QObject::connect(&cleaner, &Cleaner::fileWritten, [&]() { exportTime = timer.restart(); });
+    QObject::connect(&cleaner, &Cleaner::errorOccurred, [&](const QString& message) {
+        err << message << Qt::endl;
+        failed = true;
+    });
+    timer.start();
+    cleaner.run();
+
+    if (watch) {
+        // The first version may have been caught half-written, so a failure doesn't stop the watch
+        ReportWatcher watcher(arguments[0], parser.value(debounceOption).toInt());
+        QObject::connect(&watcher, &ReportWatcher::reportChanged, [&]() {
+            failed = false;
+            timer.start();
+            cleaner.run();
+            if (!failed) {
+                auto statistics = cleaner.GetExportStatistics();
+                QTextStream(stdout) << QDateTime::currentDateTime().toString("HH:mm:ss") << " " << arguments[0] << ": "
+                    << statistics.resultsWritten << "/" << statistics.resultsRead << " results, "
+                    << static_cast<unsigned long long>(cleaner.GetReusedResults()) << " unchanged, "
+                    << loadTime + exportTime << " ms" << Qt::endl;
+            }
+        });
+        return app.exec();
+    }
+
+    if (failed)
+        return 1;
+
+    if (parser.isSet(statsOption)) {
+        // When streaming, the file is never loaded as a whole, so there is no rule count
+        if (!cleaner.GetRules().empty())
+            err << "Rules: " << static_cast<unsigned long long>(cleaner.GetRules().size()) << Qt::endl;
+        err << "Load: " << loadTime << " ms" << Qt::endl;
+        if (arguments.size() > 1) {
+            auto statistics = cleaner.GetExportStatistics();
+            err << "Filter and export: " << exportTime << " ms" << Qt::endl;
+            err << "Results read: " << statistics.resultsRead << Qt::endl;
+            err << "Results written: " << statistics.resultsWritten << Qt::endl;
+            if (profile.baseline)
+                err << "Results in the baseline: " << statistics.unchanged << Qt::endl;
+            for (const auto& rule : statistics.duplicates)
+                err << "Duplicates removed: " << QString::fromStdString(rule.first) << " " << rule.second << Qt::endl;
+            for (const auto& file : cleaner.GetWrittenFiles())
+                err << "Wrote " << file << Qt::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+﻿// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <version.h>
+#include "SARIFServer.h"
+#include "SARIFClient.h"
+
+#include <stdexcept>
+
+/**
+ * \brief The resident service, and a client for it, for tools that ask many questions about the same reports
+ *
+ * Kept apart from cleansarif-cli so that the command-line cleaner only needs QtCore, while this one also needs
+ * QtNetwork for its local socket.
+ */
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("Pioneer Library System");
+    QCoreApplication::setOrganizationDomain("pioneerlibrarysystem.org");
+    QCoreApplication::setApplicationName("cleansarif-service");
+    QCoreApplication::setApplicationVersion(QString::fromLatin1("%1.%2.%3")
+        .arg(CleanSARIF_VERSION_MAJOR).arg(CleanSARIF_VERSION_MINOR).arg(CleanSARIF_VERSION_PATCH));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Keep SARIF files in memory and answer requests about them, or send such a request.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("request", "With --query, the JSON request to send.", "[request]");
+    QCommandLineOption serveOption("serve", "Run as a service on the local socket <name>, keeping loaded files in memory.", "name");
+    QCommandLineOption cacheOption("cache-mb", "The memory --serve may use for loaded files.", "megabytes", "1024");
+    QCommandLineOption queryOption("query", "Send the JSON request given as the argument to the service on <name>, and print the reply.", "name");
+    parser.addOption(serveOption);
+    parser.addOption(cacheOption);
+    parser.addOption(queryOption);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const auto arguments = parser.positionalArguments();
+
+    if (parser.isSet(serveOption)) {
+        SARIFServer server(static_cast<size_t>(parser.value(cacheOption).toULongLong()) * 1024 * 1024);
+        if (!server.Listen(parser.value(serveOption))) {
+            err << "Could not listen on " << parser.value(serveOption) << ": " << server.ErrorString() << Qt::endl;
+            return 1;
+        }
+        return app.exec();
+    }
+
+    if (parser.isSet(queryOption)) {
+        auto request = QJsonDocument::fromJson(arguments.join(" ").toUtf8());
+        if (!request.isObject()) {
+            err << "The request must be a JSON object" << Qt::endl;
+            return 2;
+        }
+        try {
+            auto reply = SARIFClient::Request(parser.value(queryOption), request.object());
+            QTextStream(stdout) << QJsonDocument(reply).toJson(QJsonDocument::Compact) << Qt::endl;
+            return reply["ok"].toBool() ? 0 : 1;
+        }
+        catch (const std::runtime_error& e) {
+            err << e.what() << Qt::endl;
+            return 1;
+        }
+    }
+
+    err << "Expected --serve or --query" << Qt::endl;
+    return 2;
+}
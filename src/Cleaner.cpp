@@ -24,8 +24,17 @@
 
 #pragma warning(push, 1) 
 #include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDir>
+#include <QFileInfo>
+#include <QTextStream>
 #pragma warning(pop)
 
+#include "WorkStealingPool.h"
+#include "SARIFStream.h"
+
 #include <sstream>
 #include <stdexcept>
 #include <iostream>
@@ -35,27 +44,50 @@
 #include <set>
 #include <algorithm>
 #include <filesystem>
+#include <chrono>
+#include <atomic>
 
 using namespace std::placeholders;
 
 
 Cleaner::Cleaner()
 {
+	Publish(std::make_shared<const SARIF>());
+}
+
+std::shared_ptr<const SARIF> Cleaner::Snapshot() const
+{
+#ifdef __cpp_lib_atomic_shared_ptr
+	return _snapshot.load();
+#else
+	return std::atomic_load(&_snapshot);
+#endif
+}
+
+void Cleaner::Publish(std::shared_ptr<const SARIF> snapshot)
+{
+#ifdef __cpp_lib_atomic_shared_ptr
+	_snapshot.store(std::move(snapshot));
+#else
+	std::atomic_store(&_snapshot, std::move(snapshot));
+#endif
 }
 
 void Cleaner::SetInfile(const QString& infile)
 {
+	std::lock_guard<std::mutex> lock(_filtersMutex);
 	_infile = infile;
 }
 
 void Cleaner::SetOutfile(const QString& outfile)
 {
+	std::lock_guard<std::mutex> lock(_filtersMutex);
 	_outfile = outfile;
 }
 
 std::vector<std::tuple<QString, int>> Cleaner::GetRules() const
 {
-	auto internalRules = _sarif.GetRules();
+	auto internalRules = Snapshot()->GetRules();
 	std::vector<std::tuple<QString, int>> rules;
 	for (const auto& r : internalRules) {
 		rules.emplace_back(std::make_tuple(QString::fromStdString(r.first), r.second));
@@ -66,7 +98,7 @@ std::vector<std::tuple<QString, int>> Cleaner::GetRules() const
 QStringList Cleaner::GetFiles() const
 {
 	QStringList files;
-	auto internalFiles = _sarif.Files();
+	auto internalFiles = Snapshot()->Files();
 	for (const auto& file : internalFiles) {
 		files.append(QString::fromStdString(file));
 	}
@@ -75,125 +107,758 @@ QStringList Cleaner::GetFiles() const
 
 QString Cleaner::GetBase() const
 {
-	return QString::fromStdString(_sarif.GetBase());
+	return QString::fromStdString(Snapshot()->GetBase());
 }
 
 void Cleaner::SetBase(const QString& newBase)
 {
+	// The trailing separator is matched to the loaded file's base when the run starts
+	std::lock_guard<std::mutex> lock(_filtersMutex);
 	_overrideBase = true;
+	_newBase = newBase;
+}
+
+QString Cleaner::AdjustBase(const QString& oldBase, const QString& newBase)
+{
 	// If the old base ended with a slash or backslash, make sure the new one does too
-	auto oldBase = QString::fromStdString(_sarif.GetBase());
 	QString adjustedBase = newBase;
+	if (oldBase.isEmpty() || adjustedBase.isEmpty()) {
+		return adjustedBase;
+	}
 	if (*oldBase.rbegin() == '/' && *adjustedBase.rbegin() != '/') {
 		adjustedBase += "/";
 	}
 	else if (*oldBase.rbegin() == '\\' && *adjustedBase.rbegin() != '\\') {
 		adjustedBase += "\\";
 	}
-	_newBase = adjustedBase;
+	return adjustedBase;
 }
 
 int Cleaner::SuppressRule(const QString& ruleID)
 {
-	if (!_suppressedRules.contains(ruleID)) {
-		_suppressedRules.append(ruleID);
+	{
+		std::lock_guard<std::mutex> lock(_filtersMutex);
+		if (!_suppressedRules.contains(ruleID)) {
+			_suppressedRules.append(ruleID);
+		}
 	}
-	return _sarif.SuppressRule(ruleID.toStdString());
+	return Snapshot()->RuleHits(ruleID.toStdString());
 }
 
 void Cleaner::UnsuppressRule(const QString& ruleID)
 {
+	std::lock_guard<std::mutex> lock(_filtersMutex);
 	_suppressedRules.removeOne(ruleID);
-	_sarif.UnsuppressRule(ruleID.toStdString());
 }
 
 QStringList Cleaner::SuppressedRules() const
 {
+	std::lock_guard<std::mutex> lock(_filtersMutex);
 	return _suppressedRules;
 }
 
 int Cleaner::AddLocationFilter(const QString& regex)
 {
-	if (!_fileFilters.contains(regex)) {
-		_fileFilters.append(regex);
+	{
+		std::lock_guard<std::mutex> lock(_filtersMutex);
+		if (!_fileFilters.contains(regex)) {
+			_fileFilters.append(regex);
+		}
+	}
+	return Snapshot()->LocationHits(regex.toStdString());
+}
+
+std::vector<int> Cleaner::ApplyFilterProfile(const SARIF::FilterProfile& profile)
+{
+	auto hits = Snapshot()->FilterHits(profile);
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	for (const auto& rule : profile.suppressedRules) {
+		auto ruleID = QString::fromStdString(rule);
+		if (!_suppressedRules.contains(ruleID)) {
+			_suppressedRules.append(ruleID);
+		}
+	}
+	for (const auto& filter : profile.locationFilters) {
+		auto regex = QString::fromStdString(filter);
+		if (!_fileFilters.contains(regex)) {
+			_fileFilters.append(regex);
+		}
 	}
-	return _sarif.AddLocationFilter(regex.toStdString());
+	for (const auto& filter : profile.expressionFilters) {
+		auto expression = QString::fromStdString(filter);
+		if (!_expressionFilters.contains(expression)) {
+			_expressionFilters.append(expression);
+		}
+	}
+	return hits;
 }
 
 void Cleaner::RemoveLocationFilter(const QString& regex)
 {
+	std::lock_guard<std::mutex> lock(_filtersMutex);
 	_fileFilters.removeOne(regex);
-	_sarif.RemoveLocationFilter(regex.toStdString());
 }
 
 QStringList Cleaner::LocationFilters() const
 {
+	std::lock_guard<std::mutex> lock(_filtersMutex);
 	return _fileFilters;
 }
 
+int Cleaner::AddExpressionFilter(const QString& expression)
+{
+	auto hits = Snapshot()->ExpressionHits(expression.toStdString());
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	if (!_expressionFilters.contains(expression)) {
+		_expressionFilters.append(expression);
+	}
+	return hits;
+}
+
+void Cleaner::RemoveExpressionFilter(const QString& expression)
+{
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	_expressionFilters.removeOne(expression);
+}
+
+QStringList Cleaner::ExpressionFilters() const
+{
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	return _expressionFilters;
+}
+
+int Cleaner::SetThreshold(SARIF::Level minimumLevel, int minimumRank)
+{
+	auto hits = ThresholdHits(minimumLevel, minimumRank);
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	_minimumLevel = minimumLevel;
+	_minimumRank = minimumRank;
+	return hits;
+}
+
+int Cleaner::ThresholdHits(SARIF::Level minimumLevel, int minimumRank) const
+{
+	return Snapshot()->ThresholdHits(minimumLevel, minimumRank);
+}
+
+void Cleaner::SetLineRanges(std::shared_ptr<const LineRanges> ranges)
+{
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	_lineRanges = std::move(ranges);
+}
+
+void Cleaner::SetPruneRules(bool prune)
+{
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	_pruneRules = prune;
+}
+
+void Cleaner::SetDeduplicate(bool deduplicate)
+{
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	_deduplicate = deduplicate;
+}
+
+void Cleaner::SetBaseline(std::shared_ptr<const FingerprintSet> baseline)
+{
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	_baseline = std::move(baseline);
+}
+
+void Cleaner::SetResultProjection(SARIF::ProjectionMode mode, const QStringList& paths)
+{
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	_projectionMode = mode;
+	_projectionPaths = paths;
+}
+
+SARIF::ExportStatistics Cleaner::GetExportStatistics() const
+{
+	return _exportStatistics;
+}
+
+SARIF::SizeBudgetPlan Cleaner::PlanSizeBudget(qint64 budget) const
+{
+	return Snapshot()->PlanSizeBudget(static_cast<size_t>(budget));
+}
+
+SARIF::FilterAnalysis Cleaner::AnalyzeFilters(size_t similarity) const
+{
+	return Snapshot()->AnalyzeFilters(GetFilterProfile(), similarity);
+}
+
+QString Cleaner::DescribeFilterAnalysis(const SARIF::FilterAnalysis& analysis)
+{
+	auto name = [&analysis](size_t filter) {
+		const auto& f = analysis.filters[filter];
+		return (f.isRule ? tr("rule %1") : tr("file filter \"%1\"")).arg(QString::fromStdString(f.pattern));
+	};
+
+	QString report;
+	QTextStream out(&report);
+	out << tr("%1 filters remove %2 of %3 results").arg(analysis.filters.size()).arg(analysis.removed).arg(analysis.results) << "\n";
+	for (size_t filter = 0; filter < analysis.filters.size(); ++filter) {
+		out << "  " << name(filter) << ": " << tr("%1 matches, %2 unique")
+			.arg(analysis.filters[filter].matches).arg(analysis.filters[filter].unique) << "\n";
+	}
+	if (!analysis.dead.empty()) {
+		out << "\n" << tr("Match nothing:") << "\n";
+		for (auto filter : analysis.dead)
+			out << "  " << name(filter) << "\n";
+	}
+	if (!analysis.redundant.empty()) {
+		out << "\n" << tr("Redundant, everything they match is removed by other filters:") << "\n";
+		for (auto filter : analysis.redundant)
+			out << "  " << name(filter) << "\n";
+	}
+	if (!analysis.subsumed.empty()) {
+		out << "\n" << tr("Contained in another filter:") << "\n";
+		for (const auto& pair : analysis.subsumed) {
+			bool same = analysis.filters[pair.first].matches == analysis.filters[pair.second].matches;
+			out << "  " << (same ? tr("%1 matches the same results as %2") : tr("%1 is contained in %2"))
+				.arg(name(pair.first), name(pair.second)) << "\n";
+		}
+	}
+	if (!analysis.similar.empty()) {
+		out << "\n" << tr("Nearly the same:") << "\n";
+		for (const auto& pair : analysis.similar) {
+			auto both = analysis.overlap[pair.first][pair.second];
+			out << "  " << tr("%1 and %2 differ by %3 results").arg(name(pair.first), name(pair.second))
+				.arg(analysis.filters[pair.first].matches + analysis.filters[pair.second].matches - 2 * both) << "\n";
+		}
+	}
+	return report;
+}
+
+QString Cleaner::FilterOverlapCsv(const SARIF::FilterAnalysis& analysis)
+{
+	auto quote = [](const std::string& text) {
+		return "\"" + QString::fromStdString(text).replace("\"", "\"\"") + "\"";
+	};
+
+	QString csv;
+	QTextStream out(&csv);
+	out << "\"\"";
+	for (const auto& filter : analysis.filters)
+		out << "," << quote((filter.isRule ? "rule:" : "file:") + filter.pattern);
+	out << "\n";
+	for (size_t i = 0; i < analysis.filters.size(); ++i) {
+		const auto& filter = analysis.filters[i];
+		out << quote((filter.isRule ? "rule:" : "file:") + filter.pattern);
+		for (auto count : analysis.overlap[i])
+			out << "," << count;
+		out << "\n";
+	}
+	return csv;
+}
+
+QString Cleaner::DirectoryFilter(const QString& directory) const
+{
+	return QString::fromStdString(Snapshot()->DirectoryFilter(directory.toStdString()));
+}
+
+void Cleaner::SetSizeBudget(qint64 budget)
+{
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	_sizeBudget = budget;
+}
+
+SARIF::SizeBudgetPlan Cleaner::GetSizeBudgetPlan() const
+{
+	return _sizeBudgetPlan;
+}
+
+void Cleaner::SetSplitOutput(SARIF::SplitMode mode, qint64 maximumBytes)
+{
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	_splitMode = mode;
+	_splitBytes = maximumBytes;
+}
+
+QStringList Cleaner::GetWrittenFiles() const
+{
+	return _writtenFiles;
+}
+
+void Cleaner::SetIncrementalReload(bool incremental)
+{
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	_incrementalReload = incremental;
+}
+
+size_t Cleaner::GetReusedResults() const
+{
+	return _reusedResults;
+}
+
+void Cleaner::SetFilterProfile(const SARIF::FilterProfile& profile)
+{
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	_overrideBase = profile.overrideBase;
+	_newBase = QString::fromStdString(profile.base);
+	_suppressedRules.clear();
+	for (const auto& rule : profile.suppressedRules)
+		_suppressedRules.append(QString::fromStdString(rule));
+	_fileFilters.clear();
+	for (const auto& regex : profile.locationFilters)
+		_fileFilters.append(QString::fromStdString(regex));
+	_expressionFilters.clear();
+	for (const auto& expression : profile.expressionFilters)
+		_expressionFilters.append(QString::fromStdString(expression));
+	_minimumLevel = profile.minimumLevel;
+	_minimumRank = profile.minimumRank;
+	_lineRanges = profile.lineRanges;
+	_pruneRules = profile.pruneRules;
+	_deduplicate = profile.deduplicate;
+	_baseline = profile.baseline;
+	_projectionMode = profile.projectionMode;
+	_projectionPaths.clear();
+	for (const auto& path : profile.projectionPaths)
+		_projectionPaths.append(QString::fromStdString(path));
+}
+
+void Cleaner::SetAdditionalOutputs(const std::vector<std::pair<SARIF::FilterProfile, QString>>& outputs)
+{
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	_additionalOutputs = outputs;
+}
+
+SARIF::FilterProfile Cleaner::LoadFilterProfile(const QString& filename)
+{
+	QFile infile(filename);
+	if (!infile.open(QIODevice::ReadOnly | QIODevice::Text))
+		throw std::runtime_error("Failed to open the filter file " + filename.toStdString());
+	auto doc = QJsonDocument::fromJson(infile.readAll());
+	if (!doc.isObject() || !doc.object().contains("fileFormatMajorVersion"))
+		throw std::runtime_error("Unrecognized filter file format in " + filename.toStdString());
+	auto version = doc.object()["fileFormatMajorVersion"].toString();
+	if (version != "1")
+		throw std::runtime_error("Cannot read filter file format version " + version.toStdString());
+
+	return FilterProfileFromJson(doc.object()["xdata"].toObject());
+}
+
+std::shared_ptr<const FingerprintSet> Cleaner::LoadBaseline(const QString& filename)
+{
+	QFile infile(filename);
+	if (!infile.open(QIODevice::ReadOnly))
+		throw std::runtime_error("Failed to open the baseline " + filename.toStdString());
+	return std::make_shared<const FingerprintSet>(SARIFStreamFilter::Fingerprints(infile));
+}
+
+SARIF::FilterProfile Cleaner::FilterProfileFromJson(const QJsonObject& data)
+{
+	SARIF::FilterProfile profile;
+	if (data.contains("basePath") && data["basePath"].isString()) {
+		profile.overrideBase = true;
+		profile.base = data["basePath"].toString().toStdString();
+	}
+	for (const auto& rule : data["ruleFilters"].toArray())
+		profile.suppressedRules.push_back(rule.toObject()["rule"].toString().toStdString());
+	for (const auto& filter : data["fileFilters"].toArray())
+		profile.locationFilters.push_back(filter.toObject()["regex"].toString().toStdString());
+	for (const auto& filter : data["expressionFilters"].toArray())
+		profile.expressionFilters.push_back(filter.toObject()["expression"].toString().toStdString());
+	if (data.contains("threshold") && data["threshold"].isObject()) {
+		QJsonObject threshold = data["threshold"].toObject();
+		profile.minimumLevel = SARIF::LevelFromName(threshold.value("level").toString("none").toStdString());
+		profile.minimumRank = threshold.value("rank").toInt(0);
+	}
+	if (data.contains("lineRanges") && data["lineRanges"].isObject())
+		profile.lineRanges = std::make_shared<const LineRanges>(LineRanges::FromJson(data["lineRanges"].toObject()));
+	profile.pruneRules = data["pruneRules"].toBool(false);
+	profile.deduplicate = data["deduplicate"].toBool(false);
+	if (data.contains("projection") && data["projection"].isObject()) {
+		QJsonObject projection = data["projection"].toObject();
+		auto mode = projection["mode"].toString();
+		if (mode == "keep")
+			profile.projectionMode = SARIF::ProjectionMode::Keep;
+		else if (mode == "drop")
+			profile.projectionMode = SARIF::ProjectionMode::Drop;
+		for (const auto& path : projection["paths"].toArray())
+			profile.projectionPaths.push_back(path.toString().toStdString());
+	}
+	return profile;
+}
+
+double Cleaner::BatchSummary::MegabytesPerSecond() const
+{
+	if (seconds <= 0.0)
+		return 0.0;
+	return static_cast<double>(bytesRead) / (1024.0 * 1024.0) / seconds;
+}
+
+QStringList Cleaner::ExpandBatchInputs(const QString& pattern)
+{
+	QFileInfo info(pattern);
+	QDir directory;
+	QStringList nameFilters;
+	if (info.isDir()) {
+		directory = QDir(info.absoluteFilePath());
+		nameFilters << "*.sarif";
+	}
+	else {
+		directory = QDir(info.absolutePath());
+		nameFilters << info.fileName();
+	}
+	QStringList files;
+	for (const auto& file : directory.entryInfoList(nameFilters, QDir::Files, QDir::Name))
+		files.append(file.absoluteFilePath());
+	return files;
+}
+
+QStringList Cleaner::BatchOutputs(const QStringList& infiles, const QString& outputDirectory)
+{
+	// The deepest directory that holds every input
+	QStringList root;
+	for (int file = 0; file < infiles.size(); ++file) {
+		auto directory = QFileInfo(infiles[file]).absolutePath().split('/');
+		if (file == 0) {
+			root = directory;
+			continue;
+		}
+		int common = 0;
+		while (common < root.size() && common < directory.size() && root[common] == directory[common])
+			++common;
+		root = root.mid(0, common);
+	}
+	const QDir rootDirectory(root.join("/") + "/");
+
+	QStringList outfiles;
+	std::set<QString> used;
+	for (const auto& infile : infiles) {
+		auto outfile = QDir(outputDirectory).filePath(rootDirectory.relativeFilePath(QFileInfo(infile).absoluteFilePath()));
+		const QFileInfo info(outfile);
+		for (int copy = 2; !used.insert(QFileInfo(outfile).absoluteFilePath()).second; ++copy)
+			outfile = info.dir().filePath(info.completeBaseName() + QString::fromLatin1("-%1.").arg(copy) + info.suffix());
+		outfiles.append(outfile);
+	}
+	return outfiles;
+}
+
+Cleaner::BatchSummary Cleaner::CleanBatch(const QStringList& infiles, const QString& outputDirectory, SARIF::FilterProfile profile,
+	unsigned int threads, std::function<bool(void)> interruptionRequested)
+{
+	using Clock = std::chrono::steady_clock;
+	const auto batchStart = Clock::now();
+
+	// Every worker reads the same compiled filters
+	try {
+		profile.Compile();
+	}
+	catch (const std::regex_error& e) {
+		throw std::runtime_error(std::string("Invalid regular expression in a filter: ") + e.what());
+	}
+
+	const auto outfiles = BatchOutputs(infiles, outputDirectory);
+	BatchSummary summary;
+	summary.files.resize(infiles.size());
+	WorkStealingPool pool(threads);
+	for (int file = 0; file < infiles.size(); ++file) {
+		pool.Submit([&, file]() {
+			auto& result = summary.files[file];
+			result.infile = infiles[file];
+			result.outfile = outfiles[file];
+			if (interruptionRequested()) {
+				result.error = QString::fromLatin1("Operation cancelled");
+				return;
+			}
+			const auto fileStart = Clock::now();
+			try {
+				if (!QDir().mkpath(QFileInfo(result.outfile).absolutePath()))
+					throw std::runtime_error("Could not create the directory for " + result.outfile.toStdString());
+				// Like run(), an existing backup is never replaced, as it may be the only copy of the original
+				const bool inPlace = QFileInfo(result.infile).absoluteFilePath() == QFileInfo(result.outfile).absoluteFilePath();
+				const auto backup = result.infile.toStdString() + ".backup";
+				if (inPlace && std::filesystem::exists(backup))
+					throw std::runtime_error("Could not make a backup of " + result.infile.toStdString() + ", " + backup + " already exists");
+				result.bytesRead = QFileInfo(result.infile).size();
+				SARIF sarif;
+				sarif.Load(result.infile.toStdString(), interruptionRequested);
+				auto fileProfile = profile;
+				if (fileProfile.overrideBase)
+					fileProfile.base = AdjustBase(QString::fromStdString(sarif.GetBase()), QString::fromStdString(fileProfile.base)).toStdString();
+				sarif.SetFilters(fileProfile);
+				if (inPlace)
+					std::filesystem::copy(result.infile.toStdString(), backup);
+				result.statistics = sarif.Export(result.outfile.toStdString(), interruptionRequested);
+			}
+			catch (const std::exception& e) {
+				result.error = QString::fromLocal8Bit(e.what());
+			}
+			result.seconds = std::chrono::duration<double>(Clock::now() - fileStart).count();
+		});
+	}
+	pool.Wait();
+
+	for (const auto& result : summary.files) {
+		if (result.error.isEmpty())
+			summary.bytesRead += result.bytesRead;
+		else
+			++summary.failures;
+	}
+	summary.seconds = std::chrono::duration<double>(Clock::now() - batchStart).count();
+	return summary;
+}
+
+SARIF::ExportStatistics Cleaner::CleanStream(QIODevice& input, QIODevice& output, const SARIF::FilterProfile& profile,
+	std::function<bool(void)> interruptionRequested)
+{
+	if (SARIFStreamFilter::CanStream(profile))
+		return SARIFStreamFilter(profile).Filter(input, output, interruptionRequested);
+
+	SARIF sarif;
+	sarif.Load(input, interruptionRequested);
+	auto adjustedProfile = profile;
+	if (adjustedProfile.overrideBase)
+		adjustedProfile.base = AdjustBase(QString::fromStdString(sarif.GetBase()), QString::fromStdString(profile.base)).toStdString();
+	sarif.SetFilters(adjustedProfile);
+	return sarif.Export(output, interruptionRequested);
+}
+
+SARIF::ExportStatistics Cleaner::Merge(const QStringList& infiles, QIODevice& output, const SARIF::FilterProfile& profile,
+	std::function<bool(void)> interruptionRequested)
+{
+	// Rules are renumbered as the runs are merged, and the inputs never all loaded, so the filters must stream
+	if (!SARIFStreamFilter::CanStream(profile))
+		throw std::runtime_error("Rule pruning, base replacement and expression filters cannot be used when merging");
+	std::vector<std::string> inputs;
+	for (const auto& infile : infiles)
+		inputs.push_back(infile.toStdString());
+	return SARIFStreamFilter(profile).Merge(inputs, output, interruptionRequested);
+}
+
+SARIF::FilterProfile Cleaner::GetFilterProfile() const
+{
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	return CurrentProfile();
+}
+
+SARIF::FilterProfile Cleaner::CurrentProfile() const
+{
+	SARIF::FilterProfile profile;
+	profile.overrideBase = _overrideBase;
+	profile.base = _newBase.toStdString();
+	for (const auto& rule : _suppressedRules)
+		profile.suppressedRules.push_back(rule.toStdString());
+	for (const auto& regex : _fileFilters)
+		profile.locationFilters.push_back(regex.toStdString());
+	for (const auto& expression : _expressionFilters)
+		profile.expressionFilters.push_back(expression.toStdString());
+	profile.minimumLevel = _minimumLevel;
+	profile.minimumRank = _minimumRank;
+	profile.lineRanges = _lineRanges;
+	profile.pruneRules = _pruneRules;
+	profile.deduplicate = _deduplicate;
+	profile.baseline = _baseline;
+	profile.projectionMode = _projectionMode;
+	for (const auto& path : _projectionPaths)
+		profile.projectionPaths.push_back(path.toStdString());
+	return profile;
+}
+
+Cleaner::RunSettings Cleaner::GetRunSettings() const
+{
+	std::lock_guard<std::mutex> lock(_filtersMutex);
+	RunSettings settings;
+	settings.infile = _infile;
+	settings.outfile = _outfile;
+	settings.profile = CurrentProfile();
+	settings.additionalOutputs = _additionalOutputs;
+	settings.sizeBudget = _sizeBudget;
+	settings.splitMode = _splitMode;
+	settings.splitBytes = _splitBytes;
+	settings.incrementalReload = _incrementalReload;
+	return settings;
+}
+
+void Cleaner::runPipe(const RunSettings& settings)
+{
+	if (settings.splitMode != SARIF::SplitMode::None || !settings.additionalOutputs.empty() || settings.sizeBudget > 0) {
+		emit errorOccurred(tr("Split output, additional outputs and size budgets cannot be used with standard input or output"));
+		exit(-1);
+		return;
+	}
+
+	auto interruptionRequested = std::bind(&Cleaner::isInterruptionRequested, QThread::currentThread());
+	QFile input;
+	bool opened = false;
+	if (settings.infile == "-") {
+		opened = input.open(stdin, QIODevice::ReadOnly);
+	}
+	else {
+		input.setFileName(settings.infile);
+		opened = input.open(QIODevice::ReadOnly);
+	}
+	if (!opened) {
+		emit errorOccurred(QString::fromLatin1("Could not open ") + settings.infile);
+		exit(-1);
+		return;
+	}
+
+	_writtenFiles.clear();
+	try {
+		if (settings.outfile.isEmpty()) {
+			_loadedFile.clear();
+			auto loaded = std::make_shared<SARIF>();
+			loaded->Load(input, interruptionRequested);
+			Publish(loaded);
+			emit fileLoaded(settings.infile);
+			exit(0);
+			return;
+		}
+
+		QFile output;
+		if (settings.outfile == "-") {
+			opened = output.open(stdout, QIODevice::WriteOnly);
+		}
+		else {
+			output.setFileName(settings.outfile);
+			opened = output.open(QIODevice::WriteOnly | QIODevice::Truncate);
+		}
+		if (!opened)
+			throw std::runtime_error("Could not open " + settings.outfile.toStdString() + " for writing");
+		_exportStatistics = Cleaner::CleanStream(input, output, settings.profile, interruptionRequested);
+		output.flush();
+	}
+	catch (const std::runtime_error& e) {
+		emit errorOccurred(e.what());
+		exit(-1);
+		return;
+	}
+
+	_writtenFiles.append(settings.outfile);
+	emit fileWritten(settings.outfile);
+}
+
 void Cleaner::run()
 {
-	if (_infile.isEmpty()) {
+	// Everything the run reads is copied once, so settings changed while it works apply to the next run
+	auto settings = GetRunSettings();
+	if (settings.infile.isEmpty()) {
 		emit errorOccurred(tr("No input file set, aborting run"));
 		exit(-1);
 		return;
 	}
 
-	// Reset the SARIF object:
-	_sarif = SARIF();
+	if (settings.infile == "-" || settings.outfile == "-") {
+		runPipe(settings);
+		return;
+	}
 
+	// The new data is built privately and then published as a whole, so other threads reading the
+	// current snapshot never see it half-loaded
+	auto interruptionRequested = std::bind(&Cleaner::isInterruptionRequested, QThread::currentThread());
+	std::shared_ptr<SARIF> loaded;
 	try {
-		_sarif.Load(_infile.toStdString(), std::bind(&Cleaner::isInterruptionRequested, QThread::currentThread()));
+		_reusedResults = 0;
+		if (settings.incrementalReload && _loadedFile == settings.infile) {
+			_loadedFile.clear();
+			loaded = std::make_shared<SARIF>(*Snapshot());
+			_reusedResults = loaded->Reload(settings.infile.toStdString(), interruptionRequested);
+		}
+		else {
+			_loadedFile.clear();
+			loaded = std::make_shared<SARIF>();
+			loaded->Load(settings.infile.toStdString(), interruptionRequested);
+		}
 	}
 	catch (std::runtime_error& e) {
 		emit errorOccurred(e.what());
 		exit(-1);
 		return;
 	}
-	emit fileLoaded(_infile);
+	if (!QThread::currentThread()->isInterruptionRequested())
+		_loadedFile = settings.infile;
+	Publish(loaded);
+	emit fileLoaded(settings.infile);
 
-	if (_outfile.isEmpty()) {
+	if (settings.outfile.isEmpty()) {
 		exit(0);
 		return;
 	}
 
-	if (_overrideBase) {
-		_sarif.SetBase(_newBase.toStdString());
+	// The filters are applied to a copy, which shares the JSON and the index with the published snapshot
+	SARIF sarif = *loaded;
+
+	// The bases of the additional profiles are adjusted against the original base, so do them first
+	std::vector<std::pair<SARIF::FilterProfile, std::string>> additionalOutputs;
+	for (const auto& output : settings.additionalOutputs) {
+		auto profile = output.first;
+		if (profile.overrideBase)
+			profile.base = AdjustBase(QString::fromStdString(sarif.GetBase()), QString::fromStdString(profile.base)).toStdString();
+		additionalOutputs.emplace_back(profile, output.second.toStdString());
 	}
 
-	for (const auto& fileFilter : _fileFilters) {
-		_sarif.AddLocationFilter(fileFilter.toStdString());
-		if (QThread::currentThread()->isInterruptionRequested()) {
-			emit errorOccurred(tr("Operation cancelled"));
-			exit(-1);
-			return;
-		}
+	auto profile = settings.profile;
+	if (profile.overrideBase)
+		profile.base = AdjustBase(QString::fromStdString(sarif.GetBase()), QString::fromStdString(profile.base)).toStdString();
+
+	// The location and expression filters are compiled once and kept for as long as they are unchanged, so
+	// repeated runs (e.g. in watch mode) do not compile them again
+	if (!_compiledFilters || _compiledFilterSource != profile.locationFilters || _compiledExpressionSource != profile.expressionFilters) {
+		profile.Compile();
+		_compiledFilters = profile.compiledLocationFilters;
+		_compiledFilterSource = profile.locationFilters;
+		_compiledExpressions = profile.compiledExpressionFilters;
+		_compiledExpressionSource = profile.expressionFilters;
+	}
+	profile.compiledLocationFilters = _compiledFilters;
+	profile.compiledExpressionFilters = _compiledExpressions;
+	sarif.SetFilters(profile);
+	if (QThread::currentThread()->isInterruptionRequested()) {
+		emit errorOccurred(tr("Operation cancelled"));
+		exit(-1);
+		return;
 	}
 
-	for (const auto& rule : _suppressedRules) {
-		_sarif.SuppressRule(rule.toStdString());
-		if (QThread::currentThread()->isInterruptionRequested()) {
-			emit errorOccurred(tr("Operation cancelled"));
-			exit(-1);
-			return;
-		}
+	_sizeBudgetPlan = SARIF::SizeBudgetPlan();
+	if (settings.sizeBudget > 0) {
+		_sizeBudgetPlan = sarif.PlanSizeBudget(static_cast<size_t>(settings.sizeBudget));
+		sarif.ApplySizeBudgetPlan(_sizeBudgetPlan);
 	}
 
-	if (_infile == _outfile) {
+	if (settings.infile == settings.outfile) {
 		// Make a backup:
 		try {
-			std::filesystem::copy(_infile.toStdString(), _infile.toStdString() + ".backup");
+			std::filesystem::copy(settings.infile.toStdString(), settings.infile.toStdString() + ".backup");
 		}
 		catch (...) {
-			emit errorOccurred(QString::fromLatin1("Could not make a backup of ") + _infile);
+			emit errorOccurred(QString::fromLatin1("Could not make a backup of ") + settings.infile);
 			exit(-1);
 			return;
 		}
 	}
 
 
+	_writtenFiles.clear();
 	try {
-		_sarif.Export(_outfile.toStdString());
+		std::vector<std::pair<std::string, SARIF::ExportStatistics>> outputs;
+		if (settings.splitMode == SARIF::SplitMode::None && !additionalOutputs.empty()) {
+			// The main output is just one more profile, so everything is filtered in a single pass
+			additionalOutputs.insert(additionalOutputs.begin(), std::make_pair(sarif.Filters(), settings.outfile.toStdString()));
+			auto statistics = sarif.ExportProfiles(additionalOutputs, interruptionRequested);
+			outputs.emplace_back(settings.outfile.toStdString(), statistics.front());
+			additionalOutputs.erase(additionalOutputs.begin());
+		}
+		else {
+			outputs = sarif.ExportSplit(settings.outfile.toStdString(), settings.splitMode, static_cast<size_t>(settings.splitBytes), interruptionRequested);
+			if (!additionalOutputs.empty())
+				sarif.ExportProfiles(additionalOutputs, interruptionRequested);
+		}
+		_exportStatistics = SARIF::ExportStatistics();
+		for (const auto& output : outputs) {
+			_writtenFiles.append(QString::fromStdString(output.first));
+			_exportStatistics.resultsRead = output.second.resultsRead;
+			_exportStatistics.resultsWritten += output.second.resultsWritten;
+			for (const auto& field : output.second.projectedBytes)
+				_exportStatistics.projectedBytes[field.first] += field.second;
+			// Like resultsRead, these are the same for every part of a split
+			_exportStatistics.duplicates = output.second.duplicates;
+			_exportStatistics.unchanged = output.second.unchanged;
+		}
+		for (const auto& output : additionalOutputs)
+			_writtenFiles.append(QString::fromStdString(output.second));
 	}
 	catch (const std::runtime_error& e) {
 		emit errorOccurred(e.what());
@@ -201,10 +866,10 @@ void Cleaner::run()
 		return;
 	}
 	catch (...) {
-		emit errorOccurred(QString::fromLatin1("Failed to export to ") + _outfile);
+		emit errorOccurred(QString::fromLatin1("Failed to export to ") + settings.outfile);
 		exit(-1);
 		return;
 	}
 
-	emit fileWritten(_outfile);
+	emit fileWritten(settings.outfile);
 }
\ No newline at end of file
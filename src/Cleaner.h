@@ -31,7 +31,17 @@
 
 #include "SARIF.h"
 
+#include <memory>
+#include <mutex>
+// <memory> defines __cpp_lib_atomic_shared_ptr when the library has std::atomic<std::shared_ptr>, which some
+// C++20 libraries still lack
+#ifdef __cpp_lib_atomic_shared_ptr
+#include <atomic>
+#endif
+
 class QString;
+class QJsonObject;
+class QIODevice;
 
 /**
 	* \brief A worker class to process the SARIF file
@@ -57,7 +67,8 @@ public:
 
 	/**
 	 * \brief Set the input file
-	 * \param infile Must be a readable file, and is expected to be a SARIF JSON-formatted file.
+	 * \param infile Must be a readable file, and is expected to be a SARIF JSON-formatted file. "-" reads
+	 * from standard input.
 	 * \note If this is not set prior to running the thread, the run will do nothing. Just setting
 	 * it does not execute the thread, you must still call start() (or run(), for asynchronous
 	 * operation).
@@ -72,10 +83,23 @@ public:
 	 * \a infile if that was what was requested.
 	 * \note If outfile is set to something other than "", then executing this thread runs both the
 	 * load and the clean routines. If outfile is unset, or set to "", then only the load is run.
+	 * \note "-" writes to standard output. If either file is "-", no backup is made, and the input is
+	 * filtered as it is read where the filters allow it (see CleanStream()).
 	 */
 	void SetOutfile(const QString &outfile);
 		
 
+	/**
+	 * \brief The most recently loaded data
+	 *
+	 * A snapshot is never modified: each run builds a new one and swaps it in once it is loaded. Callers on
+	 * other threads can hold on to a snapshot for as long as they like, without locking, and without seeing
+	 * a run's partial work. GetRules(), GetFiles(), GetBase() and the counts returned by SuppressRule() and
+	 * AddLocationFilter() all read the current snapshot, so they are safe to call while the thread is running.
+	 * \note Before anything has been loaded, this is an empty SARIF object rather than null.
+	 */
+	std::shared_ptr<const SARIF> Snapshot() const;
+
 	/**
 	 * \brief List the rules present in this SARIF object
 	 * \returns a tuple containing the ID of the rule and its hits count
@@ -137,6 +161,293 @@ public:
 	 */
 	QStringList LocationFilters() const;
 
+	/**
+	 * \brief Suppress the output of results that match a filter expression, e.g. `tags contains cwe-*`
+	 * \param expression The expression, in the syntax described by FilterExpression
+	 * \returns The number of results this filter will remove (independent of any other filter)
+	 * \throws std::runtime_error or std::regex_error if \a expression is not valid, in which case it is not added
+	 */
+	int AddExpressionFilter(const QString& expression);
+
+	/**
+	 * \brief Stop suppression of results matching a filter expression
+	 * \see AddExpressionFilter()
+	 */
+	void RemoveExpressionFilter(const QString& expression);
+
+	/**
+	 * \brief Get the list of currently-active expression filters
+	 */
+	QStringList ExpressionFilters() const;
+
+	/**
+	 * \brief Suppress the output of results below a level, or with a rank below a minimum
+	 * \returns The number of results this threshold will remove (independent of any other filter)
+	 * \see SARIF::SetThreshold()
+	 */
+	int SetThreshold(SARIF::Level minimumLevel, int minimumRank);
+
+	/**
+	 * \brief The number of results SetThreshold() would remove from the loaded file, without changing the filters
+	 * \see SARIF::ThresholdHits()
+	 */
+	int ThresholdHits(SARIF::Level minimumLevel, int minimumRank) const;
+
+	/**
+	 * \brief Only keep the results on the lines in \a ranges, e.g. the lines changed by a pull request
+	 * \param ranges The ranges to keep, or nullptr to keep every line
+	 */
+	void SetLineRanges(std::shared_ptr<const LineRanges> ranges);
+
+	/**
+	 * \brief Suppress every rule and add every location and expression filter of \a profile in one go, e.g. when
+	 * loading a saved filter file
+	 *
+	 * Filters that are already present are not added twice. The base, pruning and projection settings of
+	 * \a profile are not used.
+	 * \returns The number of results each filter removes on its own, the rules first, then the location filters and
+	 * then the expression filters, in the order of \a profile
+	 * \throws std::regex_error or std::runtime_error if one of the filters is not valid, in which case no filter is
+	 * added
+	 * \see SARIF::FilterHits()
+	 */
+	std::vector<int> ApplyFilterProfile(const SARIF::FilterProfile& profile);
+
+	/**
+	 * \brief Drop rule descriptors that none of the exported results refer to
+	 * \param prune If true, the output file only contains the rules used by the results that survive filtering
+	 */
+	void SetPruneRules(bool prune);
+
+	/**
+	 * \brief Only export the first of the results that have the same fingerprint
+	 * \param deduplicate If true, later results with the fingerprint of an exported result are removed
+	 * \see SARIF::FingerprintOf()
+	 */
+	void SetDeduplicate(bool deduplicate);
+
+	/**
+	 * \brief Only export the results that are not in an earlier report, e.g. the results new since the last release
+	 * \param baseline The fingerprints of the earlier report's results, or nullptr to export every result
+	 * \see LoadBaseline()
+	 */
+	void SetBaseline(std::shared_ptr<const FingerprintSet> baseline);
+
+	/**
+	 * \brief Remove parts of each result from the output file
+	 * \param mode Whether \a paths lists the data to keep, or the data to drop
+	 * \param paths The paths within each result object, using "/" as the separator
+	 * \see SARIF::SetResultProjection()
+	 */
+	void SetResultProjection(SARIF::ProjectionMode mode, const QStringList& paths);
+
+	/**
+	 * \brief Get the statistics from the most recent export
+	 * \note Only meaningful after the fileWritten() signal has been emitted
+	 */
+	SARIF::ExportStatistics GetExportStatistics() const;
+
+	/**
+	 * \brief Work out which rules and directories to remove so the output fits in \a budget bytes
+	 * \see SARIF::PlanSizeBudget()
+	 */
+	SARIF::SizeBudgetPlan PlanSizeBudget(qint64 budget) const;
+
+	/**
+	 * \brief Find the current filters that overlap, duplicate each other or match nothing in the loaded file
+	 * \throws std::regex_error if one of the file filters is not a valid regular expression
+	 * \see SARIF::AnalyzeFilters()
+	 */
+	SARIF::FilterAnalysis AnalyzeFilters(size_t similarity = 5) const;
+
+	/**
+	 * \brief A plain-text report of \a analysis, listing the dead, redundant and similar filters
+	 */
+	static QString DescribeFilterAnalysis(const SARIF::FilterAnalysis& analysis);
+
+	/**
+	 * \brief The overlap matrix of \a analysis as CSV, with a header row and column naming each filter
+	 */
+	static QString FilterOverlapCsv(const SARIF::FilterAnalysis& analysis);
+
+	/**
+	 * \brief Create a location filter regex that removes the files directly inside \a directory
+	 * \see SARIF::DirectoryFilter()
+	 */
+	QString DirectoryFilter(const QString& directory) const;
+
+	/**
+	 * \brief Automatically remove rules and directories until the output fits in \a budget bytes
+	 * \param budget The maximum output size in bytes, or 0 to write everything that passes the filters
+	 * \note The choices that were made are available from GetSizeBudgetPlan() once the file is written
+	 */
+	void SetSizeBudget(qint64 budget);
+
+	/**
+	 * \brief The plan applied by the most recent run, if a size budget was set
+	 */
+	SARIF::SizeBudgetPlan GetSizeBudgetPlan() const;
+
+	/**
+	 * \brief Write the output as several files instead of one
+	 * \param mode How to divide the results between files. SARIF::SplitMode::None writes the single outfile.
+	 * \param maximumBytes The approximate maximum size of each file when splitting by size
+	 * \see SARIF::ExportSplit()
+	 */
+	void SetSplitOutput(SARIF::SplitMode mode, qint64 maximumBytes);
+
+	/**
+	 * \brief The files written by the most recent run
+	 */
+	QStringList GetWrittenFiles() const;
+
+	/**
+	 * \brief Reload the input incrementally when it is the same file the previous run loaded
+	 * \param incremental If true, a run that loads the same input file as the last one reuses the index entries
+	 * of the results that have not changed, so that re-cleaning a report that has only been appended to just
+	 * indexes the new results. Used by watch mode.
+	 * \see SARIF::Reload()
+	 */
+	void SetIncrementalReload(bool incremental);
+
+	/**
+	 * \brief The number of results whose index entries the most recent run reused from the run before
+	 */
+	size_t GetReusedResults() const;
+
+	/**
+	 * \brief Replace all of the filter settings with those in \a profile
+	 * \note Unlike SuppressRule() and AddLocationFilter(), this does not need a file to have been loaded
+	 * \see LoadFilterProfile()
+	 */
+	void SetFilterProfile(const SARIF::FilterProfile& profile);
+
+	/**
+	 * \brief The filter settings that the next run will use, as a profile
+	 * \see SetFilterProfile()
+	 */
+	SARIF::FilterProfile GetFilterProfile() const;
+
+	/**
+	 * \brief Write further output files, each with its own filters, from the same load of the input
+	 * \param outputs Pairs of filter profile and output filename. The profiles are independent of the
+	 * filters set on this object, and of each other.
+	 * \note Unless the main output is split, it is filtered in the same pass as these outputs and all of
+	 * the files are written concurrently.
+	 * \see SARIF::ExportProfiles()
+	 */
+	void SetAdditionalOutputs(const std::vector<std::pair<SARIF::FilterProfile, QString>>& outputs);
+
+	/**
+	 * \brief Read a filter profile from a filter file saved by the GUI
+	 * \param filename The JSON filter file
+	 * \throws std::runtime_error if the file cannot be read or is not a supported version
+	 */
+	static SARIF::FilterProfile LoadFilterProfile(const QString& filename);
+
+	/**
+	 * \brief Read the fingerprints of the results in a SARIF file, without loading the file, for SetBaseline()
+	 * \throws std::runtime_error if the file cannot be read or is not SARIF
+	 * \see SARIFStreamFilter::Fingerprints()
+	 */
+	static std::shared_ptr<const FingerprintSet> LoadBaseline(const QString& filename);
+
+	/**
+	 * \brief Read a filter profile from the "xdata" object of a saved filter file
+	 * \param data An object with the optional keys basePath, ruleFilters, fileFilters, expressionFilters, threshold
+	 * (an object with a \a level name and a \a rank), lineRanges (in the form read by LineRanges::FromJson()),
+	 * pruneRules, deduplicate and projection
+	 * \throws std::runtime_error if the threshold level is not a SARIF level, or the line ranges are not valid
+	 */
+	static SARIF::FilterProfile FilterProfileFromJson(const QJsonObject& data);
+
+	/**
+	 * \brief Clean SARIF data from one open device to another, such as standard input to standard output
+	 *
+	 * If \a profile can be applied to a stream (see SARIFStreamFilter::CanStream()), memory use is
+	 * bounded by the largest single result and output begins before the input has finished arriving.
+	 * Otherwise the whole input is loaded first, and written with SARIF::Export().
+	 * \throws std::runtime_error on failure, in which case some output may have been written
+	 */
+	static SARIF::ExportStatistics CleanStream(QIODevice& input, QIODevice& output, const SARIF::FilterProfile& profile,
+		std::function<bool(void)> interruptionRequested = []() {return false; });
+
+	/**
+	 * \brief Merge many SARIF files into one, combining the runs of each tool and applying \a profile to every result
+	 * \param infiles The files to merge, in the order their results are written
+	 * \param output Where to write the merged report
+	 * \throws std::runtime_error if \a profile cannot be applied to a stream, an input cannot be read, or on a write
+	 * error, in which case some output may have been written
+	 * \see SARIFStreamFilter::Merge()
+	 */
+	static SARIF::ExportStatistics Merge(const QStringList& infiles, QIODevice& output, const SARIF::FilterProfile& profile,
+		std::function<bool(void)> interruptionRequested = []() {return false; });
+
+	/**
+	 * \brief Give \a newBase the same trailing separator as \a oldBase, so it can replace it
+	 */
+	static QString AdjustBase(const QString& oldBase, const QString& newBase);
+
+	/**
+	 * \brief The outcome of cleaning one file in a batch
+	 */
+	struct BatchFileResult {
+		QString infile;
+		QString outfile;
+		qint64 bytesRead = 0;
+		double seconds = 0.0;              ///< Time taken to load, filter and write this file
+		SARIF::ExportStatistics statistics;
+		QString error;                     ///< Empty on success
+	};
+
+	/**
+	 * \brief The outcome of CleanBatch()
+	 */
+	struct BatchSummary {
+		std::vector<BatchFileResult> files; ///< In the same order as the input list
+		qint64 bytesRead = 0;
+		double seconds = 0.0;               ///< Wall-clock time for the whole batch
+		int failures = 0;
+
+		/**
+		 * \brief The overall throughput, in megabytes of input per second
+		 */
+		double MegabytesPerSecond() const;
+	};
+
+	/**
+	 * \brief Find the SARIF files to process in a batch
+	 * \param pattern Either a directory, in which case every *.sarif file in it is used, or a path
+	 * whose file name is a wildcard pattern such as "reports/module_*.sarif".
+	 * \returns The absolute paths of the files, sorted by name
+	 */
+	static QStringList ExpandBatchInputs(const QString& pattern);
+
+	/**
+	 * \brief Where CleanBatch() writes each of \a infiles
+	 *
+	 * Each output keeps the input's path relative to the deepest directory that holds all of the inputs, so inputs
+	 * with the same name in different directories are written to different subdirectories of \a outputDirectory.
+	 * If the same input is listed more than once, the later copies get a numbered suffix.
+	 */
+	static QStringList BatchOutputs(const QStringList& infiles, const QString& outputDirectory);
+
+	/**
+	 * \brief Clean many files with the same filters, several at a time
+	 * \param infiles The files to clean
+	 * \param outputDirectory Where to write the cleaned files, which keep their names, as described by
+	 * BatchOutputs(). If this is the directory the inputs are in, each input is backed up before being overwritten,
+	 * and an input whose backup already exists fails rather than replacing it.
+	 * \param profile The filters to apply to every file. They are compiled once and shared by all workers.
+	 * \param threads The number of files to work on at once, or 0 for one per hardware thread
+	 * \param interruptionRequested Checked between and during files; remaining files are reported as cancelled
+	 * \note Failures are reported per file and do not stop the rest of the batch.
+	 * \throws std::runtime_error if one of the filters is not valid, before any file is read
+	 * \see BatchOutputs()
+	 */
+	static BatchSummary CleanBatch(const QStringList& infiles, const QString& outputDirectory, SARIF::FilterProfile profile,
+		unsigned int threads = 0, std::function<bool(void)> interruptionRequested = []() {return false; });
+
 	/**
 		* \brief This function is generally not called directly, but is run on its own thread by calling
 		* the `start()` function on the Cleaner object.
@@ -163,15 +474,75 @@ signals:
 
 private:
 
+	/**
+	 * \brief Everything a run reads from the settings, copied together when it starts
+	 */
+	struct RunSettings {
+		QString infile;
+		QString outfile;
+		SARIF::FilterProfile profile;
+		std::vector<std::pair<SARIF::FilterProfile, QString>> additionalOutputs;
+		qint64 sizeBudget = 0;
+		SARIF::SplitMode splitMode = SARIF::SplitMode::None;
+		qint64 splitBytes = 0;
+		bool incrementalReload = false;
+	};
+
+	/**
+	 * \brief Copy the settings for a run under \a _filtersMutex
+	 */
+	RunSettings GetRunSettings() const;
+
+	/**
+	 * \brief The filter settings as a profile
+	 * \pre \a _filtersMutex is held
+	 */
+	SARIF::FilterProfile CurrentProfile() const;
+
+	void runPipe(const RunSettings& settings);
+
+	/**
+	 * \brief Make \a snapshot the current data, atomically replacing the previous one
+	 */
+	void Publish(std::shared_ptr<const SARIF> snapshot);
+
 	QString _infile;
 	QString _outfile;
 
 	QStringList _suppressedRules;
 	QStringList _fileFilters;
+	QStringList _expressionFilters;
+	SARIF::Level _minimumLevel = SARIF::Level::None;
+	int _minimumRank = 0;
+	std::shared_ptr<const LineRanges> _lineRanges;
 	QString _newBase;
 	bool _overrideBase = false;
+	bool _pruneRules = false;
+	bool _deduplicate = false;
+	std::shared_ptr<const FingerprintSet> _baseline;
+	SARIF::ProjectionMode _projectionMode = SARIF::ProjectionMode::None;
+	QStringList _projectionPaths;
+	qint64 _sizeBudget = 0;
+	SARIF::SplitMode _splitMode = SARIF::SplitMode::None;
+	qint64 _splitBytes = 0;
+	QStringList _writtenFiles;
+	std::vector<std::pair<SARIF::FilterProfile, QString>> _additionalOutputs;
+	bool _incrementalReload = false;
+	QString _loadedFile;     ///< The file currently in \a _sarif, if it was loaded completely
+	size_t _reusedResults = 0;
+	std::vector<std::string> _compiledFilterSource;
+	std::shared_ptr<const std::vector<std::regex>> _compiledFilters;
+	std::vector<std::string> _compiledExpressionSource;
+	std::shared_ptr<const std::vector<FilterExpression>> _compiledExpressions;
 
-	SARIF _sarif;
+#ifdef __cpp_lib_atomic_shared_ptr
+	std::atomic<std::shared_ptr<const SARIF>> _snapshot;
+#else
+	std::shared_ptr<const SARIF> _snapshot; ///< Only accessed through std::atomic_load() and std::atomic_store()
+#endif
+	mutable std::mutex _filtersMutex;       ///< Guards everything the setters write, as the GUI edits them during runs
+	SARIF::ExportStatistics _exportStatistics;
+	SARIF::SizeBudgetPlan _sizeBudgetPlan;
 };
 
 #endif // _CLEANSARIF_CLEANER_H_
\ No newline at end of file
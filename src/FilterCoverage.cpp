@@ -0,0 +1,123 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "FilterCoverage.h"
+
+#include <stdexcept>
+#include <limits>
+
+FilterCoverage::FilterCoverage(size_t results) :
+	_coverage(results, 0),
+	_owners(results, 0)
+{
+}
+
+int FilterCoverage::Add(ResultBitmap matches)
+{
+	// Check everything first, so that a bad filter leaves the counts as they were
+	matches.ForEach([this](uint32_t result) {
+		if (result >= _coverage.size())
+			throw std::out_of_range("Filter matches a result that is not in the report");
+		if (_coverage[result] == std::numeric_limits<uint16_t>::max())
+			throw std::overflow_error("Too many filters match the same result");
+	});
+
+	const auto handle = static_cast<uint32_t>(_filters.size());
+	_filters.emplace_back();
+	auto& filter = _filters.back();
+	filter.matches = std::move(matches);
+	filter.active = true;
+
+	filter.matches.ForEach([this, handle, &filter](uint32_t result) {
+		auto& coverage = _coverage[result];
+		if (coverage == 0)
+			++_removed;
+		else if (coverage == 1)
+			--_filters[_owners[result]].marginal; // No longer the only filter that removes it
+		++coverage;
+		_owners[result] ^= handle;
+		if (coverage == 1)
+			++filter.marginal;
+	});
+	return static_cast<int>(handle);
+}
+
+void FilterCoverage::Remove(int filter)
+{
+	if (filter < 0 || filter >= static_cast<int>(_filters.size()) || !_filters[filter].active)
+		return;
+	auto& removed = _filters[filter];
+	removed.matches.ForEach([this, filter](uint32_t result) {
+		auto& coverage = _coverage[result];
+		--coverage;
+		_owners[result] ^= static_cast<uint32_t>(filter);
+		if (coverage == 0)
+			--_removed;
+		else if (coverage == 1)
+			++_filters[_owners[result]].marginal; // The one filter left now removes it alone
+	});
+	removed = Filter();
+}
+
+size_t FilterCoverage::Results() const
+{
+	return _coverage.size();
+}
+
+size_t FilterCoverage::Removed() const
+{
+	return _removed;
+}
+
+size_t FilterCoverage::Remaining() const
+{
+	return _coverage.size() - _removed;
+}
+
+size_t FilterCoverage::Matches(int filter) const
+{
+	if (filter < 0 || filter >= static_cast<int>(_filters.size()))
+		return 0;
+	return _filters[filter].matches.Count();
+}
+
+size_t FilterCoverage::Marginal(int filter) const
+{
+	if (filter < 0 || filter >= static_cast<int>(_filters.size()))
+		return 0;
+	return _filters[filter].marginal;
+}
+
+bool FilterCoverage::IsRemoved(size_t result) const
+{
+	return _coverage[result] > 0;
+}
+
+ResultBitmap FilterCoverage::Union() const
+{
+	ResultBitmap all;
+	for (const auto& filter : _filters) {
+		if (filter.active)
+			all |= filter.matches;
+	}
+	return all;
+}
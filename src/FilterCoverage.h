@@ -0,0 +1,109 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CLEANSARIF_FILTERCOVERAGE_H_
+#define _CLEANSARIF_FILTERCOVERAGE_H_
+
+#include "ResultBitmap.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * \brief The combined effect of a changing set of filters, kept up to date one filter at a time
+ *
+ * Each filter is the set of result ids it removes. For every result the number of filters that match it is kept,
+ * along with the XOR of those filters' handles, which is the handle of the only match when there is just one. So
+ * adding or removing a filter only touches the results it matches, and updates the total number of results
+ * removed and every filter's marginal count (the results that no other filter removes) without looking at the rest.
+ */
+class FilterCoverage {
+
+public:
+
+	/**
+	 * \brief Start with no filters, for a report with \a results results
+	 */
+	explicit FilterCoverage(size_t results = 0);
+
+	/**
+	 * \brief Add a filter that removes \a matches
+	 * \returns A handle for the filter, for Remove(), Matches() and Marginal()
+	 */
+	int Add(ResultBitmap matches);
+
+	/**
+	 * \brief Remove a filter that was added earlier. Unknown handles are ignored.
+	 */
+	void Remove(int filter);
+
+	/**
+	 * \brief The number of results in the report
+	 */
+	size_t Results() const;
+
+	/**
+	 * \brief The number of results at least one filter removes
+	 */
+	size_t Removed() const;
+
+	/**
+	 * \brief The number of results no filter removes
+	 */
+	size_t Remaining() const;
+
+	/**
+	 * \brief The number of results \a filter matches, whatever the other filters do
+	 */
+	size_t Matches(int filter) const;
+
+	/**
+	 * \brief The number of results only \a filter removes: the results that removing it would bring back
+	 */
+	size_t Marginal(int filter) const;
+
+	/**
+	 * \brief Whether any filter removes \a result
+	 */
+	bool IsRemoved(size_t result) const;
+
+	/**
+	 * \brief Every result that at least one filter removes
+	 */
+	ResultBitmap Union() const;
+
+private:
+
+	struct Filter {
+		ResultBitmap matches;
+		size_t marginal = 0;
+		bool active = false;
+	};
+
+	std::vector<Filter> _filters;    ///< By handle. Removed filters leave an inactive entry, so handles stay valid.
+	std::vector<uint16_t> _coverage; ///< By result, the number of filters that match it
+	std::vector<uint32_t> _owners;   ///< By result, the XOR of the handles of the filters that match it
+	size_t _removed = 0;
+};
+
+#endif // _CLEANSARIF_FILTERCOVERAGE_H_
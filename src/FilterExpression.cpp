@@ -0,0 +1,476 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "FilterExpression.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cctype>
+
+class FilterExpression::Parser {
+
+public:
+
+	Parser(const std::string& text, FilterExpression& expression) :
+		_text(text),
+		_expression(expression)
+	{
+		Advance();
+	}
+
+	void Parse()
+	{
+		ParseOr();
+		if (_token.kind != Token::Kind::End)
+			Fail("expected \"and\", \"or\" or the end of the expression");
+	}
+
+private:
+
+	[[noreturn]] void Fail(const std::string& problem) const
+	{
+		Fail(problem, _token.position);
+	}
+
+	[[noreturn]] static void Fail(const std::string& problem, size_t position)
+	{
+		throw std::runtime_error("Invalid filter expression at position " + std::to_string(position + 1) + ": " + problem);
+	}
+
+	static bool IsWordCharacter(char c)
+	{
+		return !std::isspace(static_cast<unsigned char>(c)) && std::string("()\"!&|=<>").find(c) == std::string::npos;
+	}
+
+	void Advance()
+	{
+		while (_position < _text.size() && std::isspace(static_cast<unsigned char>(_text[_position])))
+			++_position;
+		_token = Token();
+		_token.position = _position;
+		if (_position >= _text.size())
+			return;
+
+		const char c = _text[_position];
+		if (c == '"') {
+			_token.kind = Token::Kind::String;
+			++_position;
+			while (_position < _text.size() && _text[_position] != '"') {
+				if (_text[_position] == '\\' && _position + 1 < _text.size())
+					++_position;
+				_token.text += _text[_position++];
+			}
+			if (_position >= _text.size())
+				Fail("unterminated string");
+			++_position;
+			return;
+		}
+		if (IsWordCharacter(c)) {
+			_token.kind = Token::Kind::Word;
+			while (_position < _text.size() && IsWordCharacter(_text[_position]))
+				_token.text += _text[_position++];
+			return;
+		}
+		static const std::vector<std::string> symbols = { "&&", "||", "==", "!=", "<=", ">=", "(", ")", "!", "<", ">" };
+		for (const auto& symbol : symbols) {
+			if (_text.compare(_position, symbol.size(), symbol) == 0) {
+				_token.kind = Token::Kind::Symbol;
+				_token.text = symbol;
+				_position += symbol.size();
+				return;
+			}
+		}
+		Fail(std::string("unexpected '") + c + "'");
+	}
+
+	static std::string Lower(std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return text;
+	}
+
+	bool IsKeyword(const char* keyword) const
+	{
+		return _token.kind == Token::Kind::Word && Lower(_token.text) == keyword;
+	}
+
+	bool IsSymbol(const char* symbol) const
+	{
+		return _token.kind == Token::Kind::Symbol && _token.text == symbol;
+	}
+
+	uint32_t AddNode(Node node)
+	{
+		_expression._nodes.push_back(std::move(node));
+		return static_cast<uint32_t>(_expression._nodes.size() - 1);
+	}
+
+	uint32_t AddPredicate(Predicate predicate, bool negate = false)
+	{
+		Node leaf;
+		leaf.predicate = static_cast<uint32_t>(_expression._predicates.size());
+		_expression._predicates.push_back(std::move(predicate));
+		auto id = AddNode(std::move(leaf));
+		if (!negate)
+			return id;
+		Node inverse;
+		inverse.kind = Node::Kind::Not;
+		inverse.children.push_back(id);
+		return AddNode(std::move(inverse));
+	}
+
+	uint32_t ParseOr()
+	{
+		Node node;
+		node.kind = Node::Kind::Or;
+		node.children.push_back(ParseAnd());
+		while (IsKeyword("or") || IsSymbol("||")) {
+			Advance();
+			node.children.push_back(ParseAnd());
+		}
+		if (node.children.size() == 1)
+			return node.children.front();
+		return AddNode(std::move(node));
+	}
+
+	uint32_t ParseAnd()
+	{
+		Node node;
+		node.kind = Node::Kind::And;
+		node.children.push_back(ParseUnary());
+		while (IsKeyword("and") || IsSymbol("&&")) {
+			Advance();
+			node.children.push_back(ParseUnary());
+		}
+		if (node.children.size() == 1)
+			return node.children.front();
+		return AddNode(std::move(node));
+	}
+
+	uint32_t ParseUnary()
+	{
+		if (IsKeyword("not") || IsSymbol("!")) {
+			Advance();
+			Node node;
+			node.kind = Node::Kind::Not;
+			node.children.push_back(ParseUnary());
+			return AddNode(std::move(node));
+		}
+		if (IsSymbol("(")) {
+			Advance();
+			auto inner = ParseOr();
+			if (!IsSymbol(")"))
+				Fail("expected ')'");
+			Advance();
+			return inner;
+		}
+		return ParsePredicate();
+	}
+
+	std::string ParseValue()
+	{
+		if (_token.kind != Token::Kind::Word && _token.kind != Token::Kind::String)
+			Fail("expected a value");
+		auto value = _token.text;
+		Advance();
+		return value;
+	}
+
+	uint32_t ParsePredicate()
+	{
+		if (_token.kind != Token::Kind::Word)
+			Fail("expected one of rule, file, tags, level or line");
+		const auto fieldPosition = _token.position;
+		auto field = Lower(_token.text);
+		Advance();
+
+		Predicate predicate;
+		if (field == "rule" || field == "file" || field == "uri") {
+			predicate.field = field == "rule" ? Field::Rule : Field::Uri;
+			if (IsKeyword("matches")) {
+				Advance();
+				predicate.text = ParseValue();
+				predicate.regex = std::make_shared<const std::regex>(predicate.text);
+				return AddPredicate(std::move(predicate));
+			}
+			bool negate = IsSymbol("!=");
+			if (!negate && !IsSymbol("=="))
+				Fail("expected ==, != or matches");
+			Advance();
+			predicate.text = ParseValue();
+			return AddPredicate(std::move(predicate), negate);
+		}
+		if (field == "tags" || field == "tag") {
+			if (!IsKeyword("contains"))
+				Fail("expected contains");
+			Advance();
+			predicate.field = Field::Tag;
+			predicate.text = ParseValue();
+			return AddPredicate(std::move(predicate));
+		}
+		if (field == "level" || field == "line") {
+			const bool level = field == "level";
+			predicate.field = level ? Field::Level : Field::Line;
+			const uint32_t maximum = level ? 3 : std::numeric_limits<uint32_t>::max();
+			auto value = [this, level]() {
+				auto position = _token.position;
+				auto text = ParseValue();
+				return level ? LevelValue(text, position) : LineValue(text, position);
+			};
+
+			if (IsKeyword("in")) {
+				Advance();
+				auto position = _token.position;
+				auto range = ParseValue();
+				auto dots = range.find("..");
+				if (dots == std::string::npos)
+					Fail("expected a range such as 1..20", position);
+				predicate.low = level ? LevelValue(range.substr(0, dots), position) : LineValue(range.substr(0, dots), position);
+				predicate.high = level ? LevelValue(range.substr(dots + 2), position) : LineValue(range.substr(dots + 2), position);
+				return AddPredicate(std::move(predicate));
+			}
+
+			if (_token.kind != Token::Kind::Symbol || _token.text == "(" || _token.text == ")" || _token.text == "!" ||
+				_token.text == "&&" || _token.text == "||")
+				Fail("expected a comparison or in");
+			auto comparison = _token.text;
+			Advance();
+			auto bound = value();
+			bool negate = false;
+			if (comparison == "==" || comparison == "!=") {
+				predicate.low = predicate.high = bound;
+				negate = comparison == "!=";
+			}
+			else if (comparison == "<") {
+				// Nothing is less than zero: an empty range
+				predicate.low = bound == 0 ? 1 : 0;
+				predicate.high = bound == 0 ? 0 : bound - 1;
+			}
+			else if (comparison == "<=") {
+				predicate.high = bound;
+			}
+			else if (comparison == ">") {
+				predicate.low = bound == maximum ? maximum : bound + 1;
+				predicate.high = bound == maximum ? maximum - 1 : maximum;
+			}
+			else {
+				predicate.low = bound;
+				predicate.high = maximum;
+			}
+			return AddPredicate(std::move(predicate), negate);
+		}
+		Fail("expected one of rule, file, tags, level or line", fieldPosition);
+	}
+
+	uint32_t LevelValue(const std::string& text, size_t position) const
+	{
+		static const std::vector<std::string> names = { "none", "note", "warning", "error" };
+		auto name = std::find(names.begin(), names.end(), Lower(text));
+		if (name == names.end())
+			Fail("expected none, note, warning or error", position);
+		return static_cast<uint32_t>(name - names.begin());
+	}
+
+	uint32_t LineValue(const std::string& text, size_t position) const
+	{
+		if (text.empty() || text.size() > 10 || !std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isdigit(c); }) ||
+			std::stoull(text) > std::numeric_limits<uint32_t>::max())
+			Fail("expected a line number", position);
+		return static_cast<uint32_t>(std::stoull(text));
+	}
+
+	const std::string& _text;
+	FilterExpression& _expression;
+	size_t _position = 0;
+	Token _token;
+};
+
+FilterExpression::FilterExpression(const std::string& text) :
+	_text(text)
+{
+	Parser(_text, *this).Parse();
+}
+
+const std::string& FilterExpression::Text() const
+{
+	return _text;
+}
+
+const std::vector<FilterExpression::Predicate>& FilterExpression::Predicates() const
+{
+	return _predicates;
+}
+
+bool FilterExpression::MatchesTag(const std::string& pattern, const std::string& tag)
+{
+	// Iterative wildcard match, backtracking only to the most recent '*'
+	auto glob = [&pattern](const std::string& text, size_t start) {
+		size_t p = 0;
+		size_t t = start;
+		size_t star = std::string::npos;
+		size_t resume = 0;
+		while (t < text.size()) {
+			if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
+				++p;
+				++t;
+			}
+			else if (p < pattern.size() && pattern[p] == '*') {
+				star = p++;
+				resume = t;
+			}
+			else if (star != std::string::npos) {
+				p = star + 1;
+				t = ++resume;
+			}
+			else {
+				return false;
+			}
+		}
+		while (p < pattern.size() && pattern[p] == '*')
+			++p;
+		return p == pattern.size();
+	};
+	if (glob(tag, 0))
+		return true;
+	auto slash = tag.find_last_of('/');
+	return pattern.find('/') == std::string::npos && slash != std::string::npos && glob(tag, slash + 1);
+}
+
+std::string FilterExpression::Quote(const std::string& value)
+{
+	std::string quoted = "\"";
+	for (auto c : value) {
+		if (c == '"' || c == '\\')
+			quoted += '\\';
+		quoted += c;
+	}
+	return quoted + "\"";
+}
+
+size_t FilterExpression::Program::Size() const
+{
+	return _code.size();
+}
+
+double FilterExpression::Probability(uint32_t node, const std::vector<double>& selectivity) const
+{
+	const auto& n = _nodes[node];
+	switch (n.kind) {
+	case Node::Kind::Predicate:
+		return selectivity[n.predicate];
+	case Node::Kind::Not:
+		return 1.0 - Probability(n.children.front(), selectivity);
+	case Node::Kind::And: {
+		double probability = 1.0;
+		for (auto child : n.children)
+			probability *= Probability(child, selectivity);
+		return probability;
+	}
+	default: {
+		double none = 1.0;
+		for (auto child : n.children)
+			none *= 1.0 - Probability(child, selectivity);
+		return 1.0 - none;
+	}
+	}
+}
+
+uint32_t FilterExpression::Leaves(uint32_t node) const
+{
+	const auto& n = _nodes[node];
+	if (n.kind == Node::Kind::Predicate)
+		return 1;
+	uint32_t leaves = 0;
+	for (auto child : n.children)
+		leaves += Leaves(child);
+	return leaves;
+}
+
+void FilterExpression::Emit(uint32_t node, uint32_t start, uint32_t onTrue, uint32_t onFalse, const std::vector<double>& selectivity,
+	Program& program) const
+{
+	const auto& n = _nodes[node];
+	if (n.kind == Node::Kind::Predicate) {
+		const auto& predicate = _predicates[n.predicate];
+		auto& instruction = program._code[start];
+		switch (predicate.field) {
+		case Field::Rule:
+		case Field::Tag:
+			instruction.column = Program::Column::Rule;
+			break;
+		case Field::Uri:
+			instruction.column = Program::Column::Uri;
+			break;
+		case Field::Level:
+			instruction.column = Program::Column::Level;
+			break;
+		default:
+			instruction.column = Program::Column::Line;
+			break;
+		}
+		instruction.low = (predicate.field == Field::Level || predicate.field == Field::Line) ? predicate.low : n.predicate;
+		instruction.high = predicate.high;
+		instruction.onTrue = onTrue;
+		instruction.onFalse = onFalse;
+		return;
+	}
+	if (n.kind == Node::Kind::Not) {
+		Emit(n.children.front(), start, onFalse, onTrue, selectivity, program);
+		return;
+	}
+
+	// Put the operand most likely to decide the outcome first
+	const bool conjunction = n.kind == Node::Kind::And;
+	std::vector<std::pair<double, uint32_t>> children;
+	for (auto child : n.children)
+		children.emplace_back(Probability(child, selectivity), child);
+	std::stable_sort(children.begin(), children.end(), [conjunction](const auto& a, const auto& b) {
+		return conjunction ? a.first < b.first : a.first > b.first;
+	});
+
+	uint32_t position = start;
+	for (size_t child = 0; child < children.size(); ++child) {
+		const auto leaves = Leaves(children[child].second);
+		const bool last = child + 1 == children.size();
+		const uint32_t next = position + leaves;
+		if (conjunction)
+			Emit(children[child].second, position, last ? onTrue : next, onFalse, selectivity, program);
+		else
+			Emit(children[child].second, position, onTrue, last ? onFalse : next, selectivity, program);
+		position = next;
+	}
+}
+
+FilterExpression::Program FilterExpression::Compile(std::vector<std::vector<bool>> tables, const std::vector<double>& selectivity) const
+{
+	if (tables.size() < _predicates.size() || selectivity.size() < _predicates.size())
+		throw std::invalid_argument("A table and a selectivity are needed for every predicate of the expression");
+
+	Program program;
+	for (auto& table : tables)
+		program._tables.emplace_back(table.begin(), table.end());
+	program._code.resize(Leaves(static_cast<uint32_t>(_nodes.size() - 1)));
+	Emit(static_cast<uint32_t>(_nodes.size() - 1), 0, Program::MatchFound, Program::NoMatch, selectivity, program);
+	return program;
+}
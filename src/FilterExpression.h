@@ -0,0 +1,227 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CLEANSARIF_FILTEREXPRESSION_H_
+#define _CLEANSARIF_FILTEREXPRESSION_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <regex>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * \brief A filter written as a boolean expression over a result's rule, file, tags, level and line
+ *
+ * For example `level == note && line in 1..20`, `tags contains cwe-*` or `rule matches "^V5" and not file matches
+ * "/tests/"`. Predicates are combined with `and`/`&&`, `or`/`||`, `not`/`!` and parentheses:
+ *
+ * - `rule == ID`, `rule != ID`, `rule matches REGEX`
+ * - `file == URI`, `file != URI`, `file matches REGEX` (`uri` is a synonym for `file`)
+ * - `tags contains PATTERN`, where the rule's descriptor has a tag matching PATTERN. `*` and `?` are wildcards, and a
+ *   pattern with no `/` is also tried against the last component of each tag, so `cwe-*` matches `external/cwe/cwe-190`.
+ * - `level OP NAME`, where OP is one of `==`, `!=`, `<`, `<=`, `>`, `>=` and NAME is `none`, `note`, `warning` or `error`
+ * - `line OP NUMBER` and `line in FIRST..LAST`, on the start line of the result's first location
+ *
+ * Values that contain spaces or any of `()"!&|=<>` are written in double quotes, with `\"` and `\\` escapes.
+ *
+ * The expression is parsed once. Compile() then turns it into a short program for one report, in which every
+ * predicate is a single lookup in one of the report's per-result columns.
+ */
+class FilterExpression {
+
+public:
+
+	/// The part of a result a predicate looks at
+	enum class Field : uint8_t {
+		Rule,  ///< The rule ID
+		Uri,   ///< The artifact URI of the first location
+		Tag,   ///< The tags of the rule's descriptor
+		Level, ///< The severity, in the order of SARIF::Level
+		Line   ///< The start line of the first location
+	};
+
+	/// A single test. Negation, including `!=`, is part of the expression's tree rather than the predicate.
+	struct Predicate {
+		Field field = Field::Rule;
+		std::string text;                          ///< The rule ID, URI, regular expression or tag pattern
+		std::shared_ptr<const std::regex> regex;   ///< For `matches`, \a text compiled; otherwise null
+		uint32_t low = 0;                          ///< For Level and Line, the smallest value that matches
+		uint32_t high = 0;                         ///< For Level and Line, the largest value that matches
+	};
+
+	/**
+	 * \brief Parse \a text
+	 * \throws std::runtime_error if \a text is not a valid expression, giving the position of the problem
+	 * \throws std::regex_error if one of its regular expressions is invalid
+	 */
+	explicit FilterExpression(const std::string& text);
+
+	/**
+	 * \brief The expression as it was written
+	 */
+	const std::string& Text() const;
+
+	/**
+	 * \brief Every predicate in the expression, in the order they were written
+	 */
+	const std::vector<Predicate>& Predicates() const;
+
+	/**
+	 * \brief Whether \a tag matches the pattern of a `tags contains` predicate
+	 */
+	static bool MatchesTag(const std::string& pattern, const std::string& tag);
+
+	/**
+	 * \brief \a value as a quoted string, for building an expression from arbitrary text
+	 */
+	static std::string Quote(const std::string& value);
+
+	/**
+	 * \brief The per-result columns of a report that a compiled expression reads, each indexed by result id
+	 */
+	struct Columns {
+		const uint32_t* rule = nullptr;  ///< The position of the result's rule among the report's distinct rules
+		const uint32_t* uri = nullptr;   ///< The position of the result's URI among the report's distinct URIs
+		const uint32_t* line = nullptr;  ///< The start line
+		const uint8_t* level = nullptr;  ///< The severity
+	};
+
+	/**
+	 * \brief An expression compiled against one report
+	 *
+	 * Each instruction tests one column of a result and then jumps to the next instruction to run, or to the
+	 * answer, depending on the outcome. So `and` and `or` stop as soon as the answer is known, and evaluation is a
+	 * short loop with no recursion.
+	 */
+	class Program {
+
+	public:
+
+		/**
+		 * \brief Whether the result with id \a result matches the expression
+		 */
+		bool Matches(const Columns& columns, size_t result) const
+		{
+			uint32_t next = 0;
+			while (next < _code.size()) {
+				const auto& instruction = _code[next];
+				bool match;
+				switch (instruction.column) {
+				case Column::Rule:
+					match = _tables[instruction.low][columns.rule[result]] != 0;
+					break;
+				case Column::Uri:
+					match = _tables[instruction.low][columns.uri[result]] != 0;
+					break;
+				case Column::Level:
+					match = columns.level[result] >= instruction.low && columns.level[result] <= instruction.high;
+					break;
+				default:
+					match = columns.line[result] >= instruction.low && columns.line[result] <= instruction.high;
+					break;
+				}
+				next = match ? instruction.onTrue : instruction.onFalse;
+			}
+			return next == MatchFound;
+		}
+
+		/**
+		 * \brief The number of instructions, which is the number of predicates in the expression
+		 */
+		size_t Size() const;
+
+	private:
+
+		friend class FilterExpression;
+
+		enum class Column : uint8_t { Rule, Uri, Level, Line };
+
+		struct Instruction {
+			Column column;
+			uint32_t low;     ///< The table to look in for Rule and Uri, otherwise the smallest matching value
+			uint32_t high;    ///< The largest matching value, for Level and Line
+			uint32_t onTrue;  ///< The instruction to run next if this one matches, or one of the two answers below
+			uint32_t onFalse; ///< The instruction to run next if it doesn't
+		};
+
+		static constexpr uint32_t MatchFound = UINT32_MAX;
+		static constexpr uint32_t NoMatch = UINT32_MAX - 1;
+
+		std::vector<Instruction> _code;
+		std::vector<std::vector<uint8_t>> _tables;
+	};
+
+	/**
+	 * \brief Compile the expression for one report
+	 * \param tables For each predicate, in the order of Predicates(): for Rule and Tag predicates whether it holds for
+	 * each of the report's distinct rules, and for Uri predicates for each of its distinct URIs. Level and Line
+	 * predicates do not need a table.
+	 * \param selectivity For each predicate, the fraction of the report's results it is expected to match. Each `and`
+	 * tests the operand most likely to fail first and each `or` the one most likely to succeed, so that as few
+	 * predicates as possible are evaluated per result.
+	 * \throws std::invalid_argument if there are not enough tables or selectivities
+	 */
+	Program Compile(std::vector<std::vector<bool>> tables, const std::vector<double>& selectivity) const;
+
+private:
+
+	struct Node {
+		enum class Kind : uint8_t { Predicate, Not, And, Or };
+		Kind kind = Kind::Predicate;
+		uint32_t predicate = 0;         ///< For Kind::Predicate, its position in _predicates
+		std::vector<uint32_t> children; ///< Positions in _nodes
+	};
+
+	struct Token {
+		enum class Kind : uint8_t { Word, String, Symbol, End };
+		Kind kind = Kind::End;
+		std::string text;
+		size_t position = 0;
+	};
+
+	class Parser;
+
+	/**
+	 * \brief The probability that \a node matches a result, assuming its predicates are independent
+	 */
+	double Probability(uint32_t node, const std::vector<double>& selectivity) const;
+
+	/**
+	 * \brief The number of predicates below \a node, which is the number of instructions it compiles to
+	 */
+	uint32_t Leaves(uint32_t node) const;
+
+	/**
+	 * \brief Write the instructions for \a node into \a program, starting at \a start, jumping to \a onTrue or
+	 * \a onFalse once its outcome is known
+	 */
+	void Emit(uint32_t node, uint32_t start, uint32_t onTrue, uint32_t onFalse, const std::vector<double>& selectivity,
+		Program& program) const;
+
+	std::string _text;
+	std::vector<Predicate> _predicates;
+	std::vector<Node> _nodes;  ///< The parsed tree, with the root last
+};
+
+#endif // _CLEANSARIF_FILTEREXPRESSION_H_
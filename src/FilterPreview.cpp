@@ -0,0 +1,121 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "FilterPreview.h"
+
+#pragma warning(push, 1) 
+#include <QMetaType>
+#pragma warning(pop)
+
+#include <regex>
+#include <chrono>
+
+FilterPreview::FilterPreview(std::shared_ptr<const SARIF> report, QObject* parent) :
+	QObject(parent),
+	_report(std::move(report))
+{
+	// The matches are sent across threads
+	qRegisterMetaType<QVector<int>>("QVector<int>");
+}
+
+FilterPreview::~FilterPreview()
+{
+	Cancel();
+	if (_worker.joinable())
+		_worker.join();
+}
+
+int FilterPreview::Start(const QString& regex)
+{
+	auto generation = ++_generation;
+
+	// The previous run checks the generation between files, so it is never long before it returns
+	if (_worker.joinable())
+		_worker.join();
+	_worker = std::thread(&FilterPreview::Run, this, generation, regex.toStdString());
+	return generation;
+}
+
+void FilterPreview::Cancel()
+{
+	++_generation;
+}
+
+void FilterPreview::Wait()
+{
+	if (_worker.joinable())
+		_worker.join();
+}
+
+int FilterPreview::Generation() const
+{
+	return _generation;
+}
+
+int FilterPreview::Count(const QString& regex) const
+{
+	int matches = 0;
+	Match(regex.toStdString(), []() {return false; }, [&matches](size_t) { ++matches; });
+	return matches;
+}
+
+void FilterPreview::Match(const std::string& regex, const std::function<bool()>& cancelled, const std::function<void(size_t)>& found) const
+{
+	std::regex re(regex);
+	const auto& uris = _report->DistinctUris();
+	for (size_t uri = 0; uri < uris.size() && !cancelled(); ++uri) {
+		if (std::regex_search(uris[uri], re))
+			found(uri);
+	}
+}
+
+void FilterPreview::Run(int generation, const std::string& regex)
+{
+	// Batches go out at least this often, so that a slow expression still shows progress
+	const auto interval = std::chrono::milliseconds(50);
+	const int batchSize = 1000;
+
+	auto cancelled = [this, generation]() { return _generation != generation; };
+	QVector<int> batch;
+	int matches = 0;
+	auto lastBatch = std::chrono::steady_clock::now();
+	try {
+		Match(regex, cancelled, [&](size_t file) {
+			batch.append(static_cast<int>(file));
+			++matches;
+			if (batch.size() >= batchSize || std::chrono::steady_clock::now() - lastBatch > interval) {
+				emit matchesFound(generation, batch);
+				batch.clear();
+				lastBatch = std::chrono::steady_clock::now();
+			}
+		});
+	}
+	catch (const std::regex_error& e) {
+		emit failed(generation, QString::fromLocal8Bit(e.what()));
+		return;
+	}
+	if (cancelled())
+		return;
+	if (!batch.isEmpty())
+		emit matchesFound(generation, batch);
+	emit finished(generation, matches);
+}
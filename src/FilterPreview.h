@@ -0,0 +1,124 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CLEANSARIF_FILTERPREVIEW_H_
+#define _CLEANSARIF_FILTERPREVIEW_H_
+
+#pragma warning(push, 1) 
+#include <QObject>
+#include <QVector>
+#pragma warning(pop)
+
+#include "SARIF.h"
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+/**
+ * \brief Finds the files a location filter would match, on a background thread
+ *
+ * The expression is matched against the distinct URIs of a report, and matches are reported by their
+ * position in SARIF::DistinctUris(), so no strings are copied or converted. Each call to Start()
+ * supersedes the one before: a run that has been superseded stops at the next file, and its signals are
+ * tagged with its generation so that the receiver can ignore any that were already queued. Matches are
+ * delivered in batches as they are found, so the first ones can be shown straight away.
+ */
+class FilterPreview : public QObject {
+
+	Q_OBJECT
+
+public:
+
+	/**
+	 * \brief Prepare to match against the distinct URIs of \a report, which is kept alive until the preview is destroyed
+	 */
+	explicit FilterPreview(std::shared_ptr<const SARIF> report, QObject* parent = nullptr);
+
+	/**
+	 * \brief Cancel any run in progress and wait for it to stop
+	 */
+	~FilterPreview();
+
+	/**
+	 * \brief Start matching \a regex against the files, cancelling any earlier run
+	 * \returns The generation of the new run, as passed to the signals
+	 */
+	int Start(const QString& regex);
+
+	/**
+	 * \brief Stop the current run, if there is one
+	 */
+	void Cancel();
+
+	/**
+	 * \brief Wait for the current run, if there is one, to finish without cancelling it
+	 */
+	void Wait();
+
+	/**
+	 * \brief The generation of the most recent call to Start()
+	 */
+	int Generation() const;
+
+	/**
+	 * \brief Count the files matching \a regex, on the calling thread
+	 * \throws std::regex_error if \a regex is not a valid regular expression
+	 */
+	int Count(const QString& regex) const;
+
+signals:
+
+	/**
+	 * \brief Some more of the files matched
+	 * \param uris Positions in SARIF::DistinctUris()
+	 */
+	void matchesFound(int generation, const QVector<int>& uris);
+
+	/**
+	 * \brief The run finished, with \a matches files matched in total
+	 */
+	void finished(int generation, int matches);
+
+	/**
+	 * \brief The regular expression could not be compiled
+	 */
+	void failed(int generation, const QString& message);
+
+private:
+
+	/**
+	 * \brief Call \a found with the position of each file matching \a regex, until \a cancelled returns true
+	 */
+	void Match(const std::string& regex, const std::function<bool()>& cancelled, const std::function<void(size_t)>& found) const;
+
+	void Run(int generation, const std::string& regex);
+
+	std::shared_ptr<const SARIF> _report;
+	std::atomic<int> _generation{ 0 };
+	std::thread _worker;
+};
+
+#endif // _CLEANSARIF_FILTERPREVIEW_H_
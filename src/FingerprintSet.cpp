@@ -0,0 +1,87 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "FingerprintSet.h"
+
+FingerprintSet::FingerprintSet(size_t expected)
+{
+	size_t slots = 16;
+	while (slots < 2 * expected)
+		slots *= 2;
+	_slots.assign(slots, 0);
+}
+
+bool FingerprintSet::Insert(uint64_t fingerprint)
+{
+	if (fingerprint == 0)
+		fingerprint = 1;
+	if (2 * (_size + 1) > _slots.size())
+		Grow();
+	const size_t mask = _slots.size() - 1;
+	for (size_t slot = static_cast<size_t>(fingerprint) & mask;; slot = (slot + 1) & mask) {
+		if (_slots[slot] == fingerprint)
+			return false;
+		if (_slots[slot] == 0) {
+			_slots[slot] = fingerprint;
+			++_size;
+			return true;
+		}
+	}
+}
+
+bool FingerprintSet::Contains(uint64_t fingerprint) const
+{
+	if (fingerprint == 0)
+		fingerprint = 1;
+	const size_t mask = _slots.size() - 1;
+	for (size_t slot = static_cast<size_t>(fingerprint) & mask;; slot = (slot + 1) & mask) {
+		if (_slots[slot] == fingerprint)
+			return true;
+		if (_slots[slot] == 0)
+			return false;
+	}
+}
+
+size_t FingerprintSet::Size() const
+{
+	return _size;
+}
+
+size_t FingerprintSet::MemoryFootprint() const
+{
+	return sizeof(*this) + _slots.capacity() * sizeof(uint64_t);
+}
+
+void FingerprintSet::Grow()
+{
+	std::vector<uint64_t> old(_slots.size() * 2, 0);
+	old.swap(_slots);
+	const size_t mask = _slots.size() - 1;
+	for (auto fingerprint : old) {
+		if (fingerprint == 0)
+			continue;
+		size_t slot = static_cast<size_t>(fingerprint) & mask;
+		while (_slots[slot] != 0)
+			slot = (slot + 1) & mask;
+		_slots[slot] = fingerprint;
+	}
+}
@@ -0,0 +1,79 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CLEANSARIF_FINGERPRINTSET_H_
+#define _CLEANSARIF_FINGERPRINTSET_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * \brief A set of 64-bit result fingerprints, stored in a single open-addressed table
+ *
+ * Fingerprints are already well-mixed hashes, so their low bits are used directly as the slot, and collisions move
+ * on to the next slot. The table is kept at most half full, so it takes 16 bytes or less per fingerprint, instead
+ * of the separate allocation per entry of a node-based set. 0 marks an empty slot: SARIF::FingerprintOf() never
+ * returns it.
+ */
+class FingerprintSet {
+
+public:
+
+	/**
+	 * \brief An empty set, with room for \a expected fingerprints before it has to grow
+	 */
+	explicit FingerprintSet(size_t expected = 0);
+
+	/**
+	 * \brief Add \a fingerprint to the set
+	 * \returns True if it was added, false if it was already there
+	 */
+	bool Insert(uint64_t fingerprint);
+
+	/**
+	 * \brief Whether \a fingerprint is in the set
+	 */
+	bool Contains(uint64_t fingerprint) const;
+
+	/**
+	 * \brief The number of fingerprints in the set
+	 */
+	size_t Size() const;
+
+	/**
+	 * \brief The approximate number of bytes the set uses
+	 */
+	size_t MemoryFootprint() const;
+
+private:
+
+	/**
+	 * \brief Double the size of the table, re-inserting every fingerprint
+	 */
+	void Grow();
+
+	std::vector<uint64_t> _slots; ///< A power of two in size, with 0 for an empty slot
+	size_t _size = 0;
+};
+
+#endif // _CLEANSARIF_FINGERPRINTSET_H_
@@ -0,0 +1,246 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "LineRanges.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <cctype>
+
+#pragma warning(push, 1)
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#pragma warning(pop)
+
+LineRanges LineRanges::FromUnifiedDiff(const std::string& diff)
+{
+	// Reads the number at \a position in \a text, moving \a position past it
+	auto number = [](const std::string& text, size_t& position) {
+		uint64_t value = 0;
+		while (position < text.size() && std::isdigit(static_cast<unsigned char>(text[position])))
+			value = std::min<uint64_t>(value * 10 + (text[position++] - '0'), std::numeric_limits<uint32_t>::max());
+		return static_cast<uint32_t>(value);
+	};
+	// Reads the "start,count" of one side of a hunk header, where the count defaults to 1
+	auto side = [&number](const std::string& text, size_t position, uint32_t& start, uint32_t& count) {
+		start = number(text, position);
+		count = 1;
+		if (position < text.size() && text[position] == ',')
+			count = number(text, ++position);
+	};
+
+	LineRanges ranges;
+	std::string file;       // The new name of the current file, or empty if it was deleted
+	uint32_t line = 0;      // The line number, in the new file, of the next line of the current hunk
+	uint32_t oldLines = 0;  // The number of lines of the old file the current hunk has still to show
+	uint32_t newLines = 0;  // The number of lines of the new file the current hunk has still to show
+	size_t start = 0;
+	while (start < diff.size()) {
+		auto end = diff.find('\n', start);
+		if (end == std::string::npos)
+			end = diff.size();
+		std::string text = diff.substr(start, end - start);
+		start = end + 1;
+		if (!text.empty() && text.back() == '\r')
+			text.pop_back();
+
+		// Inside a hunk the first character says which version a line is in, and a line of the old file can
+		// begin with "--", so the header lines are only looked for once the hunk is complete
+		if (oldLines > 0 || newLines > 0) {
+			const char kind = text.empty() ? ' ' : text[0];
+			if (kind == '+' && newLines > 0) {
+				if (!file.empty())
+					ranges.Add(file, line, line);
+				++line;
+				--newLines;
+			}
+			else if (kind == '-' && oldLines > 0) {
+				--oldLines;
+			}
+			else if (kind == ' ') {
+				++line;
+				oldLines -= oldLines > 0 ? 1 : 0;
+				newLines -= newLines > 0 ? 1 : 0;
+			}
+			else if (kind != '\\') {
+				// A truncated hunk: carry on with the next header
+				oldLines = newLines = 0;
+			}
+			if (oldLines > 0 || newLines > 0 || kind == '\\')
+				continue;
+		}
+
+		if (text.compare(0, 4, "+++ ") == 0) {
+			file = text.substr(4, text.find('\t', 4) == std::string::npos ? std::string::npos : text.find('\t', 4) - 4);
+			if (file.size() >= 2 && file.front() == '"' && file.back() == '"')
+				file = file.substr(1, file.size() - 2);
+			if (file == "/dev/null")
+				file.clear();
+			else if (file.compare(0, 2, "b/") == 0 || file.compare(0, 2, "a/") == 0)
+				file = file.substr(2);
+		}
+		else if (text.compare(0, 4, "@@ -") == 0) {
+			auto plus = text.find(" +", 4);
+			if (plus == std::string::npos)
+				continue;
+			uint32_t oldStart = 0;
+			side(text, 4, oldStart, oldLines);
+			side(text, plus + 2, line, newLines);
+		}
+	}
+	return ranges;
+}
+
+LineRanges LineRanges::FromJson(const QJsonObject& files)
+{
+	auto lineNumber = [](const QJsonValue& value, const std::string& file) {
+		auto number = value.toDouble(-1.0);
+		if (!value.isDouble() || number < 0.0 || number > std::numeric_limits<uint32_t>::max() || number != static_cast<uint32_t>(number))
+			throw std::runtime_error("The ranges of " + file + " must be line numbers or pairs of line numbers");
+		return static_cast<uint32_t>(number);
+	};
+
+	LineRanges ranges;
+	for (auto entry = files.begin(); entry != files.end(); ++entry) {
+		auto file = entry.key().toStdString();
+		if (!entry.value().isArray())
+			throw std::runtime_error("The ranges of " + file + " are not an array");
+		auto list = entry.value().toArray();
+		if (list.isEmpty()) {
+			ranges.AddFile(file);
+			continue;
+		}
+		for (const auto& range : list) {
+			if (range.isArray() && range.toArray().size() == 2) {
+				auto first = lineNumber(range.toArray().at(0), file);
+				auto last = lineNumber(range.toArray().at(1), file);
+				if (last < first)
+					throw std::runtime_error("A range of " + file + " ends before it starts");
+				ranges.Add(file, first, last);
+			}
+			else {
+				auto single = lineNumber(range, file);
+				ranges.Add(file, single, single);
+			}
+		}
+	}
+	return ranges;
+}
+
+LineRanges LineRanges::Load(const std::string& file)
+{
+	QFile input(QString::fromStdString(file));
+	if (!input.open(QIODevice::ReadOnly))
+		throw std::runtime_error("Failed to open the line range file " + file);
+	auto data = input.readAll();
+	if (!data.trimmed().startsWith("{"))
+		return FromUnifiedDiff(data.toStdString());
+
+	QJsonParseError error;
+	auto document = QJsonDocument::fromJson(data, &error);
+	if (document.isNull())
+		throw std::runtime_error("Failed to read the line ranges in " + file + ": " + error.errorString().toStdString());
+	return FromJson(document.object());
+}
+
+void LineRanges::Add(const std::string& file, uint32_t first, uint32_t last)
+{
+	if (last < first)
+		return;
+	auto& ranges = _files[LineRanges::Normalize(file)];
+
+	// Every range that overlaps or touches the new one is merged into it
+	auto position = std::lower_bound(ranges.begin(), ranges.end(), first, [](const Range& range, uint32_t line) {
+		return static_cast<uint64_t>(range.last) + 1 < line;
+	});
+	auto end = position;
+	while (end != ranges.end() && end->first <= static_cast<uint64_t>(last) + 1) {
+		first = std::min(first, end->first);
+		last = std::max(last, end->last);
+		++end;
+	}
+	position = ranges.erase(position, end);
+	ranges.insert(position, Range{ first, last });
+}
+
+void LineRanges::AddFile(const std::string& file)
+{
+	Add(file, 0, std::numeric_limits<uint32_t>::max());
+}
+
+const std::vector<LineRanges::Range>* LineRanges::Find(const std::string& uri) const
+{
+	// Try the whole URI, then everything after each slash in turn, so the longest match wins
+	auto normalized = LineRanges::Normalize(uri);
+	size_t position = 0;
+	while (true) {
+		auto found = _files.find(normalized.substr(position));
+		if (found != _files.end())
+			return &found->second;
+		auto slash = normalized.find('/', position);
+		if (slash == std::string::npos)
+			return nullptr;
+		position = slash + 1;
+	}
+}
+
+bool LineRanges::Contains(const std::vector<Range>& ranges, uint32_t line)
+{
+	return LineRanges::Overlaps(ranges, line, line);
+}
+
+bool LineRanges::Contains(const std::string& uri, uint32_t line) const
+{
+	return Overlaps(uri, line, line);
+}
+
+bool LineRanges::Overlaps(const std::vector<Range>& ranges, uint32_t first, uint32_t last)
+{
+	// The first range that does not end before \a first is the only one that can overlap
+	auto range = std::lower_bound(ranges.begin(), ranges.end(), first, [](const Range& range, uint32_t line) {
+		return range.last < line;
+	});
+	return range != ranges.end() && range->first <= last;
+}
+
+bool LineRanges::Overlaps(const std::string& uri, uint32_t first, uint32_t last) const
+{
+	auto ranges = Find(uri);
+	return ranges && LineRanges::Overlaps(*ranges, first, last);
+}
+
+size_t LineRanges::Files() const
+{
+	return _files.size();
+}
+
+std::string LineRanges::Normalize(const std::string& path)
+{
+	std::string normalized = path;
+	std::replace(normalized.begin(), normalized.end(), '\\', '/');
+	while (normalized.compare(0, 2, "./") == 0)
+		normalized.erase(0, 2);
+	return normalized;
+}
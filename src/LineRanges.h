@@ -0,0 +1,133 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CLEANSARIF_LINERANGES_H_
+#define _CLEANSARIF_LINERANGES_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+class QJsonObject;
+
+/**
+ * \brief Sets of line ranges, one per file, such as the lines a pull request changes
+ *
+ * Each file's ranges are kept sorted and merged, so they never overlap or touch, and whether a line is in one of
+ * them is a binary search. Files are named by a path relative to some root (e.g. the root of the repository): a
+ * SARIF artifact URI refers to the file whose path is the longest match for the end of the URI, so
+ * "file:///home/jdoe/repo/src/App/Application.cpp" is in "src/App/Application.cpp" or "App/Application.cpp".
+ */
+class LineRanges {
+
+public:
+
+	/**
+	 * \brief An inclusive range of line numbers
+	 */
+	struct Range {
+		uint32_t first;
+		uint32_t last;
+	};
+
+	/**
+	 * \brief No files
+	 */
+	LineRanges() = default;
+
+	/**
+	 * \brief The lines a unified diff (e.g. the output of `git diff`) adds or changes, in the new version of each file
+	 *
+	 * Context lines and removed lines are not included, and neither are deleted files. The "a/" and "b/" prefixes
+	 * that git adds to the file names are removed.
+	 */
+	static LineRanges FromUnifiedDiff(const std::string& diff);
+
+	/**
+	 * \brief Ranges from a JSON object mapping each file to an array of ranges
+	 *
+	 * Each range is either a line number or a two-element array with the first and last line, e.g.
+	 * `{"src/App/Application.cpp": [[10, 20], 35], "src/Gui/Generated.cpp": []}`. An empty array means the
+	 * whole file.
+	 * \throws std::runtime_error if a range is not a number or a pair of numbers
+	 */
+	static LineRanges FromJson(const QJsonObject& files);
+
+	/**
+	 * \brief Read a unified diff, or a JSON object as described by FromJson(), from \a file
+	 * \throws std::runtime_error if the file cannot be read, or is JSON that FromJson() does not accept
+	 */
+	static LineRanges Load(const std::string& file);
+
+	/**
+	 * \brief Add lines \a first to \a last of \a file, merging them with the ranges it already has
+	 */
+	void Add(const std::string& file, uint32_t first, uint32_t last);
+
+	/**
+	 * \brief Add all of \a file, including results that have no line number
+	 */
+	void AddFile(const std::string& file);
+
+	/**
+	 * \brief The sorted, merged ranges of the file that \a uri refers to, or nullptr if it is not one of the files
+	 */
+	const std::vector<Range>* Find(const std::string& uri) const;
+
+	/**
+	 * \brief Whether \a line is in one of \a ranges, as returned by Find(). O(log n) in the number of ranges.
+	 */
+	static bool Contains(const std::vector<Range>& ranges, uint32_t line);
+
+	/**
+	 * \brief Whether \a line of the file that \a uri refers to is in one of the ranges
+	 */
+	bool Contains(const std::string& uri, uint32_t line) const;
+
+	/**
+	 * \brief Whether any of lines \a first to \a last is in one of \a ranges, as returned by Find(). O(log n) in the
+	 * number of ranges.
+	 */
+	static bool Overlaps(const std::vector<Range>& ranges, uint32_t first, uint32_t last);
+
+	/**
+	 * \brief Whether any of lines \a first to \a last of the file that \a uri refers to is in one of the ranges
+	 */
+	bool Overlaps(const std::string& uri, uint32_t first, uint32_t last) const;
+
+	/**
+	 * \brief The number of files
+	 */
+	size_t Files() const;
+
+private:
+
+	/**
+	 * \brief \a path with backslashes turned into slashes, and without any leading "./"
+	 */
+	static std::string Normalize(const std::string& path);
+
+	std::unordered_map<std::string, std::vector<Range>> _files;
+};
+
+#endif // _CLEANSARIF_LINERANGES_H_
@@ -37,6 +37,10 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QInputDialog>
+#include <QStatusBar>
+#include <QTimer>
+#include <QTime>
 #include "QProgressIndicator.h"
 #pragma warning(pop) 
 
@@ -44,11 +48,19 @@
 #include "NewFileFilter.h"
 #include "Cleaner.h"
 #include "LoadingSARIF.h"
+#include "ReportWatcher.h"
+#include "SARIFModels.h"
 
 #include <iostream>
 #include <regex>
+#include <set>
+#include <map>
+#include <functional>
+#if __has_include(<version>)
+#include <version>
+#endif
 
-#if __cplusplus >= 202000L
+#ifdef __cpp_lib_format
 #include <format>
 #else
 #include <sstream>
@@ -69,10 +81,12 @@ MainWindow::MainWindow(QWidget* parent) :
 	ui->cleanButton->setIcon(squeegie);
 	ui->newFileFilterButton->setIcon(plus);
 	ui->newRuleButton->setIcon(plus);
+	ui->newExpressionButton->setIcon(plus);
 	ui->removeFileFilterButton->setIcon(minus);
 	ui->removeRuleButton->setIcon(minus);
+	ui->removeExpressionButton->setIcon(minus);
 	
-#if __cplusplus >= 202000L
+#ifdef __cpp_lib_format
 	std::string version = std::format("v{}.{}.{}", CleanSARIF_VERSION_MAJOR, CleanSARIF_VERSION_MINOR, CleanSARIF_VERSION_PATCH);
 #else
 	std::ostringstream s;
@@ -82,16 +96,32 @@ MainWindow::MainWindow(QWidget* parent) :
 	ui->versionLabel->setText(QString::fromStdString(version));
 	ui->fileFiltersTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
 	ui->suppressedRulesTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+	ui->expressionFiltersTable->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+	// The results pane can have millions of rows: fixed row heights and column widths mean that only the rows
+	// on screen are ever asked for their contents, and the view is unsorted until a header is clicked
+	ui->resultsView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+	ui->resultsView->verticalHeader()->setDefaultSectionSize(ui->resultsView->fontMetrics().height() + 4);
+	ui->resultsView->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+	ui->resultsView->horizontalHeader()->setStretchLastSection(true);
+	ui->resultsView->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
 
 	connect(ui->fileFiltersTable, &QTableWidget::itemSelectionChanged, this, &MainWindow::fileFilterSelectionChanged);
 	connect(ui->suppressedRulesTable, &QTableWidget::itemSelectionChanged, this, &MainWindow::ruleSuppressionSelectionChanged);
+	connect(ui->expressionFiltersTable, &QTableWidget::itemSelectionChanged, this, &MainWindow::expressionFilterSelectionChanged);
 	connect(_cleaner.get(), &Cleaner::errorOccurred, this, &MainWindow::loadFailed);
 
+	// Cleaning the file that was just loaded, or a newer version of it, only indexes the results that changed
+	_cleaner->SetIncrementalReload(true);
+
 	QSettings settings; 
 
 	settings.beginGroup("Options");
 	_lastOpenedDirectory = settings.value("lastOpenedDirectory", QDir::homePath()).toString();
 	_lastSavedDirectory = settings.value("lastSavedDirectory", "").toString();
+	ui->pruneRulesCheckbox->setChecked(settings.value("pruneRules", true).toBool());
+	ui->splitModeCombo->setCurrentIndex(settings.value("splitMode", 0).toInt());
+	ui->splitSizeSpinBox->setValue(settings.value("splitSize", 5.0).toDouble());
 	settings.endGroup();
 
 	if (ui->inputFileLineEdit->text().isEmpty())
@@ -171,11 +201,12 @@ void MainWindow::on_removeFileFilterButton_clicked()
 		_cleaner->RemoveLocationFilter(ui->fileFiltersTable->item(row, 0)->text());
 		ui->fileFiltersTable->removeRow(row);
 	}
+	updateResultsModel();
 }
 
 void MainWindow::on_newFileFilterButton_clicked()
 {
-	auto filesToFilter = NewFileFilter::GetNewFileFilter(this, _cleaner->GetFiles());
+	auto filesToFilter = NewFileFilter::GetNewFileFilter(this, _cleaner->Snapshot());
 	
 	if (std::get<0>(filesToFilter).isEmpty())
 		return;
@@ -191,6 +222,7 @@ void MainWindow::on_newFileFilterButton_clicked()
 	ui->fileFiltersTable->setItem(row, 1, count);
 	ui->fileFiltersTable->setItem(row, 2, note);
 	_cleaner->AddLocationFilter(std::get<0>(filesToFilter));
+	updateResultsModel();
 }
 
 void MainWindow::on_removeRuleButton_clicked()
@@ -209,11 +241,12 @@ void MainWindow::on_removeRuleButton_clicked()
 		_cleaner->UnsuppressRule(ui->suppressedRulesTable->item(row,0)->text());
 		ui->suppressedRulesTable->removeRow(row);
 	}
+	updateResultsModel();
 }
 
 void MainWindow::on_newRuleButton_clicked()
 {
-	auto rulesToSuppress = NewRuleSuppression::GetNewRuleSuppression(this, _cleaner->GetRules());
+	auto rulesToSuppress = NewRuleSuppression::GetNewRuleSuppression(this, _cleaner->Snapshot());
 	const int start = ui->suppressedRulesTable->rowCount();
 	ui->suppressedRulesTable->setRowCount(start + std::get<0>(rulesToSuppress).count());
 	int row = start;
@@ -225,15 +258,183 @@ void MainWindow::on_newRuleButton_clicked()
 		ui->suppressedRulesTable->setItem(row, 1, note);
 		++row;
 	}
+	updateResultsModel();
 }
-void MainWindow::on_cleanButton_clicked()
+
+void MainWindow::on_removeExpressionButton_clicked()
 {
-	ui->cleanButton->setDisabled(true);
+	auto ranges = ui->expressionFiltersTable->selectedRanges();
+	std::vector<int> rowsToRemove;
+	for (const auto& range : ranges) {
+		int start = range.topRow();
+		int end = range.bottomRow();
+		for (int row = start; row <= end; ++row) {
+			rowsToRemove.push_back(row);
+		}
+	}
+	std::sort(rowsToRemove.begin(), rowsToRemove.end(), std::greater<int>());
+	for (auto row : rowsToRemove) {
+		_cleaner->RemoveExpressionFilter(ui->expressionFiltersTable->item(row, 0)->text());
+		ui->expressionFiltersTable->removeRow(row);
+	}
+	updateResultsModel();
+}
+
+void MainWindow::on_newExpressionButton_clicked()
+{
+	QString expression;
+	int matches = 0;
+	while (true) {
+		bool ok = false;
+		expression = QInputDialog::getText(this, tr("New expression filter"),
+			tr("Remove the results that match this expression, for example\n"
+			   "level == note && line in 1..20\n"
+			   "tags contains cwe-* and not file matches \"/tests/\""),
+			QLineEdit::Normal, expression, &ok);
+		if (!ok || expression.trimmed().isEmpty())
+			return;
+		try {
+			matches = _cleaner->AddExpressionFilter(expression);
+			break;
+		}
+		catch (const std::runtime_error& e) {
+			// Also catches std::regex_error
+			QMessageBox::warning(this, tr("New expression filter"), QString::fromStdString(e.what()), QMessageBox::Close);
+		}
+	}
+
+	const int row = ui->expressionFiltersTable->rowCount();
+	ui->expressionFiltersTable->setRowCount(row + 1);
+	QTableWidgetItem* count = new QTableWidgetItem();
+	count->setData(Qt::EditRole, matches); // Retain as integer for sorting
+	ui->expressionFiltersTable->setItem(row, 0, new QTableWidgetItem(expression));
+	ui->expressionFiltersTable->setItem(row, 1, count);
+	ui->expressionFiltersTable->setItem(row, 2, new QTableWidgetItem());
+	updateResultsModel();
+}
+
+void MainWindow::on_fitToSizeButton_clicked()
+{
+	const double bytesPerMegabyte = 1024.0 * 1024.0;
+	QSettings settings;
+	settings.beginGroup("Options");
+	double defaultBudget = settings.value("sizeBudget", 5.0).toDouble(); // Visual Studio's limit
+	settings.endGroup();
+
+	bool ok = false;
+	double budget = QInputDialog::getDouble(this, tr("Fit to size"), tr("Maximum output file size (MB):"), defaultBudget, 0.01, 100000.0, 2, &ok);
+	if (!ok)
+		return;
+	settings.beginGroup("Options");
+	settings.setValue("sizeBudget", budget);
+	settings.endGroup();
+
+	auto plan = _cleaner->PlanSizeBudget(static_cast<qint64>(budget * bytesPerMegabyte));
+	auto megabytes = [bytesPerMegabyte](size_t bytes) { return QString::number(bytes / bytesPerMegabyte, 'f', 2); };
+
+	QString message = tr("Estimated output size with the current filters: %1 MB").arg(megabytes(plan.estimatedBytes));
+	if (plan.rulesToDrop.empty() && plan.directoriesToDrop.empty()) {
+		if (plan.fits)
+			message += tr("\n\nThe output already fits in %1 MB.").arg(budget);
+		else
+			message += tr("\n\nThe output cannot be made to fit in %1 MB by removing results.").arg(budget);
+		QMessageBox::information(this, tr("Fit to size"), message, QMessageBox::Close);
+		return;
+	}
+
+	QString details;
+	for (const auto& rule : plan.rulesToDrop)
+		details += tr("Rule %1 (%2 MB)\n").arg(QString::fromStdString(rule.first)).arg(megabytes(rule.second));
+	for (const auto& directory : plan.directoriesToDrop)
+		details += tr("Directory %1 (%2 MB)\n").arg(QString::fromStdString(directory.first)).arg(megabytes(directory.second));
+
+	message += tr("\nEstimated size after removing %1 rules and %2 directories: %3 MB")
+		.arg(static_cast<int>(plan.rulesToDrop.size()))
+		.arg(static_cast<int>(plan.directoriesToDrop.size()))
+		.arg(megabytes(plan.plannedBytes));
+	if (!plan.fits)
+		message += tr("\n\nEven with these removed the output will not fit in %1 MB.").arg(budget);
+	message += tr("\n\nAdd these filters?");
+
+	QMessageBox box(QMessageBox::Question, tr("Fit to size"), message, QMessageBox::Apply | QMessageBox::Cancel, this);
+	box.setDetailedText(details);
+	if (box.exec() != QMessageBox::Apply)
+		return;
+
+	const QString note = tr("Fit to %1 MB").arg(budget);
+	int row = ui->suppressedRulesTable->rowCount();
+	ui->suppressedRulesTable->setRowCount(row + static_cast<int>(plan.rulesToDrop.size()));
+	for (const auto& rule : plan.rulesToDrop) {
+		auto ruleText = QString::fromStdString(rule.first);
+		_cleaner->SuppressRule(ruleText);
+		ui->suppressedRulesTable->setItem(row, 0, new QTableWidgetItem(ruleText));
+		ui->suppressedRulesTable->setItem(row, 1, new QTableWidgetItem(note));
+		++row;
+	}
 
+	row = ui->fileFiltersTable->rowCount();
+	ui->fileFiltersTable->setRowCount(row + static_cast<int>(plan.directoriesToDrop.size()));
+	for (const auto& directory : plan.directoriesToDrop) {
+		auto regexText = _cleaner->DirectoryFilter(QString::fromStdString(directory.first));
+		auto matches = _cleaner->AddLocationFilter(regexText);
+		QTableWidgetItem* count = new QTableWidgetItem();
+		count->setData(Qt::EditRole, matches); // Retain as integer for sorting
+		ui->fileFiltersTable->setItem(row, 0, new QTableWidgetItem(regexText));
+		ui->fileFiltersTable->setItem(row, 1, count);
+		ui->fileFiltersTable->setItem(row, 2, new QTableWidgetItem(note));
+		++row;
+	}
+	updateResultsModel();
+}
+
+void MainWindow::on_analyzeFiltersButton_clicked()
+{
+	SARIF::FilterAnalysis analysis;
+	try {
+		analysis = _cleaner->AnalyzeFilters();
+	}
+	catch (const std::regex_error& e) {
+		QMessageBox::critical(this, tr("Analyze filters"), tr("Invalid file filter: %1").arg(e.what()), QMessageBox::Close);
+		return;
+	}
+
+	QString message = tr("%1 filters remove %2 of %3 results.")
+		.arg(static_cast<int>(analysis.filters.size()))
+		.arg(static_cast<int>(analysis.removed))
+		.arg(static_cast<int>(analysis.results));
+	if (analysis.dead.empty() && analysis.redundant.empty() && analysis.similar.empty()) {
+		message += tr("\n\nEvery filter removes results that no other filter does.");
+	}
+	else {
+		message += tr("\n\n%1 match nothing, %2 only match results that other filters also remove, and %3 pairs differ by only a few results.")
+			.arg(static_cast<int>(analysis.dead.size()))
+			.arg(static_cast<int>(analysis.redundant.size()))
+			.arg(static_cast<int>(analysis.similar.size()));
+	}
+
+	QMessageBox box(QMessageBox::Information, tr("Analyze filters"), message, QMessageBox::Close, this);
+	box.setDetailedText(Cleaner::DescribeFilterAnalysis(analysis));
+	box.exec();
+}
+
+void MainWindow::configureCleaner()
+{
 	if (ui->replaceURICheckbox->isChecked()) {
 		_cleaner->SetBase(ui->basePathLineEdit->text());
 	}
+	_cleaner->SetPruneRules(ui->pruneRulesCheckbox->isChecked());
+	_cleaner->SetDeduplicate(ui->deduplicateCheckbox->isChecked());
+	_cleaner->SetResultProjection(static_cast<SARIF::ProjectionMode>(ui->projectionModeCombo->currentIndex()), projectionPaths());
+	_cleaner->SetSplitOutput(static_cast<SARIF::SplitMode>(ui->splitModeCombo->currentIndex()),
+		static_cast<qint64>(ui->splitSizeSpinBox->value() * 1024.0 * 1024.0));
 	_cleaner->SetOutfile(ui->outputFileLineEdit->text());
+}
+
+void MainWindow::on_cleanButton_clicked()
+{
+	ui->cleanButton->setDisabled(true);
+
+	configureCleaner();
 
 	_loadingDialog = std::make_unique<LoadingSARIF>(this);
 	_loadingDialog->show();
@@ -245,7 +446,9 @@ void MainWindow::on_cleanButton_clicked()
 	// Store off the last thing we ran as our default settings for next time...
 	QSettings settings;	
 	settings.beginGroup("Options");
-	
+	settings.setValue("pruneRules", ui->pruneRulesCheckbox->isChecked());
+	settings.setValue("splitMode", ui->splitModeCombo->currentIndex());
+	settings.setValue("splitSize", ui->splitSizeSpinBox->value());
 	settings.endGroup();
 	settings.sync();
 }
@@ -273,6 +476,181 @@ void MainWindow::on_replaceURICheckbox_stateChanged(int state)
 	}
 }
 
+void MainWindow::on_projectionModeCombo_currentIndexChanged(int index)
+{
+	ui->projectionPathsLineEdit->setEnabled(index != static_cast<int>(SARIF::ProjectionMode::None));
+}
+
+void MainWindow::on_splitModeCombo_currentIndexChanged(int index)
+{
+	ui->splitSizeSpinBox->setEnabled(index == static_cast<int>(SARIF::SplitMode::BySize));
+}
+
+void MainWindow::on_minimumLevelCombo_currentIndexChanged(int)
+{
+	updateThreshold();
+}
+
+void MainWindow::on_minimumRankSpinBox_valueChanged(int)
+{
+	updateThreshold();
+}
+
+void MainWindow::on_watchInputCheckbox_toggled(bool checked)
+{
+	Q_UNUSED(checked);
+	updateWatcher();
+}
+
+void MainWindow::on_deduplicateCheckbox_toggled(bool checked)
+{
+	_cleaner->SetDeduplicate(checked);
+	updateResultsModel();
+}
+
+void MainWindow::updateWatcher()
+{
+	auto input = ui->inputFileLineEdit->text();
+	if (!ui->watchInputCheckbox->isChecked() || input.isEmpty()) {
+		_watcher.reset();
+		_watchPending = false;
+		return;
+	}
+	if (_watcher && _watcher->File() == input)
+		return;
+	_watcher = std::make_unique<ReportWatcher>(input);
+	connect(_watcher.get(), &ReportWatcher::reportChanged, this, &MainWindow::inputFileChanged);
+}
+
+QStringList MainWindow::projectionPaths() const
+{
+	QStringList paths;
+	for (const auto& path : ui->projectionPathsLineEdit->text().split(',', Qt::SkipEmptyParts)) {
+		auto trimmed = path.trimmed();
+		if (!trimmed.isEmpty())
+			paths.append(trimmed);
+	}
+	return paths;
+}
+
+void MainWindow::resetResultsModel()
+{
+	auto snapshot = _cleaner->Snapshot();
+	if (_resultsModel && snapshot == _resultsModel->Report())
+		return;
+	// The filters' match sets are ids in the old snapshot, so they are all worked out again
+	_coverage = std::make_shared<FilterCoverage>(snapshot->ResultCount());
+	_ruleCoverage.clear();
+	_locationCoverage.clear();
+	_expressionCoverage.clear();
+	_thresholdCoverage = -1;
+	_duplicateCoverage = -1;
+	auto model = std::make_unique<ResultTableModel>(snapshot);
+	model->SetCoverage(_coverage);
+	ui->resultsView->setModel(model.get());
+	_resultsModel = std::move(model);
+	auto header = ui->resultsView->horizontalHeader();
+	ui->resultsView->sortByColumn(header->sortIndicatorSection(), header->sortIndicatorOrder());
+	updateThreshold();
+}
+
+void MainWindow::updateResultsModel()
+{
+	if (!_resultsModel)
+		return;
+	auto snapshot = _resultsModel->Report();
+
+	// Which results are duplicates depends on what the other filters leave, so they are found again after them
+	if (_duplicateCoverage >= 0) {
+		_coverage->Remove(_duplicateCoverage);
+		_duplicateCoverage = -1;
+	}
+
+	// Only the filters that were added or removed since the last update change the coverage
+	auto synchronize = [this](QTableWidget* table, std::map<QString, int>& handles, const std::function<ResultBitmap(const std::string&)>& matches) {
+		std::set<QString> current;
+		for (int row = 0; row < table->rowCount(); ++row) {
+			if (auto item = table->item(row, 0))
+				current.insert(item->text());
+		}
+		for (auto handle = handles.begin(); handle != handles.end();) {
+			if (current.count(handle->first) == 0) {
+				_coverage->Remove(handle->second);
+				handle = handles.erase(handle);
+			}
+			else {
+				++handle;
+			}
+		}
+		for (const auto& filter : current) {
+			if (handles.count(filter) > 0)
+				continue;
+			try {
+				handles[filter] = _coverage->Add(matches(filter.toStdString()));
+			}
+			catch (const std::runtime_error&) {
+				// An invalid regular expression or filter expression matches nothing, as in the Cleaner
+			}
+		}
+	};
+	synchronize(ui->suppressedRulesTable, _ruleCoverage, [&snapshot](const std::string& rule) { return snapshot->RuleMatches(rule); });
+	synchronize(ui->fileFiltersTable, _locationCoverage, [&snapshot](const std::string& regex) { return snapshot->LocationMatches(regex); });
+	synchronize(ui->expressionFiltersTable, _expressionCoverage, [&snapshot](const std::string& expression) { return snapshot->ExpressionMatches(expression); });
+
+	// The threshold is a single filter, replaced whenever it changes
+	const std::pair<int, int> threshold = { ui->minimumLevelCombo->currentIndex(), ui->minimumRankSpinBox->value() };
+	if (_thresholdCoverage >= 0 && threshold != _coverageThreshold) {
+		_coverage->Remove(_thresholdCoverage);
+		_thresholdCoverage = -1;
+	}
+	if (_thresholdCoverage < 0 && (threshold.first > 0 || threshold.second > 0)) {
+		_thresholdCoverage = _coverage->Add(snapshot->ThresholdMatches(static_cast<SARIF::Level>(threshold.first), threshold.second));
+		_coverageThreshold = threshold;
+	}
+
+	if (ui->deduplicateCheckbox->isChecked())
+		_duplicateCoverage = _coverage->Add(snapshot->DuplicateMatches(_coverage->Union()));
+
+	// Every filter's marginal count can change when any one filter does
+	auto showUnique = [this](QTableWidget* table, const std::map<QString, int>& handles, int column) {
+		const bool sorting = table->isSortingEnabled();
+		table->setSortingEnabled(false);
+		for (int row = 0; row < table->rowCount(); ++row) {
+			auto item = table->item(row, 0);
+			auto handle = item ? handles.find(item->text()) : handles.end();
+			QTableWidgetItem* unique = new QTableWidgetItem();
+			unique->setData(Qt::EditRole, handle != handles.end() ? static_cast<int>(_coverage->Marginal(handle->second)) : 0); // Retain as integer for sorting
+			table->setItem(row, column, unique);
+		}
+		table->setSortingEnabled(sorting);
+	};
+	showUnique(ui->suppressedRulesTable, _ruleCoverage, 2);
+	showUnique(ui->fileFiltersTable, _locationCoverage, 3);
+	showUnique(ui->expressionFiltersTable, _expressionCoverage, 3);
+	if (_thresholdCoverage >= 0)
+		ui->thresholdHitsLabel->setText(tr("Removes %1 results, %2 of them not removed by any other filter")
+			.arg(_coverage->Matches(_thresholdCoverage)).arg(_coverage->Marginal(_thresholdCoverage)));
+	else
+		ui->thresholdHitsLabel->clear();
+
+	_resultsModel->CoverageChanged();
+	ui->resultsCountLabel->setText(tr("%1 of %2 results kept").arg(_resultsModel->KeptCount()).arg(_resultsModel->rowCount()));
+}
+
+void MainWindow::updateThreshold()
+{
+	const auto rank = ui->minimumRankSpinBox->value();
+	_cleaner->SetThreshold(static_cast<SARIF::Level>(ui->minimumLevelCombo->currentIndex()), rank);
+
+	// Each count comes from the histogram of levels and ranks made when the file was loaded, so they are all instant
+	const QStringList levelNames = { tr("None"), tr("Note"), tr("Warning"), tr("Error") };
+	for (int level = 0; level < levelNames.size(); ++level) {
+		auto hits = _cleaner->ThresholdHits(static_cast<SARIF::Level>(level), rank);
+		ui->minimumLevelCombo->setItemText(level, hits > 0 ? tr("%1 (removes %2)").arg(levelNames[level]).arg(hits) : levelNames[level]);
+	}
+	updateResultsModel();
+}
+
 void MainWindow::fileFilterSelectionChanged()
 {
 	auto count = ui->fileFiltersTable->selectedRanges().count();
@@ -295,6 +673,17 @@ void MainWindow::ruleSuppressionSelectionChanged()
 	}
 }
 
+void MainWindow::expressionFilterSelectionChanged()
+{
+	auto count = ui->expressionFiltersTable->selectedRanges().count();
+	if (count > 0) {
+		ui->removeExpressionButton->setEnabled(true);
+	}
+	else {
+		ui->removeExpressionButton->setEnabled(false);
+	}
+}
+
 void MainWindow::loadComplete(const QString& filename)
 {
 	_loadingDialog.reset();
@@ -307,6 +696,8 @@ void MainWindow::loadComplete(const QString& filename)
 	_lastOpenedDirectory = fi.path();
 
 	ui->basePathLineEdit->setText(_cleaner->GetBase());
+	updateWatcher();
+	resetResultsModel();
 
 	QSettings settings;
 	settings.beginGroup("Options");
@@ -317,14 +708,84 @@ void MainWindow::loadComplete(const QString& filename)
 void MainWindow::loadFailed(const QString& message)
 {
 	_loadingDialog.reset();
-	QMessageBox::critical(this, tr("Processing failed"), message, QMessageBox::Close);
+	disconnect(_cleaner.get(), &Cleaner::fileWritten, this, &MainWindow::watchCleanComplete);
+	if (!_watchRun && !_watchPending) {
+		QMessageBox::critical(this, tr("Processing failed"), message, QMessageBox::Close);
+		return;
+	}
+
+	// A report caught while it is still being written fails to load, and the next change tries again, so a dialog
+	// for every failure would only get in the way
+	_watchRun = false;
+	statusBar()->showMessage(tr("%1 could not be cleaned at %2: %3")
+		.arg(QFileInfo(ui->inputFileLineEdit->text()).fileName())
+		.arg(QTime::currentTime().toString())
+		.arg(message));
+	if (_watchPending)
+		QTimer::singleShot(0, this, &MainWindow::inputFileChanged);
+}
+
+void MainWindow::inputFileChanged()
+{
+	if (_cleaner->isRunning()) {
+		// Picked up when the current run finishes
+		_watchPending = true;
+		return;
+	}
+	_watchPending = false;
+	// Cleaning in place would rewrite the watched file, and so trigger itself
+	if (ui->outputFileLineEdit->text().isEmpty() || ui->outputFileLineEdit->text() == ui->inputFileLineEdit->text())
+		return;
+
+	// Quietly, without the progress dialog or the completion message
+	configureCleaner();
+	connect(_cleaner.get(), &Cleaner::fileWritten, this, &MainWindow::watchCleanComplete);
+	_watchRun = true;
+	statusBar()->showMessage(tr("%1 changed, cleaning again...").arg(QFileInfo(ui->inputFileLineEdit->text()).fileName()));
+	_cleaner->start();
+}
+
+void MainWindow::watchCleanComplete(const QString& filename)
+{
+	disconnect(_cleaner.get(), &Cleaner::fileWritten, this, &MainWindow::watchCleanComplete);
+	_watchRun = false;
+	resetResultsModel();
+	auto statistics = _cleaner->GetExportStatistics();
+	statusBar()->showMessage(tr("%1 cleaned again at %2: %3 of %4 results written")
+		.arg(QFileInfo(filename).fileName())
+		.arg(QTime::currentTime().toString())
+		.arg(statistics.resultsWritten)
+		.arg(statistics.resultsRead));
+	if (_watchPending)
+		QTimer::singleShot(0, this, &MainWindow::inputFileChanged);
 }
 
 void MainWindow::cleanComplete(const QString& filename)
 {
 	_loadingDialog.reset();
 	disconnect(_cleaner.get(), &Cleaner::fileWritten, this, &MainWindow::cleanComplete);
-	QMessageBox::information(this, tr("Processing complete"), tr("Cleaning complete. Output file in:\n") + filename, QMessageBox::Close);
+	resetResultsModel();
+	QString message = tr("Cleaning complete. Output file in:\n") + filename;
+	auto writtenFiles = _cleaner->GetWrittenFiles();
+	if (writtenFiles.size() > 1) {
+		message = tr("Cleaning complete. %1 output files written:\n").arg(writtenFiles.size()) + writtenFiles.join("\n");
+	}
+	auto statistics = _cleaner->GetExportStatistics();
+	if (!statistics.projectedBytes.empty()) {
+		message += tr("\n\nRemoved from the results by field projection:");
+		for (const auto& field : statistics.projectedBytes) {
+			message += QString::fromLatin1("\n  %1: %2 kB").arg(QString::fromStdString(field.first)).arg(field.second / 1024.0, 0, 'f', 1);
+		}
+	}
+	if (!statistics.duplicates.empty()) {
+		message += tr("\n\nDuplicate results removed:");
+		for (const auto& rule : statistics.duplicates) {
+			message += QString::fromLatin1("\n  %1: %2").arg(QString::fromStdString(rule.first)).arg(rule.second);
+		}
+	}
+	QMessageBox::information(this, tr("Processing complete"), message, QMessageBox::Close);
+	if (_watchPending)
+		QTimer::singleShot(0, this, &MainWindow::inputFileChanged);
 
 	QFileInfo fi(filename);
 	_lastSavedDirectory = fi.path();
@@ -345,17 +806,34 @@ void MainWindow::disableForNoInput()
 	ui->outputFileLineEdit->setDisabled(true);
 	ui->browseOutputFileButton->setDisabled(true);
 	ui->replaceURICheckbox->setDisabled(true);
+	ui->pruneRulesCheckbox->setDisabled(true);
+	ui->deduplicateCheckbox->setDisabled(true);
+	ui->projectionModeCombo->setDisabled(true);
+	ui->projectionPathsLineEdit->setDisabled(true);
+	ui->splitModeCombo->setDisabled(true);
+	ui->splitSizeSpinBox->setDisabled(true);
 	ui->browseBasePathButton->setDisabled(true);
 	ui->basePathLineEdit->setDisabled(true);
 	ui->fileFiltersLabel->setDisabled(true);
 	ui->fileFiltersTable->setDisabled(true);
 	ui->suppressedRulesLabel->setDisabled(true);
 	ui->suppressedRulesTable->setDisabled(true);
+	ui->expressionFiltersLabel->setDisabled(true);
+	ui->expressionFiltersTable->setDisabled(true);
+	ui->thresholdLabel->setDisabled(true);
+	ui->minimumLevelCombo->setDisabled(true);
+	ui->minimumRankSpinBox->setDisabled(true);
+	ui->resultsLabel->setDisabled(true);
+	ui->resultsView->setDisabled(true);
 	ui->removeRuleButton->setDisabled(true);
 	ui->newRuleButton->setDisabled(true);
+	ui->removeExpressionButton->setDisabled(true);
+	ui->newExpressionButton->setDisabled(true);
 	ui->removeFileFilterButton->setDisabled(true);
 	ui->newFileFilterButton->setDisabled(true);
 	ui->saveFiltersButton->setDisabled(true);
+	ui->fitToSizeButton->setDisabled(true);
+	ui->analyzeFiltersButton->setDisabled(true);
 	ui->loadFiltersButton->setDisabled(true);
 	ui->cleanButton->setDisabled(true);
 }
@@ -369,17 +847,34 @@ void MainWindow::enableForInput()
 	ui->outputFileLineEdit->setEnabled(true);
 	ui->browseOutputFileButton->setEnabled(true);
 	ui->replaceURICheckbox->setEnabled(true);
+	ui->pruneRulesCheckbox->setEnabled(true);
+	ui->deduplicateCheckbox->setEnabled(true);
+	ui->projectionModeCombo->setEnabled(true);
+	ui->projectionPathsLineEdit->setEnabled(ui->projectionModeCombo->currentIndex() != static_cast<int>(SARIF::ProjectionMode::None));
+	ui->splitModeCombo->setEnabled(true);
+	ui->splitSizeSpinBox->setEnabled(ui->splitModeCombo->currentIndex() == static_cast<int>(SARIF::SplitMode::BySize));
 	//ui->browseBasePathButton->setEnabled(true); // Enabled on check of replaceURICheckbox
 	//ui->basePathLineEdit->setEnabled(true); // Enabled on check of replaceURICheckbox
 	ui->fileFiltersLabel->setEnabled(true);
 	ui->fileFiltersTable->setEnabled(true);
 	ui->suppressedRulesLabel->setEnabled(true);
 	ui->suppressedRulesTable->setEnabled(true);
+	ui->expressionFiltersLabel->setEnabled(true);
+	ui->expressionFiltersTable->setEnabled(true);
+	ui->thresholdLabel->setEnabled(true);
+	ui->minimumLevelCombo->setEnabled(true);
+	ui->minimumRankSpinBox->setEnabled(true);
+	ui->resultsLabel->setEnabled(true);
+	ui->resultsView->setEnabled(true);
 	//ui->removeRuleButton->setEnabled(true); // Enabled on selection
 	ui->newRuleButton->setEnabled(true);
+	//ui->removeExpressionButton->setEnabled(true); // Enabled on selection
+	ui->newExpressionButton->setEnabled(true);
 	//ui->removeFileFilterButton->setEnabled(true); // Enabled on selection
 	ui->newFileFilterButton->setEnabled(true);
 	ui->saveFiltersButton->setEnabled(true);
+	ui->fitToSizeButton->setEnabled(true);
+	ui->analyzeFiltersButton->setEnabled(true);
 	ui->loadFiltersButton->setEnabled(true);
 	ui->cleanButton->setEnabled(true);
 }
@@ -430,7 +925,7 @@ void MainWindow::on_saveFiltersButton_clicked()
 		jsonBase.insert("application", QApplication::applicationName());
 		jsonBase.insert("applicationVersion", ui->versionLabel->text());
 		jsonBase.insert("fileFormatMajorVersion", "1");
-		jsonBase.insert("fileFormatMinorVersion", "0");
+		jsonBase.insert("fileFormatMinorVersion", "1");
 		QJsonObject data;
 
 		// Base path
@@ -459,6 +954,37 @@ void MainWindow::on_saveFiltersButton_clicked()
 		}
 		data.insert("fileFilters", fileFilters);
 
+		// Expression filters
+		QJsonArray expressionFilters;
+		for (int row = 0; row < ui->expressionFiltersTable->rowCount(); ++row) {
+			QJsonObject filter;
+			filter.insert("expression", ui->expressionFiltersTable->item(row, 0)->text());
+			filter.insert("note", ui->expressionFiltersTable->item(row, 2)->text());
+			expressionFilters.append(filter);
+		}
+		data.insert("expressionFilters", expressionFilters);
+
+		// Threshold
+		auto minimumLevel = static_cast<SARIF::Level>(ui->minimumLevelCombo->currentIndex());
+		if (minimumLevel != SARIF::Level::None || ui->minimumRankSpinBox->value() > 0) {
+			QJsonObject threshold;
+			threshold.insert("level", QString::fromStdString(SARIF::LevelName(minimumLevel)));
+			threshold.insert("rank", ui->minimumRankSpinBox->value());
+			data.insert("threshold", threshold);
+		}
+
+		data.insert("pruneRules", ui->pruneRulesCheckbox->isChecked());
+		data.insert("deduplicate", ui->deduplicateCheckbox->isChecked());
+
+		// Result projection
+		auto projectionMode = static_cast<SARIF::ProjectionMode>(ui->projectionModeCombo->currentIndex());
+		if (projectionMode != SARIF::ProjectionMode::None) {
+			QJsonObject projection;
+			projection.insert("mode", projectionMode == SARIF::ProjectionMode::Keep ? "keep" : "drop");
+			projection.insert("paths", QJsonArray::fromStringList(projectionPaths()));
+			data.insert("projection", projection);
+		}
+
 		jsonBase.insert("xdata", data);
 
 		QJsonDocument doc(jsonBase);
@@ -510,42 +1036,103 @@ void MainWindow::loadVersion1(const QJsonDocument& doc)
 		ui->replaceURICheckbox->setChecked(true);
 	}
 
-	if (data.contains("ruleFilters") && data["ruleFilters"].isArray()) {
-		QJsonArray ruleFilters = data["ruleFilters"].toArray();
-		int row = ui->suppressedRulesTable->rowCount();
-		ui->suppressedRulesTable->setRowCount(row + ruleFilters.count());
-		for (const auto& rule : ruleFilters) {
-			QString ruleText = rule.toObject()["rule"].toString();
-			QString ruleNote = rule.toObject()["note"].toString();
-
-			QTableWidgetItem* name = new QTableWidgetItem(ruleText);
-			QTableWidgetItem* note = new QTableWidgetItem(ruleNote);
-			ui->suppressedRulesTable->setItem(row, 0, name);
-			ui->suppressedRulesTable->setItem(row, 1, note);
-			_cleaner->SuppressRule(ruleText);
-			++row;
-		}
+	// Apply all of the saved filters together, so the report is only scanned once however many there are
+	QJsonArray ruleFilters = data["ruleFilters"].toArray();
+	QJsonArray fileFilters = data["fileFilters"].toArray();
+	QJsonArray expressionFilters = data["expressionFilters"].toArray();
+	SARIF::FilterProfile profile;
+	for (const auto& rule : ruleFilters)
+		profile.suppressedRules.push_back(rule.toObject()["rule"].toString().toStdString());
+	for (const auto& filter : fileFilters)
+		profile.locationFilters.push_back(filter.toObject()["regex"].toString().toStdString());
+	for (const auto& filter : expressionFilters)
+		profile.expressionFilters.push_back(filter.toObject()["expression"].toString().toStdString());
+	std::vector<int> hits;
+	try {
+		hits = _cleaner->ApplyFilterProfile(profile);
+	}
+	catch (const std::regex_error& e) {
+		QMessageBox::critical(this, tr("Load failed"), tr("Invalid file filter: %1").arg(e.what()), QMessageBox::Close);
+		return;
+	}
+	catch (const std::runtime_error& e) {
+		QMessageBox::critical(this, tr("Load failed"), QString::fromStdString(e.what()), QMessageBox::Close);
+		return;
+	}
+	auto locationHits = hits.begin() + profile.suppressedRules.size();
+	auto expressionHits = locationHits + profile.locationFilters.size();
+
+	int row = ui->suppressedRulesTable->rowCount();
+	ui->suppressedRulesTable->setRowCount(row + ruleFilters.count());
+	for (const auto& rule : ruleFilters) {
+		QString ruleText = rule.toObject()["rule"].toString();
+		QString ruleNote = rule.toObject()["note"].toString();
+
+		QTableWidgetItem* name = new QTableWidgetItem(ruleText);
+		QTableWidgetItem* note = new QTableWidgetItem(ruleNote);
+		ui->suppressedRulesTable->setItem(row, 0, name);
+		ui->suppressedRulesTable->setItem(row, 1, note);
+		++row;
+	}
+
+	row = ui->fileFiltersTable->rowCount();
+	ui->fileFiltersTable->setRowCount(row + fileFilters.count());
+	for (const auto& rule : fileFilters) {
+		QString regexText = rule.toObject()["regex"].toString();
+		QString regexNote = rule.toObject()["note"].toString();
+
+		QTableWidgetItem* regex = new QTableWidgetItem(regexText);
+		QTableWidgetItem* note = new QTableWidgetItem(regexNote);
+		QTableWidgetItem* count = new QTableWidgetItem();
+		count->setData(Qt::EditRole, *locationHits++); // Retain as integer for sorting
+		ui->fileFiltersTable->setItem(row, 0, regex);
+		ui->fileFiltersTable->setItem(row, 1, count);
+		ui->fileFiltersTable->setItem(row, 2, note);
+		++row;
+	}
+
+	row = ui->expressionFiltersTable->rowCount();
+	ui->expressionFiltersTable->setRowCount(row + expressionFilters.count());
+	for (const auto& filter : expressionFilters) {
+		QTableWidgetItem* count = new QTableWidgetItem();
+		count->setData(Qt::EditRole, *expressionHits++); // Retain as integer for sorting
+		ui->expressionFiltersTable->setItem(row, 0, new QTableWidgetItem(filter.toObject()["expression"].toString()));
+		ui->expressionFiltersTable->setItem(row, 1, count);
+		ui->expressionFiltersTable->setItem(row, 2, new QTableWidgetItem(filter.toObject()["note"].toString()));
+		++row;
 	}
 
-	if (data.contains("fileFilters") && data["fileFilters"].isArray()) {
-		QJsonArray fileFilters = data["fileFilters"].toArray();
-		int row = ui->fileFiltersTable->rowCount();
-		ui->fileFiltersTable->setRowCount(row + fileFilters.count());
-		auto currentFileList = _cleaner->GetFiles();
-		for (const auto& rule : fileFilters) {
-			QString regexText = rule.toObject()["regex"].toString();
-			QString regexNote = rule.toObject()["note"].toString();
-			auto matches = _cleaner->AddLocationFilter(regexText);
-
-			QTableWidgetItem* regex = new QTableWidgetItem(regexText);
-			QTableWidgetItem* note = new QTableWidgetItem(regexNote);
-			QTableWidgetItem* count = new QTableWidgetItem();
-			count->setData(Qt::EditRole, matches); // Retain as integer for sorting
-			ui->fileFiltersTable->setItem(row, 0, regex);
-			ui->fileFiltersTable->setItem(row, 1, count);
-			ui->fileFiltersTable->setItem(row, 2, note);
-			++row;
+	if (data.contains("threshold") && data["threshold"].isObject()) {
+		QJsonObject threshold = data["threshold"].toObject();
+		try {
+			auto level = SARIF::LevelFromName(threshold.value("level").toString("none").toStdString());
+			ui->minimumLevelCombo->setCurrentIndex(static_cast<int>(level));
+		}
+		catch (const std::runtime_error& e) {
+			QMessageBox::warning(this, tr("Threshold not loaded"), QString::fromStdString(e.what()), QMessageBox::Close);
 		}
+		ui->minimumRankSpinBox->setValue(threshold.value("rank").toInt(0));
 	}
-}
 
+	if (data.contains("pruneRules") && data["pruneRules"].isBool()) {
+		ui->pruneRulesCheckbox->setChecked(data["pruneRules"].toBool());
+	}
+
+	if (data.contains("deduplicate") && data["deduplicate"].isBool()) {
+		ui->deduplicateCheckbox->setChecked(data["deduplicate"].toBool());
+	}
+
+	if (data.contains("projection") && data["projection"].isObject()) {
+		QJsonObject projection = data["projection"].toObject();
+		auto mode = projection["mode"].toString();
+		QStringList paths;
+		for (const auto& path : projection["paths"].toArray())
+			paths.append(path.toString());
+		if (mode == "keep")
+			ui->projectionModeCombo->setCurrentIndex(static_cast<int>(SARIF::ProjectionMode::Keep));
+		else if (mode == "drop")
+			ui->projectionModeCombo->setCurrentIndex(static_cast<int>(SARIF::ProjectionMode::Drop));
+		ui->projectionPathsLineEdit->setText(paths.join(", "));
+	}
+	updateResultsModel();
+}
\ No newline at end of file
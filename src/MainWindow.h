@@ -29,6 +29,7 @@
 #pragma warning(pop) 
 
 #include <memory>
+#include <map>
 
 
 namespace Ui {
@@ -37,6 +38,9 @@ namespace Ui {
 
 class Cleaner;
 class LoadingSARIF;
+class ReportWatcher;
+class ResultTableModel;
+class FilterCoverage;
 
 /**
  * \brief The main window of the program.
@@ -78,6 +82,36 @@ protected:
 
 	void loadVersion1(const QJsonDocument& doc);
 
+	/**
+	 * \brief The result projection paths currently entered in the UI
+	 */
+	QStringList projectionPaths() const;
+
+	/**
+	 * \brief Pass the output settings in the UI to the Cleaner
+	 */
+	void configureCleaner();
+
+	/**
+	 * \brief Start or stop watching the input file, according to the watch checkbox
+	 */
+	void updateWatcher();
+
+	/**
+	 * \brief Show the results of the data the Cleaner last loaded in the results pane
+	 */
+	void resetResultsModel();
+
+	/**
+	 * \brief Show which results the filters in the UI keep, after they have changed
+	 */
+	void updateResultsModel();
+
+	/**
+	 * \brief Pass the threshold in the UI to the Cleaner, and show how many results each level would remove with it
+	 */
+	void updateThreshold();
+
 private slots:
 
 	// Auto-connected slots
@@ -88,23 +122,47 @@ private slots:
 	void on_newFileFilterButton_clicked();
 	void on_removeRuleButton_clicked();
 	void on_newRuleButton_clicked();
+	void on_removeExpressionButton_clicked();
+	void on_newExpressionButton_clicked();
 	void on_saveFiltersButton_clicked();
 	void on_loadFiltersButton_clicked();
+	void on_fitToSizeButton_clicked();
+	void on_analyzeFiltersButton_clicked();
 	void on_cleanButton_clicked();
 	void on_closeButton_clicked();
 	void on_replaceURICheckbox_stateChanged(int state);
+	void on_projectionModeCombo_currentIndexChanged(int index);
+	void on_splitModeCombo_currentIndexChanged(int index);
+	void on_watchInputCheckbox_toggled(bool checked);
+	void on_deduplicateCheckbox_toggled(bool checked);
+	void on_minimumLevelCombo_currentIndexChanged(int index);
+	void on_minimumRankSpinBox_valueChanged(int value);
 
 	void fileFilterSelectionChanged();
 	void ruleSuppressionSelectionChanged();
+	void expressionFilterSelectionChanged();
 
 	void loadComplete(const QString &filename);
 	void loadFailed(const QString &message);
 	void cleanComplete(const QString& filename);
+	void inputFileChanged();
+	void watchCleanComplete(const QString& filename);
 
 private:
 	std::unique_ptr<Ui::MainWindow> ui;
 	std::unique_ptr<Cleaner> _cleaner;
 	std::unique_ptr<LoadingSARIF> _loadingDialog;
+	std::unique_ptr<ReportWatcher> _watcher;
+	std::unique_ptr<ResultTableModel> _resultsModel;
+	std::shared_ptr<FilterCoverage> _coverage; ///< The combined effect of the filters, on the results in \a _resultsModel
+	std::map<QString, int> _ruleCoverage;      ///< The coverage handle of each suppressed rule
+	std::map<QString, int> _locationCoverage;  ///< The coverage handle of each file filter
+	std::map<QString, int> _expressionCoverage; ///< The coverage handle of each expression filter
+	int _thresholdCoverage = -1;                ///< The coverage handle of the threshold, if it removes anything
+	std::pair<int, int> _coverageThreshold = { 0, 0 }; ///< The level and rank \a _thresholdCoverage was made for
+	int _duplicateCoverage = -1;                ///< The coverage handle of the duplicate results, if they are removed
+	bool _watchPending = false; ///< The input changed while the Cleaner was busy
+	bool _watchRun = false;     ///< The current run was started by the watcher, so it reports to the status bar
 
 	QString _lastOpenedDirectory;
 	QString _lastSavedDirectory;
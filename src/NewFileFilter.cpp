@@ -30,6 +30,9 @@
 #include <QScreen>
 #pragma warning(pop)
 
+#include "FilterPreview.h"
+#include "SARIFModels.h"
+
 #include <regex>
 
 NewFileFilter::NewFileFilter(QWidget* parent) :
@@ -46,17 +49,28 @@ NewFileFilter::NewFileFilter(QWidget* parent) :
 	resize(settings.value("size", defaultSize).toSize());
 	move(settings.value("pos", upperLeft).toPoint());
 	settings.endGroup();
+
+	// Wait for a pause in the typing before starting a new preview
+	_typingTimer.setSingleShot(true);
+	_typingTimer.setInterval(200);
+	connect(&_typingTimer, &QTimer::timeout, this, &NewFileFilter::startPreview);
+	connect(ui->regexLineEdit, &QLineEdit::textEdited, &_typingTimer, qOverload<>(&QTimer::start));
 }
 
 NewFileFilter::~NewFileFilter()
 {
 }
 
-void NewFileFilter::SetFiles(const QStringList& allFiles)
+void NewFileFilter::SetReport(std::shared_ptr<const SARIF> report)
 {
-	_allFiles = allFiles;
+	_matches = std::make_unique<UriListModel>(report);
+	ui->resultsList->setModel(_matches.get());
+	_preview = std::make_unique<FilterPreview>(std::move(report));
+	connect(_preview.get(), &FilterPreview::matchesFound, this, &NewFileFilter::previewMatchesFound);
+	connect(_preview.get(), &FilterPreview::finished, this, &NewFileFilter::previewFinished);
+	connect(_preview.get(), &FilterPreview::failed, this, &NewFileFilter::previewFailed);
 	ui->regexLineEdit->setText(".*");
-	on_testButton_clicked();
+	startPreview();
 }
 
 QString NewFileFilter::GetFilter() const
@@ -78,16 +92,14 @@ QString NewFileFilter::GetNote() const
 
 int NewFileFilter::GetNumberOfMatches() const
 {
-	auto regex = ui->regexLineEdit->text().toStdString();
+	// Usually the preview of the final expression has already finished
+	auto regex = ui->regexLineEdit->text();
+	if (regex == _previewRegex)
+		return _previewMatches;
+	if (!_preview)
+		return 0;
 	try {
-		auto re = std::regex(regex);
-		int matches = 0;
-		for (auto file = _allFiles.begin(); file != _allFiles.end(); ++file) {
-			if (std::regex_search(file->toStdString(), re)) {
-				++matches;
-			}
-		}
-		return matches;
+		return _preview->Count(regex);
 	}
 	catch (const std::regex_error&) {
 		return 0;
@@ -96,26 +108,56 @@ int NewFileFilter::GetNumberOfMatches() const
 
 void NewFileFilter::on_testButton_clicked()
 {
-	ui->resultsList->clear();
-	auto regex = ui->regexLineEdit->text().toStdString();
 	try {
-		auto re = std::regex(regex);
-		for (auto file = _allFiles.begin(); file != _allFiles.end(); ++file) {
-			if (std::regex_search(file->toStdString(), re)) {
-				ui->resultsList->addItem(*file);
-			}
-		}
-		ui->numberOfMatchesLabel->setText(QString::number(ui->resultsList->count()));
+		std::regex re(ui->regexLineEdit->text().toStdString());
 	}
 	catch (const std::regex_error& e) {
 		QMessageBox::critical(this, tr("Invalid Regular Expression"), e.what());
+		return;
 	}
+	startPreview();
+}
+
+void NewFileFilter::startPreview()
+{
+	_typingTimer.stop();
+	if (!_preview)
+		return;
+	_previewRegex.clear();
+	_matches->Clear();
+	ui->numberOfMatchesLabel->setText(tr("Searching..."));
+	_preview->Start(ui->regexLineEdit->text());
+}
+
+void NewFileFilter::previewMatchesFound(int generation, const QVector<int>& uris)
+{
+	// Ignore anything still queued from a run that has since been superseded
+	if (generation != _preview->Generation())
+		return;
+	_matches->Append(uris);
+	ui->numberOfMatchesLabel->setText(tr("%1 so far...").arg(_matches->rowCount()));
+}
+
+void NewFileFilter::previewFinished(int generation, int matches)
+{
+	if (generation != _preview->Generation())
+		return;
+	_previewMatches = matches;
+	_previewRegex = ui->regexLineEdit->text();
+	ui->numberOfMatchesLabel->setText(QString::number(matches));
+}
+
+void NewFileFilter::previewFailed(int generation, const QString& message)
+{
+	if (generation != _preview->Generation())
+		return;
+	ui->numberOfMatchesLabel->setText(tr("Invalid regular expression: %1").arg(message));
 }
 
-std::tuple<QString, QString, int> NewFileFilter::GetNewFileFilter(QWidget* parent, const QStringList& allFiles)
+std::tuple<QString, QString, int> NewFileFilter::GetNewFileFilter(QWidget* parent, std::shared_ptr<const SARIF> report)
 {
 	NewFileFilter dialog(parent);
-	dialog.SetFiles(allFiles);
+	dialog.SetReport(std::move(report));
 	auto result = dialog.exec();
 	if (result == QDialog::Accepted) {
 		return std::make_tuple(dialog.GetFilter(), dialog.GetNote(), dialog.GetNumberOfMatches());
@@ -25,6 +25,7 @@
 
 #pragma warning(push, 1) 
 #include <QDialog>
+#include <QTimer>
 #pragma warning(pop) 
 
 #include <memory>
@@ -34,8 +35,15 @@ namespace Ui {
 	class NewFileFilter;
 }
 
+class FilterPreview;
+class SARIF;
+class UriListModel;
+
 /**
- * \brief 
+ * \brief A dialog for entering a location filter, previewing the files it matches as it is typed
+ *
+ * The matching runs on a background thread, a short while after the user stops typing, and the matches
+ * are added to the list as they are found.
  */
 class NewFileFilter : public QDialog
 {
@@ -45,7 +53,10 @@ public:
 	explicit NewFileFilter(QWidget* parent);
 	~NewFileFilter();
 
-	void SetFiles(const QStringList& allFiles);
+	/**
+	 * \brief Preview the filter against the files of \a report, which is kept alive for as long as the dialog is
+	 */
+	void SetReport(std::shared_ptr<const SARIF> report);
 
 	QString GetFilter() const;
 
@@ -53,7 +64,7 @@ public:
 
 	int GetNumberOfMatches() const;
 
-	static std::tuple<QString,QString,int> GetNewFileFilter(QWidget* parent, const QStringList &allFiles);
+	static std::tuple<QString,QString,int> GetNewFileFilter(QWidget* parent, std::shared_ptr<const SARIF> report);
 
 public slots:
 
@@ -62,10 +73,18 @@ public slots:
 private slots:
 
 	void on_testButton_clicked();
+	void startPreview();
+	void previewMatchesFound(int generation, const QVector<int>& uris);
+	void previewFinished(int generation, int matches);
+	void previewFailed(int generation, const QString& message);
 
 private:
 	std::unique_ptr<Ui::NewFileFilter> ui;
-	QStringList _allFiles;
+	std::unique_ptr<FilterPreview> _preview;
+	std::unique_ptr<UriListModel> _matches;
+	QTimer _typingTimer;
+	int _previewMatches = 0;
+	QString _previewRegex; ///< The expression \a _previewMatches is for, once its preview has finished
 };
 
 
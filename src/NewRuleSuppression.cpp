@@ -29,6 +29,11 @@
 #include <QScreen>
 #pragma warning(pop)
 
+#include "SARIFModels.h"
+
+#include <numeric>
+#include <algorithm>
+
 NewRuleSuppression::NewRuleSuppression(QWidget* parent) : 
 	QDialog(parent), 
 	ui(new Ui::NewRuleSuppression)
@@ -44,39 +49,54 @@ NewRuleSuppression::NewRuleSuppression(QWidget* parent) :
 	move(settings.value("pos", upperLeft).toPoint());
 	settings.endGroup();
 
-	ui->tableWidget->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+	// Only the count column is sized to its contents: measuring every rule name would defeat the model's laziness
+	ui->tableView->horizontalHeader()->setStretchLastSection(false);
+	connect(ui->filterLineEdit, &QLineEdit::textChanged, this, [this](const QString& text) {
+		if (_model)
+			_model->SetFilter(text);
+	});
+	connect(ui->tagComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
+		if (_model && index >= 0)
+			_model->SetTag(ui->tagComboBox->itemData(index).toInt());
+	});
 }
 
 NewRuleSuppression::~NewRuleSuppression()
 {
 }
 
-void NewRuleSuppression::SetRulesList(const std::vector<std::tuple<QString, int>>& ruleList)
+void NewRuleSuppression::SetReport(std::shared_ptr<const SARIF> report)
 {
-	ui->tableWidget->setRowCount(static_cast<int>(ruleList.size()));
+	// The tags come from the load-time index, with their result counts, so the rules can be grouped without
+	// reading the rule descriptors again
+	const auto& tags = report->DistinctTags();
+	auto tagResults = report->ResultsPerTag();
+	std::vector<int> tagOrder(tags.size());
+	std::iota(tagOrder.begin(), tagOrder.end(), 0);
+	std::sort(tagOrder.begin(), tagOrder.end(), [&tags](int a, int b) { return tags[a] < tags[b]; });
+	ui->tagComboBox->blockSignals(true);
+	ui->tagComboBox->clear();
+	ui->tagComboBox->addItem(tr("Any"), -1);
+	for (auto tag : tagOrder)
+		ui->tagComboBox->addItem(tr("%1 (%2 results)").arg(QString::fromStdString(tags[tag])).arg(tagResults[tag]), tag);
+	ui->tagComboBox->blockSignals(false);
+	ui->tagComboBox->setEnabled(!tags.empty());
 
-	int row = 0;
-	for (const auto &rule : ruleList) {
-		QTableWidgetItem* name = new QTableWidgetItem(std::get<0>(rule));
-		QTableWidgetItem* count = new QTableWidgetItem();
-		count->setData(Qt::EditRole, std::get<1>(rule)); // Make sure to add as an integer so it sorts correctly
-		ui->tableWidget->setItem(row, 0, name);
-		ui->tableWidget->setItem(row, 1, count);
-		++row;
-	}
+	_model = std::make_unique<RuleTableModel>(std::move(report));
+	ui->tableView->setModel(_model.get());
+	ui->tableView->sortByColumn(RuleTableModel::RuleColumn, Qt::AscendingOrder);
+	ui->tableView->horizontalHeader()->setSectionResizeMode(RuleTableModel::RuleColumn, QHeaderView::Stretch);
+	ui->tableView->horizontalHeader()->setSectionResizeMode(RuleTableModel::CountColumn, QHeaderView::ResizeToContents);
+	ui->tableView->horizontalHeader()->setSectionResizeMode(RuleTableModel::TagsColumn, QHeaderView::Stretch);
 }
 
 QStringList NewRuleSuppression::GetSelectedRules() const
 {
 	QStringList rules;
-	auto selection = ui->tableWidget->selectedRanges();
-	for (auto range = selection.begin(); range != selection.end(); ++range) {
-		int firstRow = range->topRow();
-		int lastRow = range->bottomRow();
-		for (int row = firstRow; row <= lastRow; ++row) {
-			rules.append(ui->tableWidget->item(row, 0)->text());
-		}
-	}
+	if (!_model)
+		return rules;
+	for (const auto& index : ui->tableView->selectionModel()->selectedRows())
+		rules.append(_model->Rule(index.row()));
 	return rules;
 }
 
@@ -85,10 +105,10 @@ QString NewRuleSuppression::GetNote() const
 	return ui->noteLineEdit->text();
 }
 
-std::tuple<QStringList, QString> NewRuleSuppression::GetNewRuleSuppression(QWidget* parent, const std::vector<std::tuple<QString, int>>& ruleList)
+std::tuple<QStringList, QString> NewRuleSuppression::GetNewRuleSuppression(QWidget* parent, std::shared_ptr<const SARIF> report)
 {
 	NewRuleSuppression dialog (parent);
-	dialog.SetRulesList(ruleList);
+	dialog.SetReport(std::move(report));
 	auto result = dialog.exec();
 	if (result == QDialog::Accepted) {
 		return std::make_tuple(dialog.GetSelectedRules(), dialog.GetNote());
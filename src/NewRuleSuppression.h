@@ -34,8 +34,11 @@ namespace Ui {
 	class NewRuleSuppression;
 }
 
+class SARIF;
+class RuleTableModel;
+
 /**
- * \brief 
+ * \brief A dialog for choosing rules to suppress, from a sortable and searchable table of a report's rules
  */
 class NewRuleSuppression : public QDialog
 {
@@ -45,12 +48,15 @@ public:
 	explicit NewRuleSuppression(QWidget* parent);
 	~NewRuleSuppression();
 
-	void SetRulesList(const std::vector<std::tuple<QString, int>>& ruleList);
+	/**
+	 * \brief Show the rules of \a report, which is kept alive for as long as the dialog is
+	 */
+	void SetReport(std::shared_ptr<const SARIF> report);
 
 	QStringList GetSelectedRules() const;
 	QString GetNote() const;
 
-	static std::tuple<QStringList, QString> GetNewRuleSuppression(QWidget* parent, const std::vector<std::tuple<QString, int>>& ruleList);
+	static std::tuple<QStringList, QString> GetNewRuleSuppression(QWidget* parent, std::shared_ptr<const SARIF> report);
 
 public slots:
 
@@ -58,6 +64,7 @@ public slots:
 
 private:
 	std::unique_ptr<Ui::NewRuleSuppression> ui;
+	std::unique_ptr<RuleTableModel> _model;
 };
 
 
@@ -0,0 +1,140 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ReportCache.h"
+
+#include <stdexcept>
+
+ReportCache::ReportCache(size_t memoryBudget) :
+	_budget(memoryBudget)
+{
+}
+
+std::string ReportCache::Key(const std::string& file)
+{
+	std::error_code error;
+	auto path = std::filesystem::absolute(file, error);
+	if (error)
+		return file;
+	return path.lexically_normal().string();
+}
+
+std::shared_ptr<const SARIF> ReportCache::Get(const std::string& file, bool* wasCached)
+{
+	auto key = ReportCache::Key(file);
+	std::error_code error;
+	auto modified = std::filesystem::last_write_time(key, error);
+	if (error)
+		throw std::runtime_error("Cannot read " + file);
+	auto size = std::filesystem::file_size(key, error);
+	if (error)
+		throw std::runtime_error("Cannot read " + file);
+
+	auto found = _lookup.find(key);
+	if (found != _lookup.end()) {
+		if (found->second->modified == modified && found->second->size == size) {
+			_entries.splice(_entries.begin(), _entries, found->second);
+			if (wasCached)
+				*wasCached = true;
+			return found->second->report;
+		}
+		Evict(key);
+	}
+
+	if (wasCached)
+		*wasCached = false;
+	auto report = std::make_shared<const SARIF>(key);
+	Entry entry;
+	entry.file = key;
+	entry.modified = modified;
+	entry.size = size;
+	entry.report = report;
+	entry.cost = report->MemoryFootprint();
+	_entries.push_front(entry);
+	_lookup[key] = _entries.begin();
+	_used += entry.cost;
+	Trim();
+	return report;
+}
+
+std::shared_ptr<const FingerprintSet> ReportCache::Fingerprints(const std::string& file, bool* wasCached)
+{
+	auto report = Get(file, wasCached);
+	// Get() leaves the report at the front, even when it is over budget on its own
+	auto& entry = _entries.front();
+	if (!entry.fingerprints) {
+		entry.fingerprints = std::make_shared<const FingerprintSet>(report->Fingerprints());
+		const size_t cost = entry.fingerprints->MemoryFootprint();
+		entry.cost += cost;
+		_used += cost;
+		Trim();
+	}
+	return entry.fingerprints;
+}
+
+void ReportCache::Evict(const std::string& file)
+{
+	auto found = _lookup.find(ReportCache::Key(file));
+	if (found == _lookup.end())
+		return;
+	_used -= found->second->cost;
+	_entries.erase(found->second);
+	_lookup.erase(found);
+}
+
+void ReportCache::Clear()
+{
+	_entries.clear();
+	_lookup.clear();
+	_used = 0;
+}
+
+size_t ReportCache::MemoryBudget() const
+{
+	return _budget;
+}
+
+void ReportCache::SetMemoryBudget(size_t memoryBudget)
+{
+	_budget = memoryBudget;
+	Trim();
+}
+
+size_t ReportCache::MemoryUsed() const
+{
+	return _used;
+}
+
+size_t ReportCache::Size() const
+{
+	return _entries.size();
+}
+
+void ReportCache::Trim()
+{
+	// Anything handed out already stays alive through its shared_ptr, so eviction is always safe
+	while (_used > _budget && _entries.size() > 1) {
+		_used -= _entries.back().cost;
+		_lookup.erase(_entries.back().file);
+		_entries.pop_back();
+	}
+}
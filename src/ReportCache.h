@@ -0,0 +1,114 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CLEANSARIF_REPORTCACHE_H_
+#define _CLEANSARIF_REPORTCACHE_H_
+
+#include "SARIF.h"
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <filesystem>
+
+/**
+ * \brief Loaded SARIF files, kept in memory under a budget and evicted least-recently-used first
+ *
+ * Entries are keyed by absolute path, and are reloaded if the file's size or modification time has
+ * changed since it was loaded. The cached objects are shared and must not be modified.
+ * \note Not thread-safe: use it from a single thread, or guard it externally.
+ */
+class ReportCache
+{
+public:
+
+	/**
+	 * \brief Create an empty cache
+	 * \param memoryBudget The approximate number of bytes the cached reports may use, as measured by
+	 * SARIF::MemoryFootprint(). The most recently used report is always kept, even if it is over budget.
+	 */
+	explicit ReportCache(size_t memoryBudget);
+
+	/**
+	 * \brief Get a report, loading it if it is not cached or has changed on disk
+	 * \param file The path of the SARIF file
+	 * \param wasCached If not null, set to whether the report was already in the cache
+	 * \throws std::runtime_error if the file has to be loaded and cannot be
+	 */
+	std::shared_ptr<const SARIF> Get(const std::string& file, bool* wasCached = nullptr);
+
+	/**
+	 * \brief The fingerprints of the results in a report, e.g. to use it as a baseline, computed the first time they
+	 * are asked for and then cached with the report
+	 * \see Get(), SARIF::Fingerprints()
+	 */
+	std::shared_ptr<const FingerprintSet> Fingerprints(const std::string& file, bool* wasCached = nullptr);
+
+	/**
+	 * \brief Drop \a file from the cache, if it is there
+	 */
+	void Evict(const std::string& file);
+
+	/**
+	 * \brief Drop everything
+	 */
+	void Clear();
+
+	size_t MemoryBudget() const;
+
+	/**
+	 * \brief Change the budget, evicting reports if the cache is now over it
+	 */
+	void SetMemoryBudget(size_t memoryBudget);
+
+	/**
+	 * \brief The memory currently used by the cached reports
+	 */
+	size_t MemoryUsed() const;
+
+	/**
+	 * \brief The number of cached reports
+	 */
+	size_t Size() const;
+
+private:
+
+	struct Entry {
+		std::string file;
+		std::filesystem::file_time_type modified;
+		std::uintmax_t size = 0;
+		std::shared_ptr<const SARIF> report;
+		std::shared_ptr<const FingerprintSet> fingerprints; ///< Null until Fingerprints() is first called
+		size_t cost = 0;
+	};
+
+	void Trim();
+	static std::string Key(const std::string& file);
+
+	std::list<Entry> _entries; ///< Most recently used first
+	std::unordered_map<std::string, std::list<Entry>::iterator> _lookup;
+	size_t _budget;
+	size_t _used = 0;
+};
+
+#endif // _CLEANSARIF_REPORTCACHE_H_
@@ -0,0 +1,89 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ReportWatcher.h"
+
+#pragma warning(push, 1) 
+#include <QFileInfo>
+#pragma warning(pop)
+
+ReportWatcher::ReportWatcher(const QString& file, int debounceMilliseconds, QObject* parent) :
+	QObject(parent),
+	_file(file)
+{
+	QFileInfo info(_file);
+	if (info.exists()) {
+		_size = info.size();
+		_modified = info.lastModified();
+	}
+	_debounce.setSingleShot(true);
+	_debounce.setInterval(debounceMilliseconds);
+	connect(&_watcher, &QFileSystemWatcher::fileChanged, this, &ReportWatcher::fileChanged);
+	connect(&_debounce, &QTimer::timeout, this, &ReportWatcher::settled);
+	rewatch();
+}
+
+QString ReportWatcher::File() const
+{
+	return _file;
+}
+
+int ReportWatcher::DebounceInterval() const
+{
+	return _debounce.interval();
+}
+
+void ReportWatcher::SetDebounceInterval(int milliseconds)
+{
+	_debounce.setInterval(milliseconds);
+}
+
+void ReportWatcher::fileChanged(const QString& file)
+{
+	Q_UNUSED(file);
+	rewatch();
+
+	// Every further change restarts the wait
+	_debounce.start();
+}
+
+void ReportWatcher::settled()
+{
+	rewatch();
+	QFileInfo info(_file);
+	if (!info.exists()) {
+		// Deleted, presumably to be written again: keep checking until it reappears
+		_debounce.start();
+		return;
+	}
+	if (info.size() == _size && info.lastModified() == _modified)
+		return;
+	_size = info.size();
+	_modified = info.lastModified();
+	emit reportChanged(_file);
+}
+
+void ReportWatcher::rewatch()
+{
+	if (!_watcher.files().contains(_file) && QFileInfo::exists(_file))
+		_watcher.addPath(_file);
+}
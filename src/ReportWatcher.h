@@ -0,0 +1,88 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CLEANSARIF_REPORTWATCHER_H_
+#define _CLEANSARIF_REPORTWATCHER_H_
+
+#pragma warning(push, 1) 
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QDateTime>
+#pragma warning(pop)
+
+/**
+ * \brief Notices when a report file is rewritten, once the writes have stopped
+ *
+ * Analyzers often write a report in several bursts, or replace it by renaming a new file over it, so
+ * change notifications are coalesced: reportChanged() is only emitted once the file has been left alone
+ * for the debounce interval, and only if its size or modification time actually differ from the last
+ * time it was reported. A file that is replaced or temporarily deleted continues to be watched.
+ * \note Uses QFileSystemWatcher, so it relies on the platform's native notifications (e.g. inotify on Linux).
+ */
+class ReportWatcher : public QObject {
+
+	Q_OBJECT
+
+public:
+
+	/**
+	 * \brief Start watching \a file
+	 * \param debounceMilliseconds How long the file must go unchanged before reportChanged() is emitted
+	 */
+	explicit ReportWatcher(const QString& file, int debounceMilliseconds = 500, QObject* parent = nullptr);
+
+	~ReportWatcher() = default;
+
+	QString File() const;
+
+	int DebounceInterval() const;
+
+	void SetDebounceInterval(int milliseconds);
+
+signals:
+
+	/**
+	 * \brief The file has changed and has since been left alone for the debounce interval
+	 */
+	void reportChanged(const QString& file);
+
+private slots:
+
+	void fileChanged(const QString& file);
+	void settled();
+
+private:
+
+	/**
+	 * \brief Watch the file again if it was replaced, which drops the watch on some platforms
+	 */
+	void rewatch();
+
+	QString _file;
+	QFileSystemWatcher _watcher;
+	QTimer _debounce;
+	qint64 _size = -1;
+	QDateTime _modified;
+};
+
+#endif // _CLEANSARIF_REPORTWATCHER_H_
@@ -0,0 +1,212 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ResultBitmap.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+void ResultBitmap::Add(uint32_t id)
+{
+	auto& container = ContainerFor(static_cast<uint16_t>(id >> 16));
+	const auto low = static_cast<uint16_t>(id & 0xFFFF);
+	if (container.bits.empty()) {
+		if (container.array.empty() || container.array.back() < low) {
+			container.array.push_back(low);
+		}
+		else {
+			auto position = std::lower_bound(container.array.begin(), container.array.end(), low);
+			if (*position == low)
+				return;
+			container.array.insert(position, low);
+		}
+		++container.count;
+		if (container.count > ArrayLimit)
+			ConvertToBitmap(container);
+	}
+	else {
+		auto& word = container.bits[low / 64];
+		const uint64_t bit = uint64_t(1) << (low % 64);
+		if ((word & bit) == 0) {
+			word |= bit;
+			++container.count;
+		}
+	}
+}
+
+bool ResultBitmap::Contains(uint32_t id) const
+{
+	const auto key = static_cast<uint16_t>(id >> 16);
+	auto container = std::lower_bound(_containers.begin(), _containers.end(), key,
+		[](const Container& c, uint16_t k) { return c.key < k; });
+	return container != _containers.end() && container->key == key && ContainerContains(*container, static_cast<uint16_t>(id & 0xFFFF));
+}
+
+size_t ResultBitmap::Count() const
+{
+	size_t count = 0;
+	for (const auto& container : _containers)
+		count += container.count;
+	return count;
+}
+
+bool ResultBitmap::IsEmpty() const
+{
+	return _containers.empty();
+}
+
+size_t ResultBitmap::CountAnd(const ResultBitmap& other) const
+{
+	size_t count = 0;
+	auto a = _containers.begin();
+	auto b = other._containers.begin();
+	while (a != _containers.end() && b != other._containers.end()) {
+		if (a->key < b->key) {
+			++a;
+		}
+		else if (b->key < a->key) {
+			++b;
+		}
+		else {
+			count += ContainerCountAnd(*a, *b);
+			++a;
+			++b;
+		}
+	}
+	return count;
+}
+
+ResultBitmap& ResultBitmap::operator|=(const ResultBitmap& other)
+{
+	for (const auto& source : other._containers) {
+		auto& container = ContainerFor(source.key);
+		if (source.bits.empty()) {
+			for (auto low : source.array)
+				Add((static_cast<uint32_t>(source.key) << 16) | low);
+			continue;
+		}
+		if (container.bits.empty())
+			ConvertToBitmap(container);
+		container.count = 0;
+		for (size_t word = 0; word < BitmapWords; ++word) {
+			container.bits[word] |= source.bits[word];
+			container.count += PopCount(container.bits[word]);
+		}
+	}
+	return *this;
+}
+
+bool ResultBitmap::operator==(const ResultBitmap& rhs) const
+{
+	if (_containers.size() != rhs._containers.size())
+		return false;
+	for (size_t i = 0; i < _containers.size(); ++i) {
+		const auto& a = _containers[i];
+		const auto& b = rhs._containers[i];
+		// The representation depends on the order the ids were added in, so compare the contents
+		if (a.key != b.key || a.count != b.count || ContainerCountAnd(a, b) != a.count)
+			return false;
+	}
+	return true;
+}
+
+bool ResultBitmap::operator!=(const ResultBitmap& rhs) const
+{
+	return !(*this == rhs);
+}
+
+size_t ResultBitmap::MemoryFootprint() const
+{
+	size_t footprint = sizeof(ResultBitmap) + _containers.capacity() * sizeof(Container);
+	for (const auto& container : _containers)
+		footprint += container.array.capacity() * sizeof(uint16_t) + container.bits.capacity() * sizeof(uint64_t);
+	return footprint;
+}
+
+ResultBitmap::Container& ResultBitmap::ContainerFor(uint16_t key)
+{
+	if (!_containers.empty() && _containers.back().key == key)
+		return _containers.back();
+	auto container = std::lower_bound(_containers.begin(), _containers.end(), key,
+		[](const Container& c, uint16_t k) { return c.key < k; });
+	if (container == _containers.end() || container->key != key) {
+		container = _containers.insert(container, Container());
+		container->key = key;
+	}
+	return *container;
+}
+
+void ResultBitmap::ConvertToBitmap(Container& container)
+{
+	container.bits.assign(BitmapWords, 0);
+	for (auto low : container.array)
+		container.bits[low / 64] |= uint64_t(1) << (low % 64);
+	container.array.clear();
+	container.array.shrink_to_fit();
+}
+
+size_t ResultBitmap::ContainerCountAnd(const Container& a, const Container& b)
+{
+	size_t count = 0;
+	if (!a.bits.empty() && !b.bits.empty()) {
+		for (size_t word = 0; word < BitmapWords; ++word)
+			count += PopCount(a.bits[word] & b.bits[word]);
+	}
+	else {
+		// Probe the other container with each entry of an array
+		const auto& array = a.bits.empty() ? a : b;
+		const auto& probed = a.bits.empty() ? b : a;
+		for (auto low : array.array)
+			count += ContainerContains(probed, low) ? 1 : 0;
+	}
+	return count;
+}
+
+bool ResultBitmap::ContainerContains(const Container& container, uint16_t low)
+{
+	if (container.bits.empty())
+		return std::binary_search(container.array.begin(), container.array.end(), low);
+	return (container.bits[low / 64] >> (low % 64)) & 1;
+}
+
+int ResultBitmap::CountTrailingZeros(uint64_t bits)
+{
+#if defined(_MSC_VER)
+	unsigned long index = 0;
+	_BitScanForward64(&index, bits);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
+
+int ResultBitmap::PopCount(uint64_t bits)
+{
+#if defined(_MSC_VER)
+	return static_cast<int>(__popcnt64(bits));
+#else
+	return __builtin_popcountll(bits);
+#endif
+}
@@ -0,0 +1,134 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CLEANSARIF_RESULTBITMAP_H_
+#define _CLEANSARIF_RESULTBITMAP_H_
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * \brief A compressed set of result ids, in the style of a roaring bitmap
+ *
+ * The 32-bit ids are split into 65536 chunks by their high 16 bits. A chunk holding only a few ids stores them as a
+ * sorted array of their low 16 bits, and one holding more than 4096 switches to a plain 8 kB bitmap, so a set
+ * costs at most about two bytes per id however its ids are spread, and set operations work a chunk at a time.
+ * Adding ids in ascending order, as a scan of the index does, only ever appends.
+ */
+class ResultBitmap {
+
+public:
+
+	ResultBitmap() = default;
+
+	/**
+	 * \brief Add \a id to the set, if it is not already in it
+	 */
+	void Add(uint32_t id);
+
+	bool Contains(uint32_t id) const;
+
+	/**
+	 * \brief The number of ids in the set
+	 */
+	size_t Count() const;
+
+	bool IsEmpty() const;
+
+	/**
+	 * \brief The number of ids in both this set and \a other
+	 */
+	size_t CountAnd(const ResultBitmap& other) const;
+
+	/**
+	 * \brief Add every id of \a other to this set
+	 */
+	ResultBitmap& operator|=(const ResultBitmap& other);
+
+	bool operator==(const ResultBitmap& rhs) const;
+
+	bool operator!=(const ResultBitmap& rhs) const;
+
+	/**
+	 * \brief Call \a visit with each id in the set, in ascending order
+	 */
+	template<typename Visitor>
+	void ForEach(Visitor visit) const
+	{
+		for (const auto& container : _containers) {
+			const uint32_t high = static_cast<uint32_t>(container.key) << 16;
+			if (container.bits.empty()) {
+				for (auto low : container.array)
+					visit(high | low);
+			}
+			else {
+				for (size_t word = 0; word < container.bits.size(); ++word) {
+					for (auto bits = container.bits[word]; bits != 0; bits &= bits - 1)
+						visit(high | static_cast<uint32_t>(word * 64 + CountTrailingZeros(bits)));
+				}
+			}
+		}
+	}
+
+	/**
+	 * \brief The approximate memory used by the set, in bytes
+	 */
+	size_t MemoryFootprint() const;
+
+private:
+
+	/**
+	 * \brief The ids of one chunk: either \a array or \a bits is used, never both
+	 */
+	struct Container {
+		uint16_t key = 0;             ///< The high 16 bits shared by every id in the chunk
+		std::vector<uint16_t> array;  ///< The sorted low 16 bits, while there are at most ArrayLimit of them
+		std::vector<uint64_t> bits;   ///< Otherwise, one bit per possible low 16 bits
+		size_t count = 0;
+	};
+
+	static constexpr size_t ArrayLimit = 4096;
+	static constexpr size_t BitmapWords = 65536 / 64;
+
+	/**
+	 * \brief The container for \a key, created if there isn't one yet
+	 */
+	Container& ContainerFor(uint16_t key);
+
+	/**
+	 * \brief Switch \a container from an array to a bitmap
+	 */
+	static void ConvertToBitmap(Container& container);
+
+	static bool ContainerContains(const Container& container, uint16_t low);
+
+	static size_t ContainerCountAnd(const Container& a, const Container& b);
+
+	static int CountTrailingZeros(uint64_t bits);
+
+	static int PopCount(uint64_t bits);
+
+	std::vector<Container> _containers; ///< Sorted by key
+};
+
+#endif // _CLEANSARIF_RESULTBITMAP_H_
@@ -24,6 +24,16 @@
 
 #include <exception>
 #include <regex>
+#include <cctype>
+#include <unordered_map>
+#include <set>
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <numeric>
+#include <cmath>
 
 #pragma warning(push, 1) 
 #include <QFile>
@@ -42,7 +52,34 @@ void SARIF::Load(const std::string& file, std::function<bool(void)> interruption
 	QFile infile(QString::fromStdString(file));
 	if (!infile.open(QIODevice::ReadOnly | QIODevice::Text))
 		throw std::runtime_error("Unable to open specified file");
-	auto fileContents = infile.readAll();
+	Load(infile, interruptionRequested);
+}
+
+void SARIF::Load(QIODevice& input, std::function<bool(void)> interruptionRequested)
+{
+	LoadDocument(input, QJsonDocument(), Index(), interruptionRequested);
+}
+
+size_t SARIF::Reload(const std::string& file, std::function<bool(void)> interruptionRequested)
+{
+	QFile infile(QString::fromStdString(file));
+	if (!infile.open(QIODevice::ReadOnly | QIODevice::Text))
+		throw std::runtime_error("Unable to open specified file");
+	return Reload(infile, interruptionRequested);
+}
+
+size_t SARIF::Reload(QIODevice& input, std::function<bool(void)> interruptionRequested)
+{
+	// Holding on to the previous index keeps it alive even if this object was its only owner
+	auto previousJson = _json;
+	auto previousIndex = _index;
+	return LoadDocument(input, previousJson, *previousIndex, interruptionRequested);
+}
+
+size_t SARIF::LoadDocument(QIODevice& input, const QJsonDocument& previousJson, const Index& previousIndex,
+	std::function<bool(void)> interruptionRequested)
+{
+	auto fileContents = input.readAll();
 	_json = QJsonDocument::fromJson(fileContents);
 	if (_json.isNull())
 		throw std::runtime_error("File does not contain valid JSON data");
@@ -52,21 +89,7 @@ void SARIF::Load(const std::string& file, std::function<bool(void)> interruption
 	if (o.contains("$schema") && o["$schema"].isString()) {
 		auto schema = o["$schema"].toString();
 		if (schema.contains("sarif")) {
-			std::string base;
-			if (o.contains("runs") && o["runs"].isArray()) {
-				auto runs = o["runs"].toArray().first().toObject();
-				if (runs.contains("results") && runs["results"].isArray()) {
-					auto resultArray = runs["results"].toArray();
-					for (auto result = resultArray.begin(); result != resultArray.end() && !interruptionRequested(); ++result) {
-						auto uri = SARIF::GetArtifactUri(result->toObject());
-						if (base.empty())
-							base = uri;
-						else
-							base = SARIF::MaxMatch(base, uri);
-					}
-				}
-			}
-			_originalBasePath = base;
+			return BuildIndex(interruptionRequested, previousJson, previousIndex);
 		}
 		else {
 			throw std::runtime_error("File read and JSON parsed, but schema is not SARIF");
@@ -77,35 +100,156 @@ void SARIF::Load(const std::string& file, std::function<bool(void)> interruption
 	}
 }
 
-void SARIF::Export(const std::string& file, std::function<bool(void)> interruptionRequested) const
+SARIF::ExportStatistics SARIF::Export(const std::string& file, std::function<bool(void)> interruptionRequested) const
+{
+	auto documents = FilterDocuments({ &_filters }, interruptionRequested);
+	return WriteDocument(file, documents.front(), _filters, nullptr, interruptionRequested);
+}
+
+SARIF::ExportStatistics SARIF::Export(QIODevice& output, std::function<bool(void)> interruptionRequested) const
+{
+	auto documents = FilterDocuments({ &_filters }, interruptionRequested);
+	ExportStatistics statistics;
+	auto bytes = SerializeDocument(documents.front(), _filters, nullptr, interruptionRequested, statistics);
+	if (output.write(bytes) != bytes.size())
+		throw std::runtime_error("Could not write the output");
+	return statistics;
+}
+
+std::vector<std::pair<std::string, SARIF::ExportStatistics>> SARIF::ExportSplit(const std::string& file, SplitMode mode, size_t maximumBytes,
+	std::function<bool(void)> interruptionRequested) const
+{
+	if (mode == SplitMode::None)
+		return { std::make_pair(file, Export(file, interruptionRequested)) };
+	if (mode == SplitMode::BySize && maximumBytes == 0)
+		throw std::runtime_error("A maximum file size is required to split by size");
+
+	auto documents = FilterDocuments({ &_filters }, interruptionRequested);
+	const auto& document = documents.front();
+
+	// A single pass over the surviving results assigns each one to an output, stored as a list of positions
+	// in FilteredRun::results for each run
+	std::vector<std::string> labels;
+	std::vector<std::vector<std::vector<size_t>>> selections;
+	auto newOutput = [&](const std::string& label) {
+		labels.push_back(label);
+		selections.emplace_back(document.runs.size());
+		return selections.size() - 1;
+	};
+
+	if (mode == SplitMode::ByDirectory) {
+		std::map<std::string, size_t> outputOfComponent;
+		for (size_t run = 0; run < document.runs.size(); ++run) {
+			const auto& ids = document.runs[run].ids;
+			for (size_t result = 0; result < ids.size(); ++result) {
+				auto component = SARIF::TopLevelComponent(_index->uris[_index->uriOf[ids[result]]], _originalBasePath);
+				auto found = outputOfComponent.find(component);
+				if (found == outputOfComponent.end())
+					found = outputOfComponent.emplace(component, newOutput(component)).first;
+				selections[found->second][run].push_back(result);
+			}
+		}
+	}
+	else {
+		// Everything apart from the results is repeated in every file, so that comes out of each file's allowance
+		const size_t allowance = maximumBytes > _index->baseBytes ? maximumBytes - _index->baseBytes : 0;
+		size_t currentBytes = 0;
+		size_t currentCount = 0;
+		size_t output = newOutput("1");
+		for (size_t run = 0; run < document.runs.size(); ++run) {
+			const auto& ids = document.runs[run].ids;
+			for (size_t result = 0; result < ids.size(); ++result) {
+				auto bytes = _index->bytes[ids[result]];
+				if (currentCount > 0 && currentBytes + bytes > allowance) {
+					output = newOutput(std::to_string(labels.size() + 1));
+					currentBytes = 0;
+					currentCount = 0;
+				}
+				selections[output][run].push_back(result);
+				currentBytes += bytes;
+				++currentCount;
+			}
+		}
+	}
+
+	std::filesystem::path basePath(file);
+	auto extension = basePath.has_extension() ? basePath.extension().string() : std::string(".sarif");
+	std::vector<std::pair<std::string, ExportStatistics>> outputs;
+	std::set<std::string> used; // Lower case, as different labels can sanitize to names that differ only by case
+	for (const auto& label : labels) {
+		const auto stem = basePath.stem().string() + "_" + SARIF::SanitizeFilename(label);
+		auto name = stem + extension;
+		for (int copy = 2;; ++copy) {
+			auto folded = name;
+			std::transform(folded.begin(), folded.end(), folded.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+			if (used.insert(folded).second)
+				break;
+			name = stem + "-" + std::to_string(copy) + extension;
+		}
+		outputs.emplace_back((basePath.parent_path() / name).string(), ExportStatistics());
+	}
+
+	// Each output is assembled and written independently, so they can all be written at the same time
+	SARIF::ParallelFor(outputs.size(), [&](size_t output) {
+		outputs[output].second = WriteDocument(outputs[output].first, document, _filters, &selections[output], interruptionRequested);
+	});
+
+	return outputs;
+}
+
+std::vector<SARIF::ExportStatistics> SARIF::ExportProfiles(const std::vector<std::pair<FilterProfile, std::string>>& outputs,
+	std::function<bool(void)> interruptionRequested) const
+{
+	std::vector<const FilterProfile*> profiles;
+	for (const auto& output : outputs)
+		profiles.push_back(&output.first);
+	auto documents = FilterDocuments(profiles, interruptionRequested);
+
+	std::vector<ExportStatistics> statistics(outputs.size());
+	SARIF::ParallelFor(outputs.size(), [&](size_t output) {
+		statistics[output] = WriteDocument(outputs[output].second, documents[output], outputs[output].first, nullptr, interruptionRequested);
+	});
+	return statistics;
+}
+
+std::vector<SARIF::FilteredDocument> SARIF::FilterDocuments(const std::vector<const FilterProfile*>& profiles,
+	std::function<bool(void)> interruptionRequested) const
 {
-	// Pre-compile the regular expressions
-	std::vector<std::regex> compiledRegexes;
-	for (const auto &regex : _locationFilters) {
-		compiledRegexes.emplace_back(regex);
+	std::vector<FilteredDocument> documents(profiles.size());
+
+	// Decide the fate of every result under every profile up front, using the index
+	std::vector<std::vector<bool>> kept;
+	for (size_t profile = 0; profile < profiles.size(); ++profile) {
+		std::vector<int> duplicates(_index->rules.size(), 0);
+		kept.push_back(KeptResults(*profiles[profile], &duplicates, &documents[profile].unchanged));
+		for (size_t rule = 0; rule < duplicates.size(); ++rule) {
+			if (duplicates[rule] > 0)
+				documents[profile].duplicates[_index->rules[rule]] = duplicates[rule];
+		}
 	}
 
+	uint32_t resultId = 0;
 	auto o = _json.object();
-	QJsonObject outputObject;
-	std::string sarifVersion = "2.1.0"; // The default, if there isn't one in the file
 	for (auto element = o.begin(); element != o.end() && !interruptionRequested(); ++element) {
 		if (element.key() == QString::fromLatin1("version")) {
 			// Do NOT output the version here. The SARIF standard requires that the version line be first, even
 			// though JSON is unordered. Store it, and we'll insert it manually once we're done writing the file.
-			sarifVersion = element.value().toString().toStdString();
+			for (auto& document : documents)
+				document.version = element.value().toString().toStdString();
 		}
 		else if (element.key() != QString::fromLatin1("runs")) {
-			outputObject.insert(element.key(), element.value());
+			for (auto& document : documents)
+				document.root.insert(element.key(), element.value());
 		}
 		else {
 			if (!element->isArray())
 				throw std::runtime_error("runs element is not an array");
+			for (auto& document : documents)
+				document.hasRuns = true;
 			auto oldRunsArray = element->toArray();
-			
-			QJsonArray newRunsArray;
 			for (auto run = oldRunsArray.begin(); run != oldRunsArray.end() && !interruptionRequested(); ++run) {
 				auto runObject = run->toObject();
-				QJsonObject newRunObject;
+				std::vector<FilteredRun> filteredRuns(profiles.size());
 				for (auto runComponent = runObject.begin(); runComponent != runObject.end() && !interruptionRequested(); ++runComponent) {
 					if (runComponent.key() == "artifacts") {
 						// For now, strip out all of the artifacts
@@ -113,46 +257,117 @@ void SARIF::Export(const std::string& file, std::function<bool(void)> interrupti
 					else if (runComponent.key() == "results") {
 						if (!runComponent->isArray())
 							throw std::runtime_error("results element is not an array");
+						for (auto& filteredRun : filteredRuns)
+							filteredRun.hasResults = true;
 						QJsonArray oldResultsArray = runComponent->toArray();
-						QJsonArray filteredResultsArray;
-						for (auto result = oldResultsArray.begin(); result != oldResultsArray.end() && !interruptionRequested(); ++result) {
-
-							bool required = true;
-
-							// Change the base uri
-							if (_overrideBase) {
-								SARIF::ReplaceUri(_originalBasePath, _overrideBaseWith, *result);
-							}
+						for (auto result = oldResultsArray.begin(); result != oldResultsArray.end() && !interruptionRequested(); ++result, ++resultId) {
+							for (size_t profile = 0; profile < profiles.size(); ++profile) {
+								++documents[profile].resultsRead;
+								if (!kept[profile][resultId])
+									continue;
 
-							// Filter based on the rule
-							auto rule = SARIF::GetRule(result->toObject());
-							if (std::find(_suppressedRules.begin(), _suppressedRules.end(), rule) != _suppressedRules.end()) {
-								required = false;
-							}
-
-							// Filter based on the filename
-							auto uri = SARIF::GetArtifactUri(result->toObject());
-							for (const auto& re : compiledRegexes) {
-								if (std::regex_search(uri, re)) {
-									required = false;
-									break;
+								QJsonValue resultCopy = *result;
+								if (profiles[profile]->overrideBase) {
+									// Change the base uri
+									QJsonArray wrapper{ resultCopy };
+									SARIF::ReplaceUri(_originalBasePath, profiles[profile]->base, wrapper[0]);
+									resultCopy = wrapper[0];
 								}
-							}
-
-							if (required) {
-								filteredResultsArray.push_back(*result);
+								filteredRuns[profile].results.push_back(resultCopy);
+								filteredRuns[profile].ids.push_back(resultId);
 							}
 						}
-						newRunObject.insert("results", filteredResultsArray);
 					}
 					else {
-						newRunObject.insert(runComponent.key(), runComponent.value());
+						for (auto& filteredRun : filteredRuns)
+							filteredRun.run.insert(runComponent.key(), runComponent.value());
 					}
 				}
-				newRunsArray.append(newRunObject);
+				for (size_t profile = 0; profile < profiles.size(); ++profile)
+					documents[profile].runs.push_back(std::move(filteredRuns[profile]));
+			}
+		}
+	}
+
+	if (interruptionRequested())
+		throw std::runtime_error("Export was cancelled");
+
+	return documents;
+}
+
+SARIF::ExportStatistics SARIF::WriteDocument(const std::string& file, const FilteredDocument& document, const FilterProfile& profile,
+	const std::vector<std::vector<size_t>>* selection, std::function<bool(void)> interruptionRequested) const
+{
+	ExportStatistics statistics;
+	auto finishedByteArray = SerializeDocument(document, profile, selection, interruptionRequested, statistics);
+
+	// Write out the copy
+	QFile newFile(QString::fromStdString(file));
+	newFile.open(QIODevice::OpenModeFlag::Truncate | QIODevice::OpenModeFlag::WriteOnly);
+	if (newFile.isOpen())
+		newFile.write(finishedByteArray);
+	else
+		throw std::runtime_error("Could not open requested file for writing");
+
+	return statistics;
+}
+
+SARIF::ProjectionNode SARIF::BuildProjection(const std::vector<std::string>& paths)
+{
+	ProjectionNode projection;
+	for (const auto& path : paths) {
+		auto node = &projection;
+		for (const auto& component : QString::fromStdString(path).split('/', Qt::SkipEmptyParts))
+			node = &node->children[component];
+	}
+	return projection;
+}
+
+QByteArray SARIF::SerializeDocument(const FilteredDocument& document, const FilterProfile& profile,
+	const std::vector<std::vector<size_t>>* selection, std::function<bool(void)> interruptionRequested, ExportStatistics& statistics) const
+{
+	statistics.resultsRead = document.resultsRead;
+	statistics.duplicates = document.duplicates;
+	statistics.unchanged = document.unchanged;
+
+	auto projection = SARIF::BuildProjection(profile.projectionPaths);
+	const bool project = profile.projectionMode != ProjectionMode::None && !profile.projectionPaths.empty();
+
+	QJsonObject outputObject = document.root;
+	if (document.hasRuns) {
+		QJsonArray newRunsArray;
+		for (size_t run = 0; run < document.runs.size() && !interruptionRequested(); ++run) {
+			const auto& filteredRun = document.runs[run];
+			QJsonObject newRunObject = filteredRun.run;
+			if (filteredRun.hasResults) {
+				QJsonArray filteredResultsArray;
+				auto write = [&](size_t result) {
+					if (project)
+						filteredResultsArray.push_back(SARIF::Project(filteredRun.results[result], projection, profile.projectionMode, "", statistics.projectedBytes));
+					else
+						filteredResultsArray.push_back(filteredRun.results[result]);
+					++statistics.resultsWritten;
+				};
+				if (selection) {
+					for (auto result : (*selection)[run])
+						write(result);
+				}
+				else {
+					for (size_t result = 0; result < filteredRun.results.size(); ++result)
+						write(result);
+				}
+
+				// The rules live in the tool object, so they can only be pruned once all of the results are known
+				if (profile.pruneRules && newRunObject.contains("tool") && newRunObject["tool"].isObject()) {
+					auto tool = newRunObject["tool"].toObject();
+					SARIF::RemoveUnusedRules(tool, filteredResultsArray);
+					newRunObject.insert("tool", tool);
+				}
+				newRunObject.insert("results", filteredResultsArray);
 			}
-			outputObject.insert("runs", newRunsArray);
+			newRunsArray.append(newRunObject);
 		}
+		outputObject.insert("runs", newRunsArray);
 	}
 	QJsonDocument filteredJSONDoc(outputObject);
 
@@ -164,7 +379,7 @@ void SARIF::Export(const std::string& file, std::function<bool(void)> interrupti
 	// Now manipulate that byte array to insert the version information:
 	QByteArray finishedByteArray;
 	bool versionWritten = false;
-	std::string versionInfo = std::string("\n    \"version\": \"") + sarifVersion + "\",";
+	std::string versionInfo = std::string("\n    \"version\": \"") + document.version + "\",";
 	for (const auto& byte : jsonBytes) {
 		finishedByteArray.append(byte);
 		if (!versionWritten && byte == '{') {
@@ -173,43 +388,40 @@ void SARIF::Export(const std::string& file, std::function<bool(void)> interrupti
 		}
 	}
 
-	// Write out the copy
-	QFile newFile(QString::fromStdString(file));
-	newFile.open(QIODevice::OpenModeFlag::Truncate | QIODevice::OpenModeFlag::WriteOnly);
-	if (newFile.isOpen())
-		newFile.write(finishedByteArray);
-	else
-		throw std::runtime_error("Could not open requested file for writing");
-
+	return finishedByteArray;
 }
 
 std::vector<std::tuple<std::string, std::string>> SARIF::Rules() const
 {
+	// A rule described by more than one run is listed once, with the first run's description
 	std::vector<std::tuple<std::string, std::string>> ruleTuples;
+	std::set<std::string> listed;
 	auto o = _json.object();
 	if (o.contains("runs") && o["runs"].isArray()) {
-		auto runs = o["runs"].toArray().first().toObject();
-		if (runs.contains("tool") && runs["tool"].isObject()) {
-			auto tool = runs["tool"].toObject();
-			if (tool.contains("driver") && tool["driver"].isObject()) {
-				auto driver = tool["driver"].toObject();
-				if (driver.contains("rules") && driver["rules"].isArray()) {
-					auto rules = driver["rules"].toArray();
-					for (auto rule = rules.begin(); rule != rules.end(); ++rule) {
-						if (rule->isObject()) {
-							auto ruleObject = rule->toObject();
-							std::string id;
-							if (ruleObject.contains("id")) 
-								id = ruleObject["id"].toString().toStdString();
-							std::string text;
-							if (ruleObject.contains("shortDescription") && ruleObject["shortDescription"].toObject().contains("text"))
-								text = ruleObject["shortDescription"].toObject()["text"].toString().toStdString();
-							else if (ruleObject.contains("fullDescription") && ruleObject["fullDescription"].toObject().contains("text"))
-								text = ruleObject["fullDescription"].toObject()["text"].toString().toStdString();
-							else if (ruleObject.contains("help") && ruleObject["fullDescription"].toObject().contains("text"))
-								text = ruleObject["help"].toObject()["text"].toString().toStdString();
-							if (!id.empty())
-								ruleTuples.emplace_back(id, text);
+		for (const auto& run : o["runs"].toArray()) {
+			auto runObject = run.toObject();
+			if (runObject.contains("tool") && runObject["tool"].isObject()) {
+				auto tool = runObject["tool"].toObject();
+				if (tool.contains("driver") && tool["driver"].isObject()) {
+					auto driver = tool["driver"].toObject();
+					if (driver.contains("rules") && driver["rules"].isArray()) {
+						auto rules = driver["rules"].toArray();
+						for (auto rule = rules.begin(); rule != rules.end(); ++rule) {
+							if (rule->isObject()) {
+								auto ruleObject = rule->toObject();
+								std::string id;
+								if (ruleObject.contains("id")) 
+									id = ruleObject["id"].toString().toStdString();
+								std::string text;
+								if (ruleObject.contains("shortDescription") && ruleObject["shortDescription"].toObject().contains("text"))
+									text = ruleObject["shortDescription"].toObject()["text"].toString().toStdString();
+								else if (ruleObject.contains("fullDescription") && ruleObject["fullDescription"].toObject().contains("text"))
+									text = ruleObject["fullDescription"].toObject()["text"].toString().toStdString();
+								else if (ruleObject.contains("help") && ruleObject["fullDescription"].toObject().contains("text"))
+									text = ruleObject["help"].toObject()["text"].toString().toStdString();
+								if (!id.empty() && listed.insert(id).second)
+									ruleTuples.emplace_back(id, text);
+							}
 						}
 					}
 				}
@@ -221,117 +433,756 @@ std::vector<std::tuple<std::string, std::string>> SARIF::Rules() const
 
 std::set<std::string> SARIF::Files() const
 {
+	// The index holds the distinct URIs of every run's results
 	std::set<std::string> files;
-	auto o = _json.object();
-	if (o.contains("runs") && o["runs"].isArray()) {
-		auto runs = o["runs"].toArray().first().toObject();
-		if (runs.contains("results") && runs["results"].isArray()) {
-			auto resultArray = runs["results"].toArray();
-			for (auto result = resultArray.begin(); result != resultArray.end(); ++result) {
-				auto uri = SARIF::GetArtifactUri(result->toObject());
-				if (_overrideBase && SARIF::MaxMatch(uri, _overrideBaseWith) == _overrideBaseWith) {
-					files.insert(uri.substr(_overrideBaseWith.size()));
-				}
-				else {
-					files.insert(uri);
-				}
-			}
+	for (const auto& uri : _index->uris) {
+		if (_filters.overrideBase && SARIF::MaxMatch(uri, _filters.base) == _filters.base) {
+			files.insert(uri.substr(_filters.base.size()));
+		}
+		else {
+			files.insert(uri);
 		}
 	}
 	return files;
 }
 
+const std::vector<std::string>& SARIF::DistinctRules() const
+{
+	return _index->rules;
+}
+
+const std::vector<std::string>& SARIF::DistinctUris() const
+{
+	return _index->uris;
+}
+
+std::vector<int> SARIF::ResultsPerRule() const
+{
+	std::vector<int> counts(_index->rules.size(), 0);
+	for (auto rule : _index->ruleOf)
+		++counts[rule];
+	return counts;
+}
+
+std::vector<int> SARIF::ResultsPerUri() const
+{
+	std::vector<int> counts(_index->uris.size(), 0);
+	for (auto uri : _index->uriOf)
+		++counts[uri];
+	return counts;
+}
+
+const std::vector<std::string>& SARIF::DistinctTags() const
+{
+	return _index->tags;
+}
+
+const std::vector<uint32_t>& SARIF::TagsOfRule(uint32_t rule) const
+{
+	return _index->ruleTags[rule];
+}
+
+const ResultBitmap& SARIF::RulesWithTag(uint32_t tag) const
+{
+	return _index->tagRules[tag];
+}
+
+std::vector<int> SARIF::ResultsPerTag() const
+{
+	return _index->tagResults;
+}
+
+ResultBitmap SARIF::RulesMatchingTag(const std::string& pattern) const
+{
+	ResultBitmap rules;
+	for (size_t tag = 0; tag < _index->tags.size(); ++tag) {
+		if (FilterExpression::MatchesTag(pattern, _index->tags[tag]))
+			rules |= _index->tagRules[tag];
+	}
+	return rules;
+}
+
+ResultBitmap SARIF::TagMatches(const std::string& pattern) const
+{
+	auto rules = RulesMatchingTag(pattern);
+	ResultBitmap matches;
+	rules.ForEach([this, &matches](uint32_t rule) { matches |= _index->ruleResults[rule]; });
+	return matches;
+}
+
+size_t SARIF::ResultCount() const
+{
+	return _index->ruleOf.size();
+}
+
+uint32_t SARIF::RuleOf(size_t result) const
+{
+	return _index->ruleOf[result];
+}
+
+uint32_t SARIF::UriOf(size_t result) const
+{
+	return _index->uriOf[result];
+}
+
+uint32_t SARIF::LineOf(size_t result) const
+{
+	return _index->lineOf[result];
+}
+
+uint32_t SARIF::EndLineOf(size_t result) const
+{
+	return _index->endLineOf[result];
+}
+
+SARIF::Level SARIF::LevelOf(size_t result) const
+{
+	return _index->levelOf[result];
+}
+
+uint8_t SARIF::RankOf(size_t result) const
+{
+	return _index->rankOf[result];
+}
+
+uint64_t SARIF::FingerprintOf(size_t result) const
+{
+	return _index->fingerprintOf[result];
+}
+
+FingerprintSet SARIF::Fingerprints() const
+{
+	FingerprintSet fingerprints(_index->fingerprintOf.size());
+	for (auto fingerprint : _index->fingerprintOf)
+		fingerprints.Insert(fingerprint);
+	return fingerprints;
+}
+
+std::string SARIF::MessageOf(size_t result) const
+{
+	// The last run that starts at or before this id is the one it is in (runs without results start at the same id)
+	const auto& starts = _index->runStarts;
+	auto run = std::upper_bound(starts.begin(), starts.end(), static_cast<uint32_t>(result)) - starts.begin() - 1;
+	if (run < 0)
+		return std::string();
+	auto runObject = _json.object()["runs"].toArray().at(static_cast<int>(run)).toObject();
+	auto resultObject = runObject["results"].toArray().at(static_cast<int>(result - starts[run])).toObject();
+	auto message = resultObject["message"].toObject();
+	if (message.contains("text") && message["text"].isString())
+		return message["text"].toString().toStdString();
+	else if (message.contains("id") && message["id"].isString())
+		return message["id"].toString().toStdString();
+	return std::string();
+}
+
 std::string SARIF::GetBase() const
 {
-	if (_overrideBase)
-		return _overrideBaseWith;
+	if (_filters.overrideBase)
+		return _filters.base;
 	else
 		return _originalBasePath;
 }
 
 void SARIF::SetBase(const std::string& newBase)
 {
-	_overrideBase = true;
-	_overrideBaseWith = newBase;
+	_filters.overrideBase = true;
+	_filters.base = newBase;
 }
 
 std::map<std::string, int> SARIF::GetRules() const
 {
+	// Counted from the index, so every run's results are included
 	std::map<std::string, int> rules;
-	int counter = 0;
-	auto o = _json.object();
-	if (o.contains("runs") && o["runs"].isArray()) {
-		auto runs = o["runs"].toArray().first().toObject();
-		if (runs.contains("results") && runs["results"].isArray()) {
-			auto resultArray = runs["results"].toArray();
-			for (auto result = resultArray.begin(); result != resultArray.end(); ++result) {
-				auto key = SARIF::GetRule(result->toObject());
-				if (rules.find(key) == rules.end())
-					rules[key] = 0;
-				rules[key]++;
-			}
-		}
-	}
+	for (size_t rule = 0; rule < _index->rules.size(); ++rule)
+		rules[_index->rules[rule]] = static_cast<int>(_index->ruleResults[rule].Count());
 	return rules;
 }
 
 int SARIF::SuppressRule(const std::string& ruleID)
 {
-	_suppressedRules.push_back(ruleID);
+	_filters.suppressedRules.push_back(ruleID);
+	return RuleHits(ruleID);
+}
 
-	int counter = 0;
-	auto o = _json.object();
-	if (o.contains("runs") && o["runs"].isArray()) {
-		auto runs = o["runs"].toArray().first().toObject();
-		if (runs.contains("results") && runs["results"].isArray()) {
-			auto resultArray = runs["results"].toArray();
-			for (auto result = resultArray.begin(); result != resultArray.end(); ++result) {
-				if (SARIF::GetRule(result->toObject()) == ruleID)
-					++counter;
-			}
-		}
-	}
-	return counter;
+int SARIF::RuleHits(const std::string& ruleID) const
+{
+	auto rule = std::find(_index->rules.begin(), _index->rules.end(), ruleID);
+	if (rule == _index->rules.end())
+		return 0;
+	return static_cast<int>(_index->ruleResults[rule - _index->rules.begin()].Count());
 }
 
 void SARIF::UnsuppressRule(const std::string& ruleID)
 {
-	_suppressedRules.erase(std::remove(_suppressedRules.begin(), _suppressedRules.end(), ruleID), _suppressedRules.end());
+	_filters.suppressedRules.erase(std::remove(_filters.suppressedRules.begin(), _filters.suppressedRules.end(), ruleID), _filters.suppressedRules.end());
 }
 
 std::vector<std::string> SARIF::SuppressedRules() const
 {
-	return _suppressedRules;
+	return _filters.suppressedRules;
 }
 
 int SARIF::AddLocationFilter(const std::string& regex)
 {
-	_locationFilters.push_back(regex);
+	_filters.locationFilters.push_back(regex);
+	_filters.compiledLocationFilters.reset();
+	return LocationHits(regex);
+}
+
+int SARIF::LocationHits(const std::string& regex) const
+{
 	std::regex compiledRegex(regex);
-	int counter = 0;
-	auto o = _json.object();
-	if (o.contains("runs") && o["runs"].isArray()) {
-		auto runs = o["runs"].toArray().first().toObject();
-		if (runs.contains("results") && runs["results"].isArray()) {
-			auto resultArray = runs["results"].toArray();
-			for (auto result = resultArray.begin(); result != resultArray.end(); ++result) {
-				if (std::regex_search(SARIF::GetArtifactUri(result->toObject()), compiledRegex)) {
-					++counter;
-				}
-			}
+	int hits = 0;
+	for (size_t uri = 0; uri < _index->uris.size(); ++uri) {
+		if (std::regex_search(_index->uris[uri], compiledRegex))
+			hits += _index->uriResults[uri];
+	}
+	return hits;
+}
+
+std::vector<int> SARIF::FilterHits(const FilterProfile& profile) const
+{
+	std::shared_ptr<const std::vector<std::regex>> compiledRegexes = profile.compiledLocationFilters;
+	if (!compiledRegexes || compiledRegexes->size() != profile.locationFilters.size()) {
+		FilterProfile compiled = profile;
+		compiled.Compile();
+		compiledRegexes = compiled.compiledLocationFilters;
+	}
+
+	// The counts of every rule and URI are kept in the index, so no result is visited
+	std::vector<int> hits;
+	std::unordered_map<std::string, uint32_t> ruleIds;
+	for (uint32_t rule = 0; rule < _index->rules.size(); ++rule)
+		ruleIds.emplace(_index->rules[rule], rule);
+	for (const auto& rule : profile.suppressedRules) {
+		auto found = ruleIds.find(rule);
+		hits.push_back(found == ruleIds.end() ? 0 : static_cast<int>(_index->ruleResults[found->second].Count()));
+	}
+
+	// Each regular expression is only run once per distinct URI
+	std::vector<int> locationHits(compiledRegexes->size(), 0);
+	SARIF::ParallelFor(compiledRegexes->size(), [this, &compiledRegexes, &locationHits](size_t filter) {
+		const auto& compiledRegex = (*compiledRegexes)[filter];
+		for (size_t uri = 0; uri < _index->uris.size(); ++uri) {
+			if (std::regex_search(_index->uris[uri], compiledRegex))
+				locationHits[filter] += _index->uriResults[uri];
 		}
+	});
+	hits.insert(hits.end(), locationHits.begin(), locationHits.end());
+
+	for (const auto& expression : profile.expressionFilters)
+		hits.push_back(static_cast<int>(ExpressionMatches(expression).Count()));
+	return hits;
+}
+
+std::vector<int> SARIF::ApplyFilterProfile(const FilterProfile& profile)
+{
+	auto hits = FilterHits(profile);
+	_filters.suppressedRules.insert(_filters.suppressedRules.end(), profile.suppressedRules.begin(), profile.suppressedRules.end());
+	_filters.locationFilters.insert(_filters.locationFilters.end(), profile.locationFilters.begin(), profile.locationFilters.end());
+	_filters.expressionFilters.insert(_filters.expressionFilters.end(), profile.expressionFilters.begin(), profile.expressionFilters.end());
+	_filters.compiledLocationFilters.reset();
+	_filters.compiledExpressionFilters.reset();
+	return hits;
+}
+
+ResultBitmap SARIF::RuleMatches(const std::string& ruleID) const
+{
+	auto rule = std::find(_index->rules.begin(), _index->rules.end(), ruleID);
+	if (rule == _index->rules.end())
+		return ResultBitmap();
+	return _index->ruleResults[rule - _index->rules.begin()];
+}
+
+ResultBitmap SARIF::LocationMatches(const std::string& regex) const
+{
+	std::regex compiledRegex(regex);
+	std::vector<bool> matchingUris(_index->uris.size());
+	for (size_t uri = 0; uri < _index->uris.size(); ++uri)
+		matchingUris[uri] = std::regex_search(_index->uris[uri], compiledRegex);
+
+	ResultBitmap matches;
+	for (size_t result = 0; result < _index->uriOf.size(); ++result) {
+		if (matchingUris[_index->uriOf[result]])
+			matches.Add(static_cast<uint32_t>(result));
 	}
-	return counter;
+	return matches;
+}
+
+FilterCoverage SARIF::Coverage(const FilterProfile& profile) const
+{
+	FilterCoverage coverage(_index->ruleOf.size());
+	for (const auto& rule : profile.suppressedRules)
+		coverage.Add(RuleMatches(rule));
+	for (const auto& regex : profile.locationFilters)
+		coverage.Add(LocationMatches(regex));
+	for (const auto& expression : profile.expressionFilters)
+		coverage.Add(ExpressionMatches(expression));
+	if (profile.minimumLevel != Level::None || profile.minimumRank > 0)
+		coverage.Add(ThresholdMatches(profile.minimumLevel, profile.minimumRank));
+	if (profile.lineRanges)
+		coverage.Add(LineRangeMatches(*profile.lineRanges));
+	if (profile.baseline)
+		coverage.Add(BaselineMatches(*profile.baseline));
+	// Duplicates are found among the results the other filters leave, as KeptResults() does
+	if (profile.deduplicate)
+		coverage.Add(DuplicateMatches(coverage.Union()));
+	return coverage;
+}
+
+SARIF::FilterAnalysis SARIF::AnalyzeFilters(const FilterProfile& profile, size_t similarity) const
+{
+	FilterAnalysis analysis;
+	for (const auto& rule : profile.suppressedRules)
+		analysis.filters.push_back({ true, rule });
+	for (const auto& regex : profile.locationFilters)
+		analysis.filters.push_back({ false, regex });
+	const size_t count = analysis.filters.size();
+
+	// Nearly all of the time goes on running each regular expression over the distinct URIs
+	std::vector<ResultBitmap> matches(count);
+	SARIF::ParallelFor(count, [this, &analysis, &matches](size_t filter) {
+		const auto& pattern = analysis.filters[filter].pattern;
+		matches[filter] = analysis.filters[filter].isRule ? RuleMatches(pattern) : LocationMatches(pattern);
+	});
+
+	FilterCoverage coverage(ResultCount());
+	std::vector<int> handles;
+	for (const auto& bitmap : matches)
+		handles.push_back(coverage.Add(bitmap));
+	analysis.results = coverage.Results();
+	analysis.removed = coverage.Removed();
+	for (size_t filter = 0; filter < count; ++filter) {
+		analysis.filters[filter].matches = coverage.Matches(handles[filter]);
+		analysis.filters[filter].unique = coverage.Marginal(handles[filter]);
+	}
+
+	analysis.overlap.assign(count, std::vector<size_t>(count, 0));
+	SARIF::ParallelFor(count, [&analysis, &matches, count](size_t i) {
+		analysis.overlap[i][i] = analysis.filters[i].matches;
+		for (size_t j = i + 1; j < count; ++j)
+			analysis.overlap[i][j] = matches[i].CountAnd(matches[j]);
+	});
+	for (size_t i = 0; i < count; ++i) {
+		for (size_t j = 0; j < i; ++j)
+			analysis.overlap[i][j] = analysis.overlap[j][i];
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		const auto& filter = analysis.filters[i];
+		if (filter.matches == 0) {
+			analysis.dead.push_back(i);
+			continue;
+		}
+		for (size_t j = 0; j < count; ++j) {
+			if (j == i || analysis.filters[j].matches == 0)
+				continue;
+			const auto both = analysis.overlap[i][j];
+			const bool identical = both == filter.matches && both == analysis.filters[j].matches;
+			if (both == filter.matches && (!identical || j < i))
+				analysis.subsumed.emplace_back(i, j);
+			const auto difference = filter.matches + analysis.filters[j].matches - 2 * both;
+			if (j > i && difference > 0 && difference <= similarity)
+				analysis.similar.emplace_back(i, j);
+		}
+	}
+
+	// A filter is only redundant if the filters that are not themselves reported still cover it, so that deleting
+	// every redundant filter removes the same results. Later filters go first, as for \a subsumed.
+	for (size_t i = count; i-- > 0;) {
+		if (analysis.filters[i].matches > 0 && coverage.Marginal(handles[i]) == 0) {
+			analysis.redundant.push_back(i);
+			coverage.Remove(handles[i]);
+		}
+	}
+	std::reverse(analysis.redundant.begin(), analysis.redundant.end());
+	return analysis;
 }
 
 void SARIF::RemoveLocationFilter(const std::string& regex)
 {
-	_locationFilters.erase(std::remove(_locationFilters.begin(), _locationFilters.end(), regex), _locationFilters.end());
+	_filters.locationFilters.erase(std::remove(_filters.locationFilters.begin(), _filters.locationFilters.end(), regex), _filters.locationFilters.end());
+	_filters.compiledLocationFilters.reset();
 }
 
 std::vector<std::string> SARIF::LocationFilters() const
 {
-	return _locationFilters;
+	return _filters.locationFilters;
+}
+
+int SARIF::AddExpressionFilter(const std::string& expression)
+{
+	auto hits = ExpressionHits(expression);
+	_filters.expressionFilters.push_back(expression);
+	_filters.compiledExpressionFilters.reset();
+	return hits;
+}
+
+int SARIF::ExpressionHits(const std::string& expression) const
+{
+	return static_cast<int>(ExpressionMatches(expression).Count());
+}
+
+ResultBitmap SARIF::ExpressionMatches(const std::string& expression) const
+{
+	auto program = CompileExpression(FilterExpression(expression));
+	const auto columns = ExpressionColumns();
+
+	// Each thread collects the matches in its own block of results, which are then added in order
+	const size_t results = _index->ruleOf.size();
+	const size_t blockSize = 1 << 16;
+	const size_t blocks = (results + blockSize - 1) / blockSize;
+	std::vector<std::vector<uint32_t>> blockMatches(blocks);
+	SARIF::ParallelFor(blocks, [results, blockSize, &program, &columns, &blockMatches](size_t block) {
+		const size_t end = std::min(results, (block + 1) * blockSize);
+		for (size_t result = block * blockSize; result < end; ++result) {
+			if (program.Matches(columns, result))
+				blockMatches[block].push_back(static_cast<uint32_t>(result));
+		}
+	});
+	ResultBitmap matches;
+	for (const auto& block : blockMatches) {
+		for (auto result : block)
+			matches.Add(result);
+	}
+	return matches;
+}
+
+void SARIF::RemoveExpressionFilter(const std::string& expression)
+{
+	_filters.expressionFilters.erase(std::remove(_filters.expressionFilters.begin(), _filters.expressionFilters.end(), expression),
+		_filters.expressionFilters.end());
+	_filters.compiledExpressionFilters.reset();
+}
+
+std::vector<std::string> SARIF::ExpressionFilters() const
+{
+	return _filters.expressionFilters;
+}
+
+int SARIF::SetThreshold(Level minimumLevel, int minimumRank)
+{
+	_filters.minimumLevel = minimumLevel;
+	_filters.minimumRank = minimumRank;
+	return ThresholdHits(minimumLevel, minimumRank);
+}
+
+int SARIF::ThresholdHits(Level minimumLevel, int minimumRank) const
+{
+	// The results without a rank are in the last column, which no threshold reaches
+	const auto levels = static_cast<size_t>(minimumLevel);
+	const auto ranks = static_cast<size_t>(SARIF::RankThreshold(minimumRank));
+	int hits = 0;
+	for (size_t level = 0; level < _index->levelRanks.size(); ++level) {
+		const auto& counts = _index->levelRanks[level];
+		hits += std::accumulate(counts.begin(), level < levels ? counts.end() : counts.begin() + ranks, 0);
+	}
+	return hits;
+}
+
+ResultBitmap SARIF::ThresholdMatches(Level minimumLevel, int minimumRank) const
+{
+	const auto rank = SARIF::RankThreshold(minimumRank);
+	ResultBitmap matches;
+	for (size_t result = 0; result < _index->levelOf.size(); ++result) {
+		if (_index->levelOf[result] < minimumLevel || _index->rankOf[result] < rank)
+			matches.Add(static_cast<uint32_t>(result));
+	}
+	return matches;
+}
+
+ResultBitmap SARIF::LineRangeMatches(const LineRanges& ranges) const
+{
+	std::vector<const std::vector<LineRanges::Range>*> uriRanges;
+	for (const auto& uri : _index->uris)
+		uriRanges.push_back(ranges.Find(uri));
+
+	ResultBitmap matches;
+	for (size_t result = 0; result < _index->uriOf.size(); ++result) {
+		auto fileRanges = uriRanges[_index->uriOf[result]];
+		if (!fileRanges || !LineRanges::Overlaps(*fileRanges, _index->lineOf[result], _index->endLineOf[result]))
+			matches.Add(static_cast<uint32_t>(result));
+	}
+	return matches;
+}
+
+ResultBitmap SARIF::DuplicateMatches(const ResultBitmap& removed) const
+{
+	FingerprintSet seen(_index->fingerprintOf.size());
+	ResultBitmap matches;
+	for (size_t result = 0; result < _index->fingerprintOf.size(); ++result) {
+		if (removed.Contains(static_cast<uint32_t>(result)))
+			continue;
+		if (!seen.Insert(_index->fingerprintOf[result]))
+			matches.Add(static_cast<uint32_t>(result));
+	}
+	return matches;
+}
+
+ResultBitmap SARIF::BaselineMatches(const FingerprintSet& baseline) const
+{
+	ResultBitmap matches;
+	for (size_t result = 0; result < _index->fingerprintOf.size(); ++result) {
+		if (baseline.Contains(_index->fingerprintOf[result]))
+			matches.Add(static_cast<uint32_t>(result));
+	}
+	return matches;
+}
+
+SARIF::Level SARIF::MinimumLevel() const
+{
+	return _filters.minimumLevel;
+}
+
+int SARIF::MinimumRank() const
+{
+	return _filters.minimumRank;
+}
+
+void SARIF::SetPruneRules(bool prune)
+{
+	_filters.pruneRules = prune;
+}
+
+bool SARIF::PruneRules() const
+{
+	return _filters.pruneRules;
+}
+
+void SARIF::SetResultProjection(ProjectionMode mode, const std::vector<std::string>& paths)
+{
+	_filters.projectionMode = mode;
+	_filters.projectionPaths = paths;
+}
+
+SARIF::ProjectionMode SARIF::ResultProjectionMode() const
+{
+	return _filters.projectionMode;
+}
+
+std::vector<std::string> SARIF::ResultProjectionPaths() const
+{
+	return _filters.projectionPaths;
+}
+
+size_t SARIF::EstimateExportSize() const
+{
+	auto kept = KeptResults(_filters);
+	size_t total = _index->baseBytes;
+	for (size_t result = 0; result < kept.size(); ++result) {
+		if (kept[result])
+			total += _index->bytes[result];
+	}
+	return total;
+}
+
+size_t SARIF::CountResults(const FilterProfile& profile) const
+{
+	auto kept = KeptResults(profile);
+	return static_cast<size_t>(std::count(kept.begin(), kept.end(), true));
+}
+
+std::vector<std::pair<std::string, std::string>> SARIF::ListResults(const FilterProfile& profile, size_t limit) const
+{
+	auto kept = KeptResults(profile);
+	std::vector<std::pair<std::string, std::string>> results;
+	for (size_t result = 0; result < kept.size() && (limit == 0 || results.size() < limit); ++result) {
+		if (!kept[result])
+			continue;
+		auto uri = _index->uris[_index->uriOf[result]];
+		if (profile.overrideBase && uri.compare(0, _originalBasePath.size(), _originalBasePath) == 0)
+			uri = profile.base + uri.substr(_originalBasePath.size());
+		results.emplace_back(_index->rules[_index->ruleOf[result]], uri);
+	}
+	return results;
+}
+
+size_t SARIF::MemoryFootprint() const
+{
+	// Qt's internal JSON representation is a few times larger than the indented text
+	size_t serialized = _index->baseBytes;
+	for (auto bytes : _index->bytes)
+		serialized += bytes;
+	size_t footprint = 3 * serialized;
+	footprint += _index->ruleOf.size() * (5 * sizeof(uint32_t) + sizeof(Level) + sizeof(uint8_t) + sizeof(uint64_t));
+	for (const auto& rule : _index->rules)
+		footprint += sizeof(std::string) + rule.capacity();
+	for (const auto& uri : _index->uris)
+		footprint += sizeof(std::string) + uri.capacity();
+	for (const auto& results : _index->ruleResults)
+		footprint += results.MemoryFootprint();
+	return footprint;
+}
+
+std::map<std::string, size_t> SARIF::BytesByRule() const
+{
+	std::vector<size_t> bytes(_index->rules.size(), 0);
+	for (size_t result = 0; result < _index->ruleOf.size(); ++result)
+		bytes[_index->ruleOf[result]] += _index->bytes[result];
+
+	std::map<std::string, size_t> bytesByRule;
+	for (size_t rule = 0; rule < _index->rules.size(); ++rule)
+		bytesByRule[_index->rules[rule]] += bytes[rule];
+	return bytesByRule;
+}
+
+std::map<std::string, size_t> SARIF::BytesByDirectory() const
+{
+	std::vector<size_t> bytes(_index->uris.size(), 0);
+	for (size_t result = 0; result < _index->uriOf.size(); ++result)
+		bytes[_index->uriOf[result]] += _index->bytes[result];
+
+	std::map<std::string, size_t> bytesByDirectory;
+	for (size_t uri = 0; uri < _index->uris.size(); ++uri)
+		bytesByDirectory[SARIF::DirectoryOf(_index->uris[uri])] += bytes[uri];
+	return bytesByDirectory;
+}
+
+SARIF::SizeBudgetPlan SARIF::PlanSizeBudget(size_t budget) const
+{
+	SizeBudgetPlan plan;
+	plan.budget = budget;
+
+	// Group the URIs into directories
+	std::vector<std::string> directories;
+	std::unordered_map<std::string, uint32_t> directoryIds;
+	std::vector<uint32_t> directoryOfUri;
+	directoryOfUri.reserve(_index->uris.size());
+	for (const auto& uri : _index->uris) {
+		auto directory = SARIF::DirectoryOf(uri);
+		auto found = directoryIds.find(directory);
+		if (found == directoryIds.end()) {
+			found = directoryIds.emplace(directory, static_cast<uint32_t>(directories.size())).first;
+			directories.push_back(directory);
+		}
+		directoryOfUri.push_back(found->second);
+	}
+
+	// Each candidate (rule or directory) can remove the bytes of the results it contains that are still being kept
+	auto kept = KeptResults(_filters);
+	std::vector<size_t> ruleBytes(_index->rules.size(), 0);
+	std::vector<size_t> directoryBytes(directories.size(), 0);
+	std::vector<std::vector<uint32_t>> resultsOfRule(_index->rules.size());
+	std::vector<std::vector<uint32_t>> resultsOfDirectory(directories.size());
+	size_t total = _index->baseBytes;
+	for (uint32_t result = 0; result < kept.size(); ++result) {
+		if (!kept[result])
+			continue;
+		auto rule = _index->ruleOf[result];
+		auto directory = directoryOfUri[_index->uriOf[result]];
+		total += _index->bytes[result];
+		ruleBytes[rule] += _index->bytes[result];
+		directoryBytes[directory] += _index->bytes[result];
+		resultsOfRule[rule].push_back(result);
+		resultsOfDirectory[directory].push_back(result);
+	}
+	plan.estimatedBytes = total;
+
+	auto drop = [&](const std::vector<uint32_t>& results) {
+		for (auto result : results) {
+			if (kept[result]) {
+				kept[result] = false;
+				total -= _index->bytes[result];
+				ruleBytes[_index->ruleOf[result]] -= _index->bytes[result];
+				directoryBytes[directoryOfUri[_index->uriOf[result]]] -= _index->bytes[result];
+			}
+		}
+	};
+
+	while (total > budget) {
+		const size_t deficit = total - budget;
+
+		// Prefer the smallest candidate that closes the gap on its own, otherwise take the largest one
+		bool bestIsRule = true;
+		size_t best = 0;
+		size_t bestBytes = 0;
+		bool bestCloses = false;
+		auto consider = [&](bool isRule, size_t candidate, size_t bytes) {
+			if (bytes == 0)
+				return;
+			bool closes = bytes >= deficit;
+			bool better;
+			if (bestBytes == 0)
+				better = true;
+			else if (closes != bestCloses)
+				better = closes;
+			else if (closes)
+				better = bytes < bestBytes;
+			else
+				better = bytes > bestBytes;
+			if (better) {
+				bestIsRule = isRule;
+				best = candidate;
+				bestBytes = bytes;
+				bestCloses = closes;
+			}
+		};
+		for (size_t rule = 0; rule < ruleBytes.size(); ++rule)
+			consider(true, rule, ruleBytes[rule]);
+		for (size_t directory = 0; directory < directoryBytes.size(); ++directory)
+			consider(false, directory, directoryBytes[directory]);
+
+		if (bestBytes == 0)
+			break; // Nothing left that can be removed
+
+		if (bestIsRule) {
+			plan.rulesToDrop.emplace_back(_index->rules[best], bestBytes);
+			drop(resultsOfRule[best]);
+		}
+		else {
+			plan.directoriesToDrop.emplace_back(directories[best], bestBytes);
+			drop(resultsOfDirectory[best]);
+		}
+	}
+
+	plan.plannedBytes = total;
+	plan.fits = total <= budget;
+	return plan;
+}
+
+std::vector<std::string> SARIF::ApplySizeBudgetPlan(const SizeBudgetPlan& plan)
+{
+	for (const auto& rule : plan.rulesToDrop) {
+		if (std::find(_filters.suppressedRules.begin(), _filters.suppressedRules.end(), rule.first) == _filters.suppressedRules.end())
+			SuppressRule(rule.first);
+	}
+	std::vector<std::string> regexes;
+	for (const auto& directory : plan.directoriesToDrop) {
+		auto regex = DirectoryFilter(directory.first);
+		if (std::find(_filters.locationFilters.begin(), _filters.locationFilters.end(), regex) == _filters.locationFilters.end())
+			AddLocationFilter(regex);
+		regexes.push_back(regex);
+	}
+	return regexes;
+}
+
+std::string SARIF::DirectoryFilter(const std::string& directory) const
+{
+	if (directory.empty())
+		return "^[^/\\\\]*$";
+
+	// Match on the part below the base path when possible, so that the filter survives a change of base. The base is
+	// the common prefix of the URIs, which can end part way through a name, so only whole directories are cut off.
+	const auto separator = _originalBasePath.find_last_of("/\\");
+	const auto baseDirectory = separator == std::string::npos ? std::string() : _originalBasePath.substr(0, separator + 1);
+	if (!baseDirectory.empty() && directory.size() > baseDirectory.size() &&
+		directory.compare(0, baseDirectory.size(), baseDirectory) == 0) {
+		auto relative = directory.substr(baseDirectory.size());
+		return "(^|[/\\\\])" + SARIF::EscapeRegex(relative) + "[/\\\\][^/\\\\]*$";
+	}
+
+	// The base directory itself, or one outside it, has no part below the base, so the filter is anchored to the start
+	return "^" + SARIF::EscapeRegex(directory) + "[/\\\\][^/\\\\]*$";
+}
+
+const SARIF::FilterProfile& SARIF::Filters() const
+{
+	return _filters;
+}
+
+void SARIF::SetFilters(const FilterProfile& profile)
+{
+	_filters = profile;
 }
 
 bool SARIF::operator==(const SARIF& rhs) const
@@ -404,6 +1255,102 @@ void SARIF::ReplaceUri(const std::string& lookFor, const std::string& replaceWit
 	}
 }
 
+uint32_t SARIF::GetLine(const QJsonObject& result)
+{
+	auto region = result["locations"].toArray().first().toObject()["physicalLocation"].toObject()["region"].toObject();
+	if (region.contains("startLine") && region["startLine"].isDouble())
+		return static_cast<uint32_t>(std::max(0, region["startLine"].toInt()));
+	return 0;
+}
+
+uint32_t SARIF::GetEndLine(const QJsonObject& result)
+{
+	auto region = result["locations"].toArray().first().toObject()["physicalLocation"].toObject()["region"].toObject();
+	const auto start = SARIF::GetLine(result);
+	if (region.contains("endLine") && region["endLine"].isDouble())
+		return std::max(start, static_cast<uint32_t>(std::max(0, region["endLine"].toInt())));
+	return start;
+}
+
+SARIF::Level SARIF::GetLevel(const QJsonObject& result)
+{
+	auto level = result["level"].toString();
+	if (level == QLatin1String("error"))
+		return Level::Error;
+	else if (level == QLatin1String("note"))
+		return Level::Note;
+	else if (level == QLatin1String("none"))
+		return Level::None;
+	return Level::Warning;
+}
+
+std::string SARIF::LevelName(Level level)
+{
+	switch (level) {
+	case Level::None: return "none";
+	case Level::Note: return "note";
+	case Level::Error: return "error";
+	default: return "warning";
+	}
+}
+
+SARIF::Level SARIF::LevelFromName(const std::string& name)
+{
+	for (auto level : { Level::None, Level::Note, Level::Warning, Level::Error }) {
+		if (name == SARIF::LevelName(level))
+			return level;
+	}
+	throw std::runtime_error("Unknown level " + name + ": expected none, note, warning or error");
+}
+
+uint64_t SARIF::GetFingerprint(const QJsonObject& result)
+{
+	// FNV-1a, with a separator after each field so that the boundaries between fields matter
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](const QByteArray& field) {
+		for (auto c : field) {
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 1099511628211ull;
+		}
+		hash ^= 0xFF;
+		hash *= 1099511628211ull;
+	};
+	add(QByteArray::fromStdString(SARIF::GetRule(result)));
+
+	auto partialFingerprints = result.value("partialFingerprints").toObject();
+	if (!partialFingerprints.isEmpty()) {
+		// The keys are sorted, so the order they were written in does not matter
+		for (auto fingerprint = partialFingerprints.begin(); fingerprint != partialFingerprints.end(); ++fingerprint) {
+			add(fingerprint.key().toUtf8());
+			add(fingerprint.value().toString().toUtf8());
+		}
+	}
+	else {
+		add(QByteArray::fromStdString(SARIF::GetArtifactUri(result)));
+		auto region = result.value("locations").toArray().first().toObject().value("physicalLocation").toObject().value("region").toObject();
+		for (auto key : { "startLine", "startColumn", "endLine", "endColumn" })
+			add(QByteArray::number(region.value(QLatin1String(key)).toInt()));
+		auto message = result.value("message").toObject();
+		add(message.value("text").toString().toUtf8());
+		add(message.value("id").toString().toUtf8());
+	}
+	return hash == 0 ? 1 : hash;
+}
+
+uint8_t SARIF::GetRank(const QJsonObject& result)
+{
+	// The SARIF default for a missing rank is -1
+	auto rank = result.value("rank");
+	if (!rank.isDouble() || rank.toDouble() < 0.0)
+		return Unranked;
+	return static_cast<uint8_t>(std::min(100.0, std::floor(rank.toDouble())));
+}
+
+uint8_t SARIF::RankThreshold(int minimumRank)
+{
+	return static_cast<uint8_t>(std::clamp(minimumRank, 0, 101));
+}
+
 std::string SARIF::GetRule(const QJsonObject& result)
 {
 	if (result.contains("ruleId") && result["ruleId"].isString())
@@ -411,3 +1358,525 @@ std::string SARIF::GetRule(const QJsonObject& result)
 	else
 		return std::string();
 }
+
+
+void SARIF::RemoveUnusedRules(QJsonObject& tool, QJsonArray& results)
+{
+	if (!tool.contains("driver") || !tool["driver"].isObject())
+		return;
+	auto driver = tool["driver"].toObject();
+	if (!driver.contains("rules") || !driver["rules"].isArray())
+		return;
+	auto rules = driver["rules"].toArray();
+
+	std::map<std::string, int> indexOfId;
+	for (int i = 0; i < rules.size(); ++i) {
+		auto id = rules[i].toObject()["id"].toString().toStdString();
+		if (!id.empty() && indexOfId.find(id) == indexOfId.end())
+			indexOfId[id] = i;
+	}
+
+	// A result may point at its rule by index, by id, or both: the index takes precedence when it is valid
+	auto ruleIndexOf = [&](const QJsonObject& result) -> int {
+		int index = -1;
+		if (result.contains("ruleIndex") && result["ruleIndex"].isDouble())
+			index = result["ruleIndex"].toInt();
+		else if (result.contains("rule") && result["rule"].toObject().contains("index"))
+			index = result["rule"].toObject()["index"].toInt();
+		if (index >= 0 && index < rules.size())
+			return index;
+
+		auto id = SARIF::GetRule(result);
+		if (id.empty() && result.contains("rule"))
+			id = result["rule"].toObject()["id"].toString().toStdString();
+		auto found = indexOfId.find(id);
+		if (found != indexOfId.end())
+			return found->second;
+		return -1;
+	};
+
+	std::vector<bool> used(rules.size(), false);
+	for (const auto& result : results) {
+		int index = ruleIndexOf(result.toObject());
+		if (index >= 0)
+			used[index] = true;
+	}
+
+	std::vector<int> newIndex(rules.size(), -1);
+	QJsonArray keptRules;
+	for (int i = 0; i < rules.size(); ++i) {
+		if (used[i]) {
+			newIndex[i] = keptRules.size();
+			keptRules.append(rules[i]);
+		}
+	}
+
+	for (int i = 0; i < results.size(); ++i) {
+		auto resultObject = results[i].toObject();
+		int oldIndex = ruleIndexOf(resultObject);
+		if (oldIndex < 0)
+			continue;
+		bool changed = false;
+		if (resultObject.contains("ruleIndex")) {
+			resultObject.insert("ruleIndex", newIndex[oldIndex]);
+			changed = true;
+		}
+		if (resultObject.contains("rule") && resultObject["rule"].toObject().contains("index")) {
+			auto ruleReference = resultObject["rule"].toObject();
+			ruleReference.insert("index", newIndex[oldIndex]);
+			resultObject.insert("rule", ruleReference);
+			changed = true;
+		}
+		if (changed)
+			results.replace(i, resultObject);
+	}
+
+	driver.insert("rules", keptRules);
+	tool.insert("driver", driver);
+}
+
+QJsonValue SARIF::Project(const QJsonValue& value, const ProjectionNode& node, ProjectionMode mode, const std::string& path,
+	std::map<std::string, size_t>& bytesRemoved)
+{
+	if (value.isArray()) {
+		QJsonArray projectedArray;
+		auto array = value.toArray();
+		for (const auto& element : array)
+			projectedArray.append(SARIF::Project(element, node, mode, path, bytesRemoved));
+		return projectedArray;
+	}
+	else if (!value.isObject()) {
+		return value;
+	}
+
+	QJsonObject projectedObject;
+	auto object = value.toObject();
+	for (auto element = object.begin(); element != object.end(); ++element) {
+		auto elementPath = path.empty() ? element.key().toStdString() : path + "/" + element.key().toStdString();
+		auto child = node.children.find(element.key());
+		if (child == node.children.end()) {
+			// Not mentioned in the projection at all
+			if (mode == ProjectionMode::Keep)
+				bytesRemoved[elementPath] += SARIF::SerializedSize(element.value());
+			else
+				projectedObject.insert(element.key(), element.value());
+		}
+		else if (child->second.children.empty()) {
+			// The end of a listed path: the whole subtree is either kept or dropped
+			if (mode == ProjectionMode::Drop)
+				bytesRemoved[elementPath] += SARIF::SerializedSize(element.value());
+			else
+				projectedObject.insert(element.key(), element.value());
+		}
+		else {
+			projectedObject.insert(element.key(), SARIF::Project(element.value(), child->second, mode, elementPath, bytesRemoved));
+		}
+	}
+	return projectedObject;
+}
+
+size_t SARIF::SerializedSize(const QJsonValue& value)
+{
+	// QJsonDocument can only hold an object or an array, so wrap the value and subtract the brackets
+	return QJsonDocument(QJsonArray{ value }).toJson(QJsonDocument::Compact).size() - 2;
+}
+
+size_t SARIF::BuildIndex(std::function<bool(void)> interruptionRequested, const QJsonDocument& previousJson, const Index& previousIndex)
+{
+	auto index = std::make_shared<Index>();
+	_originalBasePath.clear();
+	std::unordered_map<std::string, uint32_t> ruleIds;
+	std::unordered_map<std::string, uint32_t> uriIds;
+	auto intern = [](const std::string& value, std::unordered_map<std::string, uint32_t>& ids, std::vector<std::string>& table) {
+		auto found = ids.find(value);
+		if (found != ids.end())
+			return found->second;
+		auto id = static_cast<uint32_t>(table.size());
+		ids.emplace(value, id);
+		table.push_back(value);
+		return id;
+	};
+
+	auto o = _json.object();
+	if (!o.contains("runs") || !o["runs"].isArray()) {
+		_index = index;
+		return 0;
+	}
+	auto runs = o["runs"].toArray();
+
+	// A result's entries can only be copied while the results before it, and so its id, are unchanged too
+	QJsonArray previousRuns;
+	if (previousJson.isObject() && previousJson.object()["runs"].isArray())
+		previousRuns = previousJson.object()["runs"].toArray();
+	bool reusing = !previousIndex.ruleOf.empty();
+	size_t reused = 0;
+	size_t firstRunResults = 0;
+
+	QJsonArray emptyRuns;
+	std::unordered_map<std::string, std::vector<std::string>> descriptorTags;
+	int runNumber = 0;
+	for (auto run = runs.begin(); run != runs.end() && !interruptionRequested(); ++run, ++runNumber) {
+		auto runObject = run->toObject();
+		index->runStarts.push_back(static_cast<uint32_t>(index->ruleOf.size()));
+
+		// The rule descriptors of the tool and of any extensions, for their tags
+		auto tool = runObject.value("tool").toObject();
+		QJsonArray components = tool.value("extensions").toArray();
+		components.prepend(tool.value("driver"));
+		for (const auto& component : components) {
+			for (const auto& rule : component.toObject().value("rules").toArray()) {
+				auto ruleObject = rule.toObject();
+				auto& tags = descriptorTags[ruleObject.value("id").toString().toStdString()];
+				for (const auto& tag : ruleObject.value("properties").toObject().value("tags").toArray()) {
+					auto tagText = tag.toString().toStdString();
+					if (std::find(tags.begin(), tags.end(), tagText) == tags.end())
+						tags.push_back(tagText);
+				}
+			}
+		}
+		if (runObject.contains("results") && runObject["results"].isArray()) {
+			auto resultArray = runObject["results"].toArray();
+			QJsonArray previousResults;
+			if (reusing && runNumber < previousRuns.size())
+				previousResults = previousRuns.at(runNumber).toObject()["results"].toArray();
+			int position = 0;
+			for (auto result = resultArray.begin(); result != resultArray.end() && !interruptionRequested(); ++result, ++position) {
+				auto id = index->ruleOf.size();
+				if (reusing && (position >= previousResults.size() || id >= previousIndex.ruleOf.size() || previousResults.at(position) != *result))
+					reusing = false;
+				if (reusing) {
+					index->ruleOf.push_back(intern(previousIndex.rules[previousIndex.ruleOf[id]], ruleIds, index->rules));
+					index->uriOf.push_back(intern(previousIndex.uris[previousIndex.uriOf[id]], uriIds, index->uris));
+					index->bytes.push_back(previousIndex.bytes[id]);
+					index->lineOf.push_back(previousIndex.lineOf[id]);
+					index->endLineOf.push_back(previousIndex.endLineOf[id]);
+					index->levelOf.push_back(previousIndex.levelOf[id]);
+					index->rankOf.push_back(previousIndex.rankOf[id]);
+					index->fingerprintOf.push_back(previousIndex.fingerprintOf[id]);
+					++reused;
+					continue;
+				}
+
+				auto resultObject = result->toObject();
+				index->ruleOf.push_back(intern(SARIF::GetRule(resultObject), ruleIds, index->rules));
+				index->uriOf.push_back(intern(SARIF::GetArtifactUri(resultObject), uriIds, index->uris));
+				index->lineOf.push_back(SARIF::GetLine(resultObject));
+				index->endLineOf.push_back(SARIF::GetEndLine(resultObject));
+				index->levelOf.push_back(SARIF::GetLevel(resultObject));
+				index->rankOf.push_back(SARIF::GetRank(resultObject));
+				index->fingerprintOf.push_back(SARIF::GetFingerprint(resultObject));
+
+				// Export() writes each result four levels deep, indented by four spaces per level, followed by a comma
+				auto json = QJsonDocument(resultObject).toJson(QJsonDocument::Indented);
+				auto lines = std::count(json.begin(), json.end(), '\n');
+				index->bytes.push_back(static_cast<uint32_t>(json.size() + 16 * lines + 1));
+			}
+			if (previousResults.size() > resultArray.size())
+				reusing = false;
+			if (runNumber == 0)
+				firstRunResults = index->ruleOf.size();
+			runObject.insert("results", QJsonArray());
+		}
+		else {
+			reusing = false;
+		}
+		runObject.remove("artifacts");
+		emptyRuns.append(runObject);
+	}
+	o.insert("runs", emptyRuns);
+	index->baseBytes = QJsonDocument(o).toJson(QJsonDocument::Indented).size();
+
+	for (size_t result = 0; result < index->levelOf.size(); ++result) {
+		auto rank = index->rankOf[result];
+		++index->levelRanks[static_cast<size_t>(index->levelOf[result])][rank == Unranked ? 101 : rank];
+	}
+
+	// Each rule's results, so that rule and tag filters are unions of these rather than scans of every result, and
+	// each URI's count, so that a location filter's hits are a sum over the distinct URIs. The tag index maps rules to their tags and back, and counts each tag's results from the rules' counts.
+	index->ruleResults.resize(index->rules.size());
+	for (size_t result = 0; result < index->ruleOf.size(); ++result)
+		index->ruleResults[index->ruleOf[result]].Add(static_cast<uint32_t>(result));
+	index->uriResults.assign(index->uris.size(), 0);
+	for (auto uri : index->uriOf)
+		++index->uriResults[uri];
+	std::unordered_map<std::string, uint32_t> tagIds;
+	for (uint32_t rule = 0; rule < index->rules.size(); ++rule) {
+		std::vector<uint32_t> tags;
+		auto descriptor = descriptorTags.find(index->rules[rule]);
+		if (descriptor != descriptorTags.end()) {
+			for (const auto& tag : descriptor->second) {
+				auto id = intern(tag, tagIds, index->tags);
+				if (id == index->tagRules.size()) {
+					index->tagRules.emplace_back();
+					index->tagResults.push_back(0);
+				}
+				index->tagRules[id].Add(rule);
+				index->tagResults[id] += static_cast<int>(index->ruleResults[rule].Count());
+				tags.push_back(id);
+			}
+		}
+		index->ruleTags.push_back(std::move(tags));
+	}
+
+	// The base is the common part of the URIs of the first run's results, found from the index rather than the JSON
+	std::string base;
+	for (size_t result = 0; result < firstRunResults; ++result) {
+		const auto& uri = index->uris[index->uriOf[result]];
+		if (base.empty())
+			base = uri;
+		else
+			base = SARIF::MaxMatch(base, uri);
+	}
+	_originalBasePath = base;
+	_index = index;
+	return reused;
+}
+
+std::vector<bool> SARIF::KeptResults(const FilterProfile& profile) const
+{
+	return KeptResults(profile, nullptr);
+}
+
+std::vector<int> SARIF::DuplicatesPerRule(const FilterProfile& profile) const
+{
+	std::vector<int> duplicates(_index->rules.size(), 0);
+	if (profile.deduplicate)
+		KeptResults(profile, &duplicates);
+	return duplicates;
+}
+
+std::vector<bool> SARIF::KeptResults(const FilterProfile& profile, std::vector<int>* duplicatesPerRule, int* unchanged) const
+{
+	std::vector<bool> keptRules(_index->rules.size(), true);
+	for (size_t rule = 0; rule < _index->rules.size(); ++rule) {
+		if (std::find(profile.suppressedRules.begin(), profile.suppressedRules.end(), _index->rules[rule]) != profile.suppressedRules.end())
+			keptRules[rule] = false;
+	}
+
+	std::shared_ptr<const std::vector<std::regex>> compiledRegexes = profile.compiledLocationFilters;
+	std::shared_ptr<const std::vector<FilterExpression>> compiledExpressions = profile.compiledExpressionFilters;
+	if (!compiledRegexes || compiledRegexes->size() != profile.locationFilters.size() ||
+		!compiledExpressions || compiledExpressions->size() != profile.expressionFilters.size()) {
+		FilterProfile compiled = profile;
+		compiled.Compile();
+		compiledRegexes = compiled.compiledLocationFilters;
+		compiledExpressions = compiled.compiledExpressionFilters;
+	}
+
+	// Each distinct URI only needs to be checked against the regular expressions once
+	std::vector<bool> keptUris(_index->uris.size(), true);
+	for (const auto& compiledRegex : *compiledRegexes) {
+		for (size_t uri = 0; uri < _index->uris.size(); ++uri) {
+			if (keptUris[uri] && std::regex_search(_index->uris[uri], compiledRegex))
+				keptUris[uri] = false;
+		}
+	}
+
+	// The threshold is one comparison of each of the level and rank columns, which the defaults always pass
+	const auto minimumLevel = profile.minimumLevel;
+	const auto minimumRank = SARIF::RankThreshold(profile.minimumRank);
+	std::vector<bool> kept(_index->ruleOf.size());
+	for (size_t result = 0; result < kept.size(); ++result)
+		kept[result] = keptRules[_index->ruleOf[result]] && keptUris[_index->uriOf[result]] &&
+			_index->levelOf[result] >= minimumLevel && _index->rankOf[result] >= minimumRank;
+
+	// The ranges of each distinct URI are only looked up once
+	if (profile.lineRanges) {
+		std::vector<const std::vector<LineRanges::Range>*> uriRanges;
+		for (const auto& uri : _index->uris)
+			uriRanges.push_back(profile.lineRanges->Find(uri));
+		for (size_t result = 0; result < kept.size(); ++result) {
+			auto fileRanges = uriRanges[_index->uriOf[result]];
+			if (kept[result] && (!fileRanges || !LineRanges::Overlaps(*fileRanges, _index->lineOf[result], _index->endLineOf[result])))
+				kept[result] = false;
+		}
+	}
+
+	// Expressions are only evaluated for results that the cheaper filters have not already removed
+	const auto columns = ExpressionColumns();
+	for (const auto& expression : *compiledExpressions) {
+		auto program = CompileExpression(expression);
+		for (size_t result = 0; result < kept.size(); ++result) {
+			if (kept[result] && program.Matches(columns, result))
+				kept[result] = false;
+		}
+	}
+
+	// A probe of the baseline's table per result: no part of the baseline report is needed but its fingerprints
+	if (profile.baseline) {
+		for (size_t result = 0; result < kept.size(); ++result) {
+			if (kept[result] && profile.baseline->Contains(_index->fingerprintOf[result])) {
+				kept[result] = false;
+				if (unchanged)
+					++*unchanged;
+			}
+		}
+	}
+
+	// Duplicates are removed last, so the first copy that passes the other filters is the one that is kept
+	if (profile.deduplicate) {
+		FingerprintSet seen(kept.size());
+		for (size_t result = 0; result < kept.size(); ++result) {
+			if (kept[result] && !seen.Insert(_index->fingerprintOf[result])) {
+				kept[result] = false;
+				if (duplicatesPerRule)
+					++(*duplicatesPerRule)[_index->ruleOf[result]];
+			}
+		}
+	}
+	return kept;
+}
+
+void SARIF::FilterProfile::Compile()
+{
+	auto regexes = std::make_shared<std::vector<std::regex>>();
+	for (const auto& regex : locationFilters)
+		regexes->emplace_back(regex);
+	auto expressions = std::make_shared<std::vector<FilterExpression>>();
+	for (const auto& expression : expressionFilters)
+		expressions->emplace_back(expression);
+	compiledLocationFilters = regexes;
+	compiledExpressionFilters = expressions;
+}
+
+std::string SARIF::DirectoryOf(const std::string& uri)
+{
+	auto slash = uri.find_last_of("/\\");
+	if (slash == std::string::npos)
+		return std::string();
+	return uri.substr(0, slash);
+}
+
+std::string SARIF::EscapeRegex(const std::string& text)
+{
+	static const std::string metacharacters = "\\^$.|?*+()[]{}";
+	std::string escaped;
+	escaped.reserve(text.size());
+	for (auto c : text) {
+		if (metacharacters.find(c) != std::string::npos)
+			escaped += '\\';
+		escaped += c;
+	}
+	return escaped;
+}
+
+std::string SARIF::TopLevelComponent(const std::string& uri, const std::string& base)
+{
+	if (base.empty() || uri.compare(0, base.size(), base) != 0)
+		return "other";
+	auto relative = uri.substr(base.size());
+	auto slash = relative.find_first_of("/\\");
+	if (slash == std::string::npos)
+		return "root";
+	return relative.substr(0, slash);
+}
+
+std::string SARIF::SanitizeFilename(const std::string& name)
+{
+	std::string sanitized = name;
+	for (auto& c : sanitized) {
+		if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_' && c != '.')
+			c = '_';
+	}
+	return sanitized;
+}
+
+void SARIF::ParallelFor(size_t count, const std::function<void(size_t)>& task)
+{
+	std::atomic<size_t> next(0);
+	std::exception_ptr firstError;
+	std::mutex errorMutex;
+	auto worker = [&]() {
+		for (size_t item = next++; item < count; item = next++) {
+			try {
+				task(item);
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if (!firstError)
+					firstError = std::current_exception();
+			}
+		}
+	};
+	size_t threadCount = std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::thread> threads;
+	for (size_t thread = 1; thread < threadCount; ++thread)
+		threads.emplace_back(worker);
+	worker();
+	for (auto& thread : threads)
+		thread.join();
+	if (firstError)
+		std::rethrow_exception(firstError);
+}
+
+FilterExpression::Program SARIF::CompileExpression(const FilterExpression& expression) const
+{
+	static_assert(static_cast<int>(Level::None) == 0 && static_cast<int>(Level::Note) == 1 &&
+		static_cast<int>(Level::Warning) == 2 && static_cast<int>(Level::Error) == 3, "FilterExpression numbers the levels in this order");
+
+	const auto& predicates = expression.Predicates();
+	std::vector<std::vector<bool>> tables(predicates.size());
+	for (size_t p = 0; p < predicates.size(); ++p) {
+		const auto& predicate = predicates[p];
+		auto test = [&predicate](const std::string& value) {
+			return predicate.regex ? std::regex_search(value, *predicate.regex) : value == predicate.text;
+		};
+		switch (predicate.field) {
+		case FilterExpression::Field::Rule:
+			for (const auto& rule : _index->rules)
+				tables[p].push_back(test(rule));
+			break;
+		case FilterExpression::Field::Uri:
+			for (const auto& uri : _index->uris)
+				tables[p].push_back(test(uri));
+			break;
+		case FilterExpression::Field::Tag: {
+			tables[p].assign(_index->rules.size(), false);
+			RulesMatchingTag(predicate.text).ForEach([&tables, p](uint32_t rule) { tables[p][rule] = true; });
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	// Estimate how often each predicate holds from an evenly spaced sample of the results
+	const size_t results = _index->ruleOf.size();
+	const size_t samples = std::min<size_t>(results, 1024);
+	const auto columns = ExpressionColumns();
+	std::vector<double> selectivity(predicates.size(), 0.5);
+	for (size_t p = 0; p < predicates.size() && samples > 0; ++p) {
+		const auto& predicate = predicates[p];
+		size_t matches = 0;
+		for (size_t sample = 0; sample < samples; ++sample) {
+			const size_t result = sample * results / samples;
+			switch (predicate.field) {
+			case FilterExpression::Field::Rule:
+			case FilterExpression::Field::Tag:
+				matches += tables[p][columns.rule[result]];
+				break;
+			case FilterExpression::Field::Uri:
+				matches += tables[p][columns.uri[result]];
+				break;
+			case FilterExpression::Field::Level:
+				matches += columns.level[result] >= predicate.low && columns.level[result] <= predicate.high;
+				break;
+			default:
+				matches += columns.line[result] >= predicate.low && columns.line[result] <= predicate.high;
+				break;
+			}
+		}
+		selectivity[p] = static_cast<double>(matches) / static_cast<double>(samples);
+	}
+	return expression.Compile(std::move(tables), selectivity);
+}
+
+FilterExpression::Columns SARIF::ExpressionColumns() const
+{
+	FilterExpression::Columns columns;
+	columns.rule = _index->ruleOf.data();
+	columns.uri = _index->uriOf.data();
+	columns.line = _index->lineOf.data();
+	columns.level = reinterpret_cast<const uint8_t*>(_index->levelOf.data());
+	return columns;
+}
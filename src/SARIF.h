@@ -20,22 +20,200 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#ifndef _CLEANSARIF_SARIF_H_
+#define _CLEANSARIF_SARIF_H_
+
 #include <string>
 #include <vector>
 #include <set>
 #include <map>
 #include <exception>
+#include <functional>
+#include <cstdint>
+#include <memory>
+#include <array>
+#include <regex>
 
 #pragma warning(push, 1) 
 #include <QJsonDocument>
 #pragma warning(pop)
 
-#include <mutex>
+#include "ResultBitmap.h"
+#include "FilterCoverage.h"
+#include "FilterExpression.h"
+#include "LineRanges.h"
+#include "FingerprintSet.h"
+
+class QIODevice;
 
 class SARIF
 {
+	friend class SARIFStreamFilter;
+
 public:
 
+	/**
+	 * \brief How the result projection paths are interpreted
+	 * \see SetResultProjection()
+	 */
+	enum class ProjectionMode {
+		None, ///< Results are written out in full
+		Keep, ///< Only the listed paths are written
+		Drop  ///< The listed paths are removed
+	};
+
+	/**
+	 * \brief How ExportSplit() divides the results between files
+	 */
+	enum class SplitMode {
+		None,        ///< Write a single file, exactly like Export()
+		ByDirectory, ///< One file per top-level directory below the base path
+		BySize       ///< As many files as needed to keep each one under a maximum size
+	};
+
+	/**
+	 * \brief The severity of a result, from its \a level property
+	 */
+	enum class Level : uint8_t {
+		None,
+		Note,
+		Warning, ///< Also used for results with no level, which is the SARIF default
+		Error
+	};
+
+	/**
+	 * \brief The rank of a result that has no \a rank property. No minimum rank removes these results.
+	 * \see RankOf()
+	 */
+	static constexpr uint8_t Unranked = 0xFF;
+
+	/**
+	 * \brief The SARIF name of \a level, e.g. "warning"
+	 */
+	static std::string LevelName(Level level);
+
+	/**
+	 * \brief The level called \a name in SARIF
+	 * \throws std::runtime_error if \a name is not none, note, warning or error
+	 */
+	static Level LevelFromName(const std::string& name);
+
+	/**
+	 * \brief Summary information about a completed Export()
+	 */
+	struct ExportStatistics {
+		int resultsRead = 0;    ///< Number of results in the input, before filtering
+		int resultsWritten = 0; ///< Number of results in the output
+
+		/// The compact-JSON size of the data removed by the result projection, keyed by path
+		std::map<std::string, size_t> projectedBytes;
+
+		/// The number of results removed as duplicates of an earlier result, keyed by rule
+		std::map<std::string, int> duplicates;
+
+		/// The number of results removed because their fingerprint is in the baseline
+		int unchanged = 0;
+	};
+
+	/**
+	 * \brief The rules and directories that need to be removed to bring the output under a size budget
+	 * \see PlanSizeBudget()
+	 */
+	struct SizeBudgetPlan {
+		size_t budget = 0;          ///< The requested maximum output size, in bytes
+		size_t estimatedBytes = 0;  ///< The estimated output size with the filters that are currently set
+		size_t plannedBytes = 0;    ///< The estimated output size once everything below is also removed
+		bool fits = false;          ///< Whether \a plannedBytes is within \a budget
+
+		/// Rules to suppress, in the order they were chosen, with the number of bytes each one removes
+		std::vector<std::pair<std::string, size_t>> rulesToDrop;
+
+		/// Directories (as they appear in the artifact URIs) to filter out, with the number of bytes each one removes
+		std::vector<std::pair<std::string, size_t>> directoriesToDrop;
+	};
+
+	/**
+	 * \brief How the filters of a profile overlap with each other
+	 * \see AnalyzeFilters()
+	 */
+	struct FilterAnalysis {
+		/// A single rule suppression or location filter
+		struct Filter {
+			bool isRule = false;  ///< A rule suppression, otherwise a location filter
+			std::string pattern;  ///< The rule ID or regular expression
+			size_t matches = 0;   ///< The number of results it matches, whatever the other filters do
+			size_t unique = 0;    ///< The number of results no other filter removes
+		};
+
+		size_t results = 0;          ///< The number of results in the report
+		size_t removed = 0;          ///< The number of results at least one filter removes
+
+		/// The suppressed rules, then the location filters, each in the order of the profile
+		std::vector<Filter> filters;
+
+		/// The number of results matched by both filters, indexed by position in \a filters
+		std::vector<std::vector<size_t>> overlap;
+
+		std::vector<size_t> dead;      ///< Filters that match no results
+		/// Filters that match results, but only ones the other filters remove as well. Of filters that cover each
+		/// other, such as two identical ones, only the later are reported, so that all of these can be deleted at
+		/// once without bringing any result back.
+		std::vector<size_t> redundant;
+
+		/// Pairs (i, j) where every result filter i matches is also matched by filter j. Two filters that match
+		/// the same results are only reported once, with the later one as i.
+		std::vector<std::pair<size_t, size_t>> subsumed;
+
+		/// Pairs (i, j), i < j, of filters whose matches are not identical but differ by only a few results
+		std::vector<std::pair<size_t, size_t>> similar;
+	};
+
+	/**
+	 * \brief Everything that controls what is exported: the filters, the change of base path and the output options
+	 *
+	 * A SARIF object has one current profile, which is modified by the Set*, Suppress* and Add* functions and used by
+	 * Export(). Any number of further profiles can be given to ExportProfiles().
+	 */
+	struct FilterProfile {
+		std::vector<std::string> suppressedRules; ///< Rule IDs whose results are removed
+		std::vector<std::string> locationFilters; ///< Regular expressions: results whose artifact URI matches are removed
+		std::vector<std::string> expressionFilters; ///< Filter expressions: results that match are removed. \see FilterExpression
+		Level minimumLevel = Level::None;         ///< Results with a lower level are removed. \see SetThreshold()
+		int minimumRank = 0;                      ///< Results with a lower rank are removed. \see SetThreshold()
+
+		/// If set, only the results whose region overlaps one of these ranges are kept, e.g. the lines a pull
+		/// request changes. Results in files that are not listed are removed.
+		std::shared_ptr<const LineRanges> lineRanges;
+
+		/// Whether to only keep the first of the results with the same fingerprint, after the other filters
+		/// \see FingerprintOf()
+		bool deduplicate = false;
+
+		/// If set, the results whose fingerprint is in this set are removed, leaving the ones that are new since
+		/// the baseline report. \see Fingerprints()
+		std::shared_ptr<const FingerprintSet> baseline;
+		bool overrideBase = false;                ///< Whether to replace the base of every URI with \a base
+		std::string base;                         ///< The replacement base path
+		bool pruneRules = false;                  ///< \see SetPruneRules()
+		ProjectionMode projectionMode = ProjectionMode::None; ///< \see SetResultProjection()
+		std::vector<std::string> projectionPaths; ///< \see SetResultProjection()
+
+		/// Compiled copies of \a locationFilters, shared by every copy of the profile. If unset, the
+		/// expressions are compiled each time the profile is used.
+		std::shared_ptr<const std::vector<std::regex>> compiledLocationFilters;
+
+		/// Parsed copies of \a expressionFilters, shared in the same way as \a compiledLocationFilters
+		std::shared_ptr<const std::vector<FilterExpression>> compiledExpressionFilters;
+
+		/**
+		 * \brief Compile the location and expression filters once, so that every SARIF object using this profile
+		 * (or a copy of it) can share them, e.g. from several threads
+		 * \throws std::regex_error if one of the regular expressions is invalid
+		 * \throws std::runtime_error if one of the filter expressions is invalid
+		 */
+		void Compile();
+	};
+
 	/**
 	 * \brief Default construct a SARIF object with no attached data. 
 	 */
@@ -55,6 +233,30 @@ public:
 	 */
 	void Load(const std::string& file, std::function<bool(void)> interruptionRequested = []() {return false; });
 
+	/**
+	 * \brief Load SARIF data from an open device, e.g. standard input
+	 * \throws std::runtime_exception if the data is not SARIF
+	 * \note The whole input is read before anything else happens. To filter a stream as it arrives, see
+	 * SARIFStreamFilter.
+	 */
+	void Load(QIODevice& input, std::function<bool(void)> interruptionRequested = []() {return false; });
+
+	/**
+	 * \brief Load a new version of the file that was loaded before, keeping the current filters
+	 *
+	 * Results that are identical to the previous version, and at the same position, keep their index entries, so
+	 * when a report has only been appended to, just the new results at the end are indexed.
+	 * \throws std::runtime_exception if the file cannot be loaded
+	 * \returns The number of results whose index entries were reused
+	 */
+	size_t Reload(const std::string& file, std::function<bool(void)> interruptionRequested = []() {return false; });
+
+	/**
+	 * \brief Load a new version of the data from an open device, keeping the current filters
+	 * \see Reload(const std::string&, std::function<bool(void)>)
+	 */
+	size_t Reload(QIODevice& input, std::function<bool(void)> interruptionRequested = []() {return false; });
+
 	/**
 	 * \brief Export to a new SARIF file
 	 * \param file The file to export to. Overwritten if pre-existing.
@@ -62,20 +264,193 @@ public:
 	 * The exported file reflects the application of the filters set in the various
 	 * Set* functions in this class. The new file is a correctly-formatted SARIF file that
 	 * has been filtered and modified according to those rules.
+	 * \returns Counts of the results read and written, and the bytes removed by any result projection
+	 */
+	ExportStatistics Export(const std::string& file, std::function<bool(void)> interruptionRequested = []() {return false; }) const;
+
+	/**
+	 * \brief Export to an open device, e.g. standard output
+	 * \throws If export fails for any reason, a std::runtime_error is thrown.
+	 * \see Export(const std::string&, std::function<bool(void)>)
 	 */
-	void Export(const std::string& file, std::function<bool(void)> interruptionRequested = []() {return false; }) const;
+	ExportStatistics Export(QIODevice& output, std::function<bool(void)> interruptionRequested = []() {return false; }) const;
 
 	/**
-	 * \brief List the rules present in this SARIF object
+	 * \brief Export to several new SARIF files at once
+	 * \param file The name the output files are based on: "out.sarif" is split into "out_src.sarif", "out_tests.sarif", etc.
+	 * when splitting by directory, or "out_1.sarif", "out_2.sarif", etc. when splitting by size.
+	 * \param mode How to decide which file each result goes to
+	 * \param maximumBytes For SplitMode::BySize, the approximate maximum size of each file. Unused otherwise.
+	 * \throws If export fails for any reason, a std::runtime_error is thrown.
+	 * The results are filtered once, then divided between the outputs, and the outputs are written in parallel. Each output
+	 * is a complete SARIF file with the same filters, projection and rule pruning as Export() would apply.
+	 * \returns The name of each file that was written, with its statistics
+	 */
+	std::vector<std::pair<std::string, ExportStatistics>> ExportSplit(const std::string& file, SplitMode mode, size_t maximumBytes = 0,
+		std::function<bool(void)> interruptionRequested = []() {return false; }) const;
+
+	/**
+	 * \brief Export several differently-filtered files from this single load
+	 * \param outputs Pairs of the profile to apply and the file to write it to. The current profile of this object is not
+	 * used: include Filters() in the list to write it as well.
+	 * \throws If export fails for any reason, a std::runtime_error is thrown.
+	 * Every profile is evaluated against the load-time index, then a single walk over the results distributes them to
+	 * the outputs, and the outputs are written in parallel.
+	 * \returns The statistics for each output, in the same order as \a outputs
+	 */
+	std::vector<ExportStatistics> ExportProfiles(const std::vector<std::pair<FilterProfile, std::string>>& outputs,
+		std::function<bool(void)> interruptionRequested = []() {return false; }) const;
+
+	/**
+	 * \brief Get the current filter profile
+	 */
+	const FilterProfile& Filters() const;
+
+	/**
+	 * \brief Replace all of the current filters and output options at once
+	 */
+	void SetFilters(const FilterProfile& profile);
+
+	/**
+	 * \brief List the rules described by the runs of this SARIF object
 	 * \returns a tuple containing the ID of the rule, and its help text
 	 */
 	std::vector<std::tuple<std::string, std::string>> Rules() const;
 
 	/**
-	 * \brief List the source code files this SARIF result set affects
+	 * \brief List the source code files the results of all runs affect
 	 */
 	std::set<std::string> Files() const;
 
+	/**
+	 * \brief The distinct rule IDs of the results in all runs, in order of first appearance
+	 *
+	 * This is the load-time index's table of interned strings, so a rule's position in it is a stable id for
+	 * as long as this object is not loaded again.
+	 */
+	const std::vector<std::string>& DistinctRules() const;
+
+	/**
+	 * \brief The distinct artifact URIs of the results in all runs, in order of first appearance
+	 * \see DistinctRules()
+	 */
+	const std::vector<std::string>& DistinctUris() const;
+
+	/**
+	 * \brief For each entry in DistinctRules(), the number of results with that rule
+	 */
+	std::vector<int> ResultsPerRule() const;
+
+	/**
+	 * \brief For each entry in DistinctUris(), the number of results in that file
+	 */
+	std::vector<int> ResultsPerUri() const;
+
+	/**
+	 * \brief The distinct tags of the rule descriptors (\a properties.tags) of the rules in DistinctRules(), such as
+	 * "security" or "external/cwe/cwe-190", in order of first appearance
+	 * \see DistinctRules()
+	 */
+	const std::vector<std::string>& DistinctTags() const;
+
+	/**
+	 * \brief The positions in DistinctTags() of the tags of \a rule, a position in DistinctRules()
+	 */
+	const std::vector<uint32_t>& TagsOfRule(uint32_t rule) const;
+
+	/**
+	 * \brief The positions in DistinctRules() of the rules with \a tag, a position in DistinctTags()
+	 */
+	const ResultBitmap& RulesWithTag(uint32_t tag) const;
+
+	/**
+	 * \brief For each entry in DistinctTags(), the number of results whose rule has that tag
+	 * \note Counted when the file is loaded, so this does not look at the results
+	 */
+	std::vector<int> ResultsPerTag() const;
+
+	/**
+	 * \brief The positions in DistinctRules() of the rules with a tag matching \a pattern
+	 * \see FilterExpression::MatchesTag() for the form of the pattern
+	 */
+	ResultBitmap RulesMatchingTag(const std::string& pattern) const;
+
+	/**
+	 * \brief The ids of the results whose rule has a tag matching \a pattern
+	 */
+	ResultBitmap TagMatches(const std::string& pattern) const;
+
+	/**
+	 * \brief The number of results in all runs
+	 *
+	 * Results are identified by their position in the concatenation of the \a results arrays of all of the runs, in
+	 * file order. The *Of() functions below look a result up by that id.
+	 */
+	size_t ResultCount() const;
+
+	/**
+	 * \brief The position of \a result's rule in DistinctRules()
+	 */
+	uint32_t RuleOf(size_t result) const;
+
+	/**
+	 * \brief The position of \a result's artifact URI in DistinctUris()
+	 */
+	uint32_t UriOf(size_t result) const;
+
+	/**
+	 * \brief The start line of \a result's first location, or 0 if it doesn't have one
+	 */
+	uint32_t LineOf(size_t result) const;
+
+	/**
+	 * \brief The end line of the region of \a result's first location: its start line if the region has no end line
+	 */
+	uint32_t EndLineOf(size_t result) const;
+
+	/**
+	 * \brief The severity of \a result
+	 */
+	Level LevelOf(size_t result) const;
+
+	/**
+	 * \brief The \a rank of \a result rounded down to a whole number from 0 to 100, or Unranked if it doesn't have one
+	 */
+	uint8_t RankOf(size_t result) const;
+
+	/**
+	 * \brief A 64-bit hash identifying \a result, which is never 0
+	 *
+	 * If the result has \a partialFingerprints, it is a hash of its rule and those. Otherwise it is a hash of its
+	 * rule, artifact URI, the region of its first location, and its message. Computed when the file is loaded.
+	 */
+	uint64_t FingerprintOf(size_t result) const;
+
+	/**
+	 * \brief The fingerprints of every result, e.g. to use this report as the baseline of another
+	 * \see FilterProfile::baseline, SARIFStreamFilter::Fingerprints()
+	 */
+	FingerprintSet Fingerprints() const;
+
+	/**
+	 * \brief The text of \a result's message
+	 * \note Messages are not indexed: each call reads the message from the JSON document.
+	 */
+	std::string MessageOf(size_t result) const;
+
+	/**
+	 * \brief Evaluate the rule suppressions, location filters, expression filters, threshold, line ranges, baseline
+	 * and deduplication of \a profile against the index
+	 * \returns One entry per result id, true if the result would be exported
+	 */
+	std::vector<bool> KeptResults(const FilterProfile& profile) const;
+
+	/**
+	 * \brief For each entry in DistinctRules(), the number of results \a profile removes as duplicates
+	 * \note Counts nothing unless \a profile.deduplicate is set
+	 */
+	std::vector<int> DuplicatesPerRule(const FilterProfile& profile) const;
+
 	/**
 	 * \brief Get the part of the artifactLocation that all results have in common
 	 */
@@ -89,7 +464,7 @@ public:
 	void SetBase(const std::string &newBase);
 
 	/** 
-	 * \brief Get a list of all of the rules and their number of occurrences
+	 * \brief Get a list of all of the rules and their number of occurrences in all runs
 	 */
 	std::map<std::string, int> GetRules() const;
 
@@ -100,6 +475,16 @@ public:
 	 */
 	int SuppressRule(const std::string &ruleID);
 
+	/**
+	 * \brief The number of results SuppressRule() would remove, without changing the filters
+	 */
+	int RuleHits(const std::string& ruleID) const;
+
+	/**
+	 * \brief The ids of the results SuppressRule() would remove
+	 */
+	ResultBitmap RuleMatches(const std::string& ruleID) const;
+
 	/**
 	 * \brief Remove suppression of a rule
 	 * \param ruleID The ID of the rule to unsuppress
@@ -119,6 +504,24 @@ public:
 	 */
 	int AddLocationFilter(const std::string &regex);
 
+	/**
+	 * \brief The number of results AddLocationFilter() would remove, without changing the filters
+	 */
+	int LocationHits(const std::string& regex) const;
+
+	/**
+	 * \brief The ids of the results AddLocationFilter() would remove
+	 * \throws std::regex_error if \a regex is not a valid regular expression
+	 */
+	ResultBitmap LocationMatches(const std::string& regex) const;
+
+	/**
+	 * \brief The combined effect of the rule suppressions, location filters and expression filters of \a profile,
+	 * with one filter in the result for each of them, rules first, in order, and then one for its level and rank
+	 * threshold and one for its line ranges, if it has them
+	 */
+	FilterCoverage Coverage(const FilterProfile& profile) const;
+
 	/**
 	 * \brief Stop suppression of results matching a given regex
 	 * \param regex The regular expression to remove from the suppression list
@@ -131,6 +534,222 @@ public:
 	 */
 	std::vector<std::string> LocationFilters() const;
 
+	/**
+	 * \brief Suppress the output of results that match a filter expression, such as `level == note && line in 1..20`
+	 * \see FilterExpression for the syntax
+	 * \throws std::runtime_error or std::regex_error if \a expression is not valid, in which case it is not added
+	 * \returns The number of results this filter will remove (independent of any other filter)
+	 */
+	int AddExpressionFilter(const std::string& expression);
+
+	/**
+	 * \brief The number of results AddExpressionFilter() would remove
+	 * \throws std::runtime_error or std::regex_error if \a expression is not valid
+	 */
+	int ExpressionHits(const std::string& expression) const;
+
+	/**
+	 * \brief The ids of the results AddExpressionFilter() would remove
+	 * \throws std::runtime_error or std::regex_error if \a expression is not valid
+	 */
+	ResultBitmap ExpressionMatches(const std::string& expression) const;
+
+	/**
+	 * \brief Stop suppression of results matching a filter expression
+	 * \see AddExpressionFilter()
+	 */
+	void RemoveExpressionFilter(const std::string& expression);
+
+	/**
+	 * \brief Get the list of currently-active expression filters
+	 */
+	std::vector<std::string> ExpressionFilters() const;
+
+	/**
+	 * \brief Suppress the output of results below a level, or with a rank below a minimum
+	 * \param minimumLevel Results with a lower level are removed. Level::None keeps every level.
+	 * \param minimumRank Results whose \a rank is lower are removed. 0 keeps every rank. Results without a rank are
+	 * never removed by this threshold.
+	 * \returns The number of results this threshold will remove (independent of any other filter)
+	 */
+	int SetThreshold(Level minimumLevel, int minimumRank);
+
+	/**
+	 * \brief The number of results SetThreshold() would remove, without changing the filters
+	 * \note Counted from a histogram of the levels and ranks made when the file is loaded, so this does not look at
+	 * the results and is quick enough to call for every possible threshold
+	 */
+	int ThresholdHits(Level minimumLevel, int minimumRank) const;
+
+	/**
+	 * \brief The ids of the results SetThreshold() would remove
+	 */
+	ResultBitmap ThresholdMatches(Level minimumLevel, int minimumRank) const;
+
+	/**
+	 * \brief The ids of the results with the same fingerprint as an earlier result that is not in \a removed
+	 *
+	 * A profile that deduplicates keeps the first result that passes its other filters, so \a removed should be the
+	 * results those filters remove: when the first copy is removed by another filter, a later one is kept. The
+	 * results in \a removed are never matched.
+	 */
+	ResultBitmap DuplicateMatches(const ResultBitmap& removed = ResultBitmap()) const;
+
+	/**
+	 * \brief The ids of the results whose fingerprint is in \a baseline, which a profile with that baseline removes
+	 */
+	ResultBitmap BaselineMatches(const FingerprintSet& baseline) const;
+
+	/**
+	 * \brief The ids of the results that a profile with \a ranges as its \a lineRanges removes, because no line of
+	 * their region, from its start line to its end line, is in one of the ranges of their file
+	 *
+	 * Each distinct URI is looked up in \a ranges once, then every result's region is a binary search in its file's
+	 * ranges.
+	 */
+	ResultBitmap LineRangeMatches(const LineRanges& ranges) const;
+
+	/**
+	 * \brief The level set by SetThreshold()
+	 */
+	Level MinimumLevel() const;
+
+	/**
+	 * \brief The rank set by SetThreshold()
+	 */
+	int MinimumRank() const;
+
+	/**
+	 * \brief Control whether rule descriptors that no exported result refers to are dropped from \a tool.driver.rules
+	 * \param prune If true, Export() keeps only the rules referenced by the results that survive filtering, and
+	 * renumbers each result's \a ruleIndex to match the shortened array. Defaults to false.
+	 */
+	void SetPruneRules(bool prune);
+
+	/**
+	 * \brief Whether unused rule descriptors are removed on export
+	 * \see SetPruneRules()
+	 */
+	bool PruneRules() const;
+
+	/**
+	 * \brief Remove parts of each exported result that are not needed, such as \a codeFlows or \a relatedLocations
+	 * \param mode Whether \a paths lists the data to keep, or the data to drop
+	 * \param paths A list of paths within a single result object, with components separated by "/", for example
+	 * "locations/physicalLocation/region/snippet". Arrays are transparent: a path applies to every element of an
+	 * array it passes through. In \a Keep mode anything that is not on a listed path (or inside one) is removed, so
+	 * "message" and "ruleId" should normally be included.
+	 */
+	void SetResultProjection(ProjectionMode mode, const std::vector<std::string>& paths);
+
+	/**
+	 * \brief Get the current result projection mode
+	 * \see SetResultProjection()
+	 */
+	ProjectionMode ResultProjectionMode() const;
+
+	/**
+	 * \brief Get the current list of result projection paths
+	 * \see SetResultProjection()
+	 */
+	std::vector<std::string> ResultProjectionPaths() const;
+
+	/**
+	 * \brief Estimate the size of the file Export() would write with the filters that are currently set
+	 * \note The estimate is computed from sizes recorded at load time, no export is done. It does not account for
+	 * rule pruning, result projection, or a change of base path.
+	 */
+	size_t EstimateExportSize() const;
+
+	/**
+	 * \brief The number of bytes the results for each rule take up in the output, ignoring all filters
+	 */
+	std::map<std::string, size_t> BytesByRule() const;
+
+	/**
+	 * \brief The number of bytes the results in each directory take up in the output, ignoring all filters
+	 * \note Directories are the artifact URI with the filename removed, and do not include their subdirectories
+	 */
+	std::map<std::string, size_t> BytesByDirectory() const;
+
+	/**
+	 * \brief Work out which rules and directories to remove so that the exported file fits in \a budget bytes
+	 *
+	 * Starting from the filters that are already set, rules and directories are chosen one at a time: if a single
+	 * candidate would close the remaining gap, the smallest such candidate is used, otherwise the largest candidate
+	 * is taken and the process repeats. Everything is computed from the load-time index, without exporting.
+	 * \param budget The maximum output size, in bytes
+	 */
+	SizeBudgetPlan PlanSizeBudget(size_t budget) const;
+
+	/**
+	 * \brief Add the rule suppressions and location filters that make up \a plan
+	 * \returns The location filter regular expressions that were added, in the same order as
+	 * \a plan.directoriesToDrop
+	 */
+	std::vector<std::string> ApplySizeBudgetPlan(const SizeBudgetPlan& plan);
+
+	/**
+	 * \brief Create a location filter that matches the files directly inside \a directory
+	 * \param directory A directory as reported by BytesByDirectory() or PlanSizeBudget()
+	 * \returns A regular expression suitable for AddLocationFilter(). For a directory below the base it only
+	 * depends on the part below the base, so it still applies if the base is changed.
+	 */
+	std::string DirectoryFilter(const std::string& directory) const;
+
+	/**
+	 * \brief The number of results each filter of \a profile removes on its own, as SuppressRule() and
+	 * AddLocationFilter() would return them
+	 *
+	 * The index is walked once, in parallel, to count the results of each rule and URI, and the location filters
+	 * are all compiled and matched against the distinct URIs together, so this costs about the same for sixty
+	 * filters as for one.
+	 * \returns One count for each suppressed rule, then one for each location filter, then one for each expression
+	 * filter, in the order of the profile
+	 * \throws std::regex_error if one of the location filters is not a valid regular expression
+	 * \throws std::runtime_error if one of the expression filters is not valid
+	 */
+	std::vector<int> FilterHits(const FilterProfile& profile) const;
+
+	/**
+	 * \brief Add all of the rule suppressions, location filters and expression filters of \a profile to the current
+	 * filters at once
+	 * \note The other settings of \a profile are not used
+	 * \returns The same counts as FilterHits()
+	 * \throws std::regex_error or std::runtime_error if one of the filters is not valid, in which case nothing is added
+	 */
+	std::vector<int> ApplyFilterProfile(const FilterProfile& profile);
+
+	/**
+	 * \brief Work out which of the filters of \a profile overlap, duplicate each other, or do nothing
+	 *
+	 * Location filters are matched against the distinct URIs and rule suppressions against the distinct rule IDs,
+	 * each filter on its own thread, and the resulting sets of result ids are then compared pairwise. Nothing is
+	 * exported.
+	 * \param similarity Pairs of filters whose matches differ by at most this many results are reported as similar
+	 * \throws std::regex_error if one of the location filters is not a valid regular expression
+	 */
+	FilterAnalysis AnalyzeFilters(const FilterProfile& profile, size_t similarity = 5) const;
+
+	/**
+	 * \brief The number of results that \a profile keeps, computed from the load-time index without exporting
+	 */
+	size_t CountResults(const FilterProfile& profile) const;
+
+	/**
+	 * \brief The rule ID and artifact URI of each result that \a profile keeps, in file order
+	 * \param profile The filters to apply. If it replaces the base, the returned URIs use the new base.
+	 * \param limit The maximum number of entries to return, or 0 for all of them
+	 */
+	std::vector<std::pair<std::string, std::string>> ListResults(const FilterProfile& profile, size_t limit = 0) const;
+
+	/**
+	 * \brief A rough estimate of the memory held by this object, in bytes
+	 * \note Based on the serialized size of the document, so it is only useful for comparing objects
+	 * and for budgeting caches of them.
+	 */
+	size_t MemoryFootprint() const;
+
 	/** 
 	 * \brief Deep comparison operator: only true if both objects contain exactly the same JSON structure (whitespace is not counted)
 	 */
@@ -141,13 +760,161 @@ public:
 private:
 	QJsonDocument _json;
 
-	bool _overrideBase = false;
-	std::string _overrideBaseWith;
 	std::string _originalBasePath;
 
-	std::vector<std::string> _suppressedRules;
+	FilterProfile _filters;
 
-	std::vector<std::string> _locationFilters;
+	/**
+	 * \brief A tree of result projection paths: a node without children marks the end of a path
+	 */
+	struct ProjectionNode {
+		std::map<QString, ProjectionNode> children;
+	};
+
+	/**
+	 * \brief Information about each result, extracted once at load time and stored column by column
+	 *
+	 * A result's id is its position in the concatenation of the \a results arrays of all of the runs, in file order.
+	 * Strings are interned: each column stores an offset into the corresponding table of distinct values.
+	 */
+	struct Index {
+		std::vector<std::string> rules; ///< Distinct rule IDs, in order of first appearance
+		std::vector<std::string> uris;  ///< Distinct artifact URIs, in order of first appearance
+
+		std::vector<uint32_t> ruleOf;   ///< For each result, its rule's position in \a rules
+		std::vector<uint32_t> uriOf;    ///< For each result, its URI's position in \a uris
+		std::vector<uint32_t> bytes;    ///< For each result, its approximate size in the exported file
+		std::vector<uint32_t> lineOf;   ///< For each result, the start line of its first location, or 0
+		std::vector<uint32_t> endLineOf; ///< For each result, the end line of its first location, see GetEndLine()
+		std::vector<Level> levelOf;     ///< For each result, its severity
+		std::vector<uint8_t> rankOf;    ///< For each result, its rank as returned by RankOf()
+		std::vector<uint64_t> fingerprintOf; ///< For each result, its fingerprint as returned by FingerprintOf()
+		std::vector<ResultBitmap> ruleResults; ///< For each entry in \a rules, the ids of its results
+		std::vector<int> uriResults;    ///< For each entry in \a uris, the number of its results
+
+		/// The number of results with each level (the row) and rank (the column), with the results without a rank
+		/// in the last column
+		std::array<std::array<int, 102>, 4> levelRanks {};
+
+		std::vector<std::string> tags;  ///< Distinct tags of the rule descriptors, in order of first appearance
+		std::vector<std::vector<uint32_t>> ruleTags; ///< For each entry in \a rules, the positions in \a tags of its descriptor's tags
+		std::vector<ResultBitmap> tagRules; ///< For each entry in \a tags, the positions in \a rules of the rules with that tag
+		std::vector<int> tagResults;    ///< For each entry in \a tags, the number of results whose rule has that tag
+
+		std::vector<uint32_t> runStarts; ///< For each run, the id of its first result
+
+		size_t baseBytes = 0;           ///< The approximate size of the exported file if it contained no results
+	};
+
+	/**
+	 * \brief Never modified once built, so copies of this object share it
+	 */
+	std::shared_ptr<const Index> _index = std::make_shared<const Index>();
+
+	/**
+	 * \brief A run after filtering, but before projection and serialization
+	 */
+	struct FilteredRun {
+		QJsonObject run;                 ///< Everything in the run except its results and artifacts
+		bool hasResults = false;         ///< Whether the run had a results array
+		std::vector<QJsonValue> results; ///< The results that passed the filters, with the base already replaced
+		std::vector<uint32_t> ids;       ///< The result id of each entry in \a results
+	};
+
+	/**
+	 * \brief The whole document after filtering
+	 */
+	struct FilteredDocument {
+		QJsonObject root;                ///< Every top-level element except the version and the runs
+		std::string version = "2.1.0";   ///< The default, if there isn't one in the file
+		bool hasRuns = false;
+		std::vector<FilteredRun> runs;
+		int resultsRead = 0;
+		std::map<std::string, int> duplicates; ///< \see ExportStatistics::duplicates
+		int unchanged = 0;               ///< \see ExportStatistics::unchanged
+	};
+
+	/**
+	 * \brief Apply the rule suppressions, location filters and base change of each profile, in one walk over the results
+	 * \returns One filtered document per profile
+	 */
+	std::vector<FilteredDocument> FilterDocuments(const std::vector<const FilterProfile*>& profiles,
+		std::function<bool(void)> interruptionRequested) const;
+
+	/**
+	 * \brief Apply the projection and rule pruning of \a profile to some or all of the results in \a document and write
+	 * it to \a file
+	 * \param selection If not null, for each run the positions in FilteredRun::results to write. Otherwise all are written.
+	 * \note Does not modify any shared state, so may be called for several files at once from different threads
+	 */
+	ExportStatistics WriteDocument(const std::string& file, const FilteredDocument& document, const FilterProfile& profile,
+		const std::vector<std::vector<size_t>>* selection, std::function<bool(void)> interruptionRequested) const;
+
+	/**
+	 * \brief The bytes WriteDocument() writes, with the version line first
+	 */
+	QByteArray SerializeDocument(const FilteredDocument& document, const FilterProfile& profile,
+		const std::vector<std::vector<size_t>>* selection, std::function<bool(void)> interruptionRequested, ExportStatistics& statistics) const;
+
+	/**
+	 * \brief Call \a task with every number from 0 to \a count - 1, spread over as many threads as there are cores
+	 * \throws The first exception thrown by any of the tasks, once they have all finished
+	 */
+	static void ParallelFor(size_t count, const std::function<void(size_t)>& task);
+
+	/**
+	 * \brief KeptResults(), also counting the duplicates removed from each rule in \a duplicatesPerRule and the
+	 * results removed by the baseline in \a unchanged, for those that are set
+	 */
+	std::vector<bool> KeptResults(const FilterProfile& profile, std::vector<int>* duplicatesPerRule, int* unchanged = nullptr) const;
+
+	/**
+	 * \brief Resolve the predicates of \a expression against the index, so it can be evaluated with
+	 * ExpressionColumns()
+	 */
+	FilterExpression::Program CompileExpression(const FilterExpression& expression) const;
+
+	/**
+	 * \brief The columns of the index that a compiled expression reads
+	 */
+	FilterExpression::Columns ExpressionColumns() const;
+
+	/**
+	 * \brief Parse \a input into \a _json, check that it is SARIF, and index it
+	 * \see BuildIndex()
+	 */
+	size_t LoadDocument(QIODevice& input, const QJsonDocument& previousJson, const Index& previousIndex,
+		std::function<bool(void)> interruptionRequested);
+
+	/**
+	 * \brief Populate \a _index and \a _originalBasePath from \a _json
+	 * \param previousJson The previously loaded document, or an empty one
+	 * \param previousIndex The index of \a previousJson: entries for the leading results that have not changed are
+	 * copied from it instead of being recomputed
+	 * \returns The number of results whose entries were copied
+	 */
+	size_t BuildIndex(std::function<bool(void)> interruptionRequested, const QJsonDocument& previousJson, const Index& previousIndex);
+
+	/**
+	 * \brief The directory part of a URI (everything before the last slash or backslash)
+	 */
+	static std::string DirectoryOf(const std::string& uri);
+
+	/**
+	 * \brief Escape all ECMAScript regular expression metacharacters in \a text
+	 */
+	static std::string EscapeRegex(const std::string& text);
+
+	/**
+	 * \brief The first directory of \a uri below \a base, "root" for files directly in \a base, or "other" for files
+	 * outside it
+	 */
+	static std::string TopLevelComponent(const std::string& uri, const std::string& base);
+
+	/**
+	 * \brief Replace every character of \a name that might not be valid in a filename
+	 */
+	static std::string SanitizeFilename(const std::string& name);
 
 	/**
 	 * \brief A utility function to extract the artifact URI from a single SARIF-formatted JSON result object
@@ -172,9 +939,72 @@ private:
 	 */
 	static void ReplaceUri(const std::string& lookFor, const std::string& replaceWith, QJsonValueRef in);
 
+	/**
+	 * \brief Given a single result, return the start line of its first location, or 0 if it doesn't have one
+	 */
+	static uint32_t GetLine(const QJsonObject& result);
+
+	/**
+	 * \brief Given a single result, return the end line of its first location, which is its start line if the region
+	 * has no end line, or ends before it starts
+	 */
+	static uint32_t GetEndLine(const QJsonObject& result);
+
+	/**
+	 * \brief Given a single result, return its \a level, or the default of Level::Warning
+	 */
+	static Level GetLevel(const QJsonObject& result);
+
+	/**
+	 * \brief Given a single result, return its fingerprint as described by FingerprintOf()
+	 */
+	static uint64_t GetFingerprint(const QJsonObject& result);
+
+	/**
+	 * \brief Given a single result, return its \a rank as described by RankOf()
+	 */
+	static uint8_t GetRank(const QJsonObject& result);
+
+	/**
+	 * \brief The lowest value of RankOf() that a minimum rank of \a minimumRank keeps, which is never above Unranked
+	 */
+	static uint8_t RankThreshold(int minimumRank);
+
 	/**
 	 * \brief Given a single result, return what rule it represents
 	 * \param result - A JSON-formatted object that conforms to the SARIF schema for a single item in the result array.
 	 */
 	static std::string GetRule(const QJsonObject& result);
-};
\ No newline at end of file
+
+	/**
+	 * \brief Remove the entries in \a tool.driver.rules that are not referenced by any of \a results, and update the
+	 * \a ruleIndex (and \a rule.index) of each result to point into the shortened array.
+	 * \param tool The \a tool object of a run. Modified in place.
+	 * \param results The filtered results of the same run. Modified in place.
+	 */
+	static void RemoveUnusedRules(QJsonObject& tool, QJsonArray& results);
+
+	/**
+	 * \brief Turn a list of "/"-separated projection paths into a tree
+	 */
+	static ProjectionNode BuildProjection(const std::vector<std::string>& paths);
+
+	/**
+	 * \brief Apply a result projection to a JSON value
+	 * \param value The value to project (normally a single result)
+	 * \param node The projection tree node corresponding to \a value
+	 * \param mode Keep or Drop
+	 * \param path The path of \a value within the result, used as the key in \a bytesRemoved
+	 * \param bytesRemoved Accumulates the compact-JSON size of everything that was removed
+	 * \returns The projected copy of \a value
+	 */
+	static QJsonValue Project(const QJsonValue& value, const ProjectionNode& node, ProjectionMode mode, const std::string& path,
+		std::map<std::string, size_t>& bytesRemoved);
+
+	/**
+	 * \brief The number of bytes \a value occupies when written as compact JSON
+	 */
+	static size_t SerializedSize(const QJsonValue& value);
+};
+
+#endif // _CLEANSARIF_SARIF_H_
@@ -0,0 +1,56 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "SARIFClient.h"
+
+#pragma warning(push, 1) 
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QElapsedTimer>
+#pragma warning(pop)
+
+#include <stdexcept>
+
+QJsonObject SARIFClient::Request(const QString& serverName, const QJsonObject& request, int timeoutMilliseconds)
+{
+	QLocalSocket socket;
+	socket.connectToServer(serverName);
+	if (!socket.waitForConnected(timeoutMilliseconds))
+		throw std::runtime_error("Could not connect to " + serverName.toStdString() + ": " + socket.errorString().toStdString());
+
+	socket.write(QJsonDocument(request).toJson(QJsonDocument::Compact));
+	socket.write("\n");
+	socket.flush();
+
+	QElapsedTimer timer;
+	timer.start();
+	while (!socket.canReadLine()) {
+		auto remaining = timeoutMilliseconds - static_cast<int>(timer.elapsed());
+		if (remaining <= 0 || !socket.waitForReadyRead(remaining))
+			throw std::runtime_error("No reply from " + serverName.toStdString());
+	}
+	auto reply = QJsonDocument::fromJson(socket.readLine());
+	socket.disconnectFromServer();
+	if (!reply.isObject())
+		throw std::runtime_error("Invalid reply from " + serverName.toStdString());
+	return reply.object();
+}
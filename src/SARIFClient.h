@@ -0,0 +1,48 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CLEANSARIF_SARIFCLIENT_H_
+#define _CLEANSARIF_SARIFCLIENT_H_
+
+#pragma warning(push, 1) 
+#include <QString>
+#include <QJsonObject>
+#pragma warning(pop)
+
+/**
+ * \brief A minimal blocking client for SARIFServer
+ */
+class SARIFClient
+{
+public:
+
+	/**
+	 * \brief Send one request and wait for the reply
+	 * \param serverName The name the server is listening on
+	 * \param request The request object, see SARIFServer for the commands
+	 * \param timeoutMilliseconds How long to wait for the connection and for the reply
+	 * \throws std::runtime_error if the server cannot be reached or does not reply in time
+	 */
+	static QJsonObject Request(const QString& serverName, const QJsonObject& request, int timeoutMilliseconds = 30000);
+};
+
+#endif // _CLEANSARIF_SARIFCLIENT_H_
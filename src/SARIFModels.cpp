@@ -0,0 +1,389 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "SARIFModels.h"
+
+#include <algorithm>
+#include <numeric>
+#include <cctype>
+
+IndexRowsModel::IndexRowsModel(std::shared_ptr<const SARIF> report, QObject* parent) :
+	QAbstractTableModel(parent),
+	_report(std::move(report))
+{
+}
+
+int IndexRowsModel::rowCount(const QModelIndex& parent) const
+{
+	return parent.isValid() ? 0 : static_cast<int>(_rows.size());
+}
+
+std::shared_ptr<const SARIF> IndexRowsModel::Report() const
+{
+	return _report;
+}
+
+void IndexRowsModel::SortRows(const std::function<bool(uint32_t, uint32_t)>& less, Qt::SortOrder order)
+{
+	auto rows = _rows;
+	if (order == Qt::AscendingOrder)
+		std::stable_sort(rows.begin(), rows.end(), less);
+	else
+		std::stable_sort(rows.begin(), rows.end(), [&less](uint32_t a, uint32_t b) { return less(b, a); });
+	SetRowOrder(std::move(rows));
+}
+
+void IndexRowsModel::SetRowOrder(std::vector<uint32_t> rows)
+{
+	emit layoutAboutToBeChanged();
+	auto oldRows = std::move(_rows);
+	_rows = std::move(rows);
+
+	// Each id appears at most once, so the persistent indexes can be moved by looking up their id's new row
+	std::vector<int> newRowOf(1 + (_rows.empty() ? 0 : *std::max_element(_rows.begin(), _rows.end())), -1);
+	for (size_t row = 0; row < _rows.size(); ++row)
+		newRowOf[_rows[row]] = static_cast<int>(row);
+	auto from = persistentIndexList();
+	QModelIndexList to;
+	for (const auto& index : from)
+		to.append(createIndex(newRowOf[oldRows[index.row()]], index.column()));
+	changePersistentIndexList(from, to);
+	emit layoutChanged();
+}
+
+RuleTableModel::RuleTableModel(std::shared_ptr<const SARIF> report, QObject* parent) :
+	IndexRowsModel(std::move(report), parent),
+	_counts(_report->ResultsPerRule())
+{
+	_rows.resize(_counts.size());
+	std::iota(_rows.begin(), _rows.end(), 0);
+}
+
+int RuleTableModel::columnCount(const QModelIndex& parent) const
+{
+	return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant RuleTableModel::data(const QModelIndex& index, int role) const
+{
+	if (!index.isValid() || index.row() >= rowCount())
+		return QVariant();
+	auto rule = _rows[index.row()];
+	if (role == Qt::DisplayRole) {
+		if (index.column() == RuleColumn)
+			return QString::fromStdString(_report->DistinctRules()[rule]);
+		if (index.column() == TagsColumn)
+			return TagsText(rule);
+		return _counts[rule];
+	}
+	if (role == Qt::TextAlignmentRole && index.column() == CountColumn)
+		return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+	return QVariant();
+}
+
+QVariant RuleTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+		return QVariant();
+	switch (section) {
+	case RuleColumn:
+		return tr("Rule");
+	case CountColumn:
+		return tr("Match count");
+	default:
+		return tr("Tags");
+	}
+}
+
+void RuleTableModel::sort(int column, Qt::SortOrder order)
+{
+	_sortColumn = column;
+	_sortOrder = order;
+	const auto& rules = _report->DistinctRules();
+	if (column == RuleColumn)
+		SortRows([&rules](uint32_t a, uint32_t b) { return rules[a] < rules[b]; }, order);
+	else if (column == CountColumn)
+		SortRows([this](uint32_t a, uint32_t b) { return _counts[a] < _counts[b]; }, order);
+	else if (column == TagsColumn) {
+		// The text of each rule's tags is only built once, rather than for every comparison
+		std::vector<QString> tags(rules.size());
+		for (auto rule : _rows)
+			tags[rule] = TagsText(rule);
+		SortRows([&tags](uint32_t a, uint32_t b) { return tags[a] < tags[b]; }, order);
+	}
+}
+
+QString RuleTableModel::TagsText(uint32_t rule) const
+{
+	QStringList tags;
+	for (auto tag : _report->TagsOfRule(rule))
+		tags.append(QString::fromStdString(_report->DistinctTags()[tag]));
+	return tags.join(", ");
+}
+
+void RuleTableModel::SetFilter(const QString& text)
+{
+	_filterText = text;
+	ApplyFilters();
+}
+
+void RuleTableModel::SetTag(int tag)
+{
+	_tag = tag;
+	ApplyFilters();
+}
+
+void RuleTableModel::ApplyFilters()
+{
+	auto needle = _filterText.toLower().toStdString();
+	auto contains = [&needle](const std::string& haystack) {
+		return std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(), [](char a, char b) {
+			return std::tolower(static_cast<unsigned char>(a)) == b;
+		}) != haystack.end();
+	};
+
+	beginResetModel();
+	_rows.clear();
+	const auto& rules = _report->DistinctRules();
+	const ResultBitmap* tagged = _tag >= 0 ? &_report->RulesWithTag(static_cast<uint32_t>(_tag)) : nullptr;
+	for (uint32_t rule = 0; rule < rules.size(); ++rule) {
+		if ((needle.empty() || contains(rules[rule])) && (!tagged || tagged->Contains(rule)))
+			_rows.push_back(rule);
+	}
+	endResetModel();
+	if (_sortColumn >= 0)
+		sort(_sortColumn, _sortOrder);
+}
+
+QString RuleTableModel::Rule(int row) const
+{
+	return QString::fromStdString(_report->DistinctRules()[_rows[row]]);
+}
+
+UriListModel::UriListModel(std::shared_ptr<const SARIF> report, QObject* parent) :
+	IndexRowsModel(std::move(report), parent)
+{
+}
+
+int UriListModel::columnCount(const QModelIndex& parent) const
+{
+	return parent.isValid() ? 0 : 1;
+}
+
+QVariant UriListModel::data(const QModelIndex& index, int role) const
+{
+	if (!index.isValid() || index.row() >= rowCount())
+		return QVariant();
+	if (role == Qt::DisplayRole || role == Qt::ToolTipRole)
+		return Uri(index.row());
+	return QVariant();
+}
+
+void UriListModel::sort(int column, Qt::SortOrder order)
+{
+	Q_UNUSED(column);
+	const auto& uris = _report->DistinctUris();
+	SortRows([&uris](uint32_t a, uint32_t b) { return uris[a] < uris[b]; }, order);
+}
+
+void UriListModel::Clear()
+{
+	beginResetModel();
+	_rows.clear();
+	endResetModel();
+}
+
+void UriListModel::Append(const QVector<int>& uris)
+{
+	if (uris.isEmpty())
+		return;
+	beginInsertRows(QModelIndex(), rowCount(), rowCount() + uris.count() - 1);
+	for (auto uri : uris)
+		_rows.push_back(static_cast<uint32_t>(uri));
+	endInsertRows();
+}
+
+QString UriListModel::Uri(int row) const
+{
+	return QString::fromStdString(_report->DistinctUris()[_rows[row]]);
+}
+
+ResultTableModel::ResultTableModel(std::shared_ptr<const SARIF> report, QObject* parent) :
+	IndexRowsModel(std::move(report), parent),
+	_permutations(ColumnCount)
+{
+	_rows.resize(_report->ResultCount());
+	std::iota(_rows.begin(), _rows.end(), 0);
+}
+
+int ResultTableModel::columnCount(const QModelIndex& parent) const
+{
+	return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant ResultTableModel::data(const QModelIndex& index, int role) const
+{
+	if (!index.isValid() || index.row() >= rowCount())
+		return QVariant();
+	auto result = _rows[index.row()];
+	if (role == Qt::DisplayRole) {
+		switch (index.column()) {
+		case StateColumn:
+			return _coverage && _coverage->IsRemoved(result) ? tr("Removed") : tr("Kept");
+		case RuleColumn:
+			return QString::fromStdString(_report->DistinctRules()[_report->RuleOf(result)]);
+		case FileColumn:
+			return QString::fromStdString(_report->DistinctUris()[_report->UriOf(result)]);
+		case LineColumn:
+			return _report->LineOf(result) > 0 ? QVariant(_report->LineOf(result)) : QVariant();
+		case LevelColumn:
+			switch (_report->LevelOf(result)) {
+			case SARIF::Level::None: return tr("None");
+			case SARIF::Level::Note: return tr("Note");
+			case SARIF::Level::Warning: return tr("Warning");
+			case SARIF::Level::Error: return tr("Error");
+			}
+			break;
+		case MessageColumn:
+		{
+			// Only the first line fits in a row: the tooltip has the rest
+			auto message = _report->MessageOf(result);
+			return QString::fromStdString(message.substr(0, message.find('\n')));
+		}
+		}
+	}
+	else if (role == Qt::ToolTipRole) {
+		if (index.column() == FileColumn)
+			return QString::fromStdString(_report->DistinctUris()[_report->UriOf(result)]);
+		if (index.column() == MessageColumn)
+			return QString::fromStdString(_report->MessageOf(result));
+	}
+	else if (role == Qt::TextAlignmentRole && index.column() == LineColumn) {
+		return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+	}
+	return QVariant();
+}
+
+QVariant ResultTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+		return QVariant();
+	switch (section) {
+	case StateColumn: return tr("State");
+	case RuleColumn: return tr("Rule");
+	case FileColumn: return tr("File");
+	case LineColumn: return tr("Line");
+	case LevelColumn: return tr("Level");
+	case MessageColumn: return tr("Message");
+	}
+	return QVariant();
+}
+
+void ResultTableModel::sort(int column, Qt::SortOrder order)
+{
+	if (column < 0 || column >= MessageColumn)
+		return;
+	_sortColumn = column;
+	_sortOrder = order;
+	const auto& ascending = Permutation(column);
+	if (order == Qt::AscendingOrder)
+		SetRowOrder(ascending);
+	else
+		SetRowOrder(std::vector<uint32_t>(ascending.rbegin(), ascending.rend()));
+}
+
+void ResultTableModel::SetFilters(const SARIF::FilterProfile& profile)
+{
+	SetCoverage(std::make_shared<const FilterCoverage>(_report->Coverage(profile)));
+}
+
+void ResultTableModel::SetCoverage(std::shared_ptr<const FilterCoverage> coverage)
+{
+	_coverage = std::move(coverage);
+	CoverageChanged();
+}
+
+void ResultTableModel::CoverageChanged()
+{
+	_permutations[StateColumn].clear();
+	if (rowCount() > 0)
+		emit dataChanged(index(0, StateColumn), index(rowCount() - 1, StateColumn), { Qt::DisplayRole });
+	if (_sortColumn == StateColumn)
+		sort(_sortColumn, _sortOrder);
+}
+
+int ResultTableModel::KeptCount() const
+{
+	return _coverage ? static_cast<int>(_coverage->Remaining()) : rowCount();
+}
+
+size_t ResultTableModel::Result(int row) const
+{
+	return _rows[row];
+}
+
+const std::vector<uint32_t>& ResultTableModel::Permutation(int column)
+{
+	auto& permutation = _permutations[column];
+	if (!permutation.empty() || _rows.empty())
+		return permutation;
+
+	// Strings are compared once per distinct value, and the results are then sorted by that value's rank
+	auto ranks = [](const std::vector<std::string>& table) {
+		std::vector<uint32_t> order(table.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&table](uint32_t a, uint32_t b) { return table[a] < table[b]; });
+		std::vector<uint32_t> rank(table.size());
+		for (uint32_t position = 0; position < order.size(); ++position)
+			rank[order[position]] = position;
+		return rank;
+	};
+
+	std::vector<uint32_t> key(_report->ResultCount());
+	if (column == StateColumn) {
+		for (size_t result = 0; result < key.size(); ++result)
+			key[result] = _coverage && _coverage->IsRemoved(result) ? 0 : 1;
+	}
+	else if (column == RuleColumn) {
+		auto rank = ranks(_report->DistinctRules());
+		for (size_t result = 0; result < key.size(); ++result)
+			key[result] = rank[_report->RuleOf(result)];
+	}
+	else if (column == FileColumn) {
+		auto rank = ranks(_report->DistinctUris());
+		for (size_t result = 0; result < key.size(); ++result)
+			key[result] = rank[_report->UriOf(result)];
+	}
+	else if (column == LineColumn) {
+		for (size_t result = 0; result < key.size(); ++result)
+			key[result] = _report->LineOf(result);
+	}
+	else if (column == LevelColumn) {
+		for (size_t result = 0; result < key.size(); ++result)
+			key[result] = static_cast<uint32_t>(_report->LevelOf(result));
+	}
+
+	permutation.resize(key.size());
+	std::iota(permutation.begin(), permutation.end(), 0);
+	std::stable_sort(permutation.begin(), permutation.end(), [&key](uint32_t a, uint32_t b) { return key[a] < key[b]; });
+	return permutation;
+}
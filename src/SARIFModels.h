@@ -0,0 +1,241 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CLEANSARIF_SARIFMODELS_H_
+#define _CLEANSARIF_SARIFMODELS_H_
+
+#pragma warning(push, 1) 
+#include <QAbstractTableModel>
+#include <QVector>
+#pragma warning(pop)
+
+#include "SARIF.h"
+
+#include <memory>
+#include <vector>
+#include <functional>
+
+/**
+ * \brief The common part of the item models over a loaded report's index
+ *
+ * Each row holds just the id of an entry in one of the index's tables of interned strings, so sorting and
+ * filtering only move ids around, and strings are only converted to QString when a view asks for a row it
+ * is about to draw. The models keep the report snapshot they were created with alive.
+ */
+class IndexRowsModel : public QAbstractTableModel {
+
+	Q_OBJECT
+
+public:
+
+	int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+	/**
+	 * \brief The report snapshot this model shows
+	 */
+	std::shared_ptr<const SARIF> Report() const;
+
+protected:
+
+	IndexRowsModel(std::shared_ptr<const SARIF> report, QObject* parent);
+
+	/**
+	 * \brief Reorder the rows, keeping persistent indexes (such as a view's selection) on the same ids
+	 * \param less Compares two ids
+	 */
+	void SortRows(const std::function<bool(uint32_t, uint32_t)>& less, Qt::SortOrder order);
+
+	/**
+	 * \brief Show the same ids in the order given by \a rows, keeping persistent indexes on the same ids
+	 */
+	void SetRowOrder(std::vector<uint32_t> rows);
+
+	std::shared_ptr<const SARIF> _report;
+	std::vector<uint32_t> _rows; ///< The id shown in each row
+};
+
+/**
+ * \brief The distinct rules of a report, with the number of results for each
+ */
+class RuleTableModel : public IndexRowsModel {
+
+	Q_OBJECT
+
+public:
+
+	enum Column {
+		RuleColumn,
+		CountColumn,
+		TagsColumn,   ///< The tags of the rule's descriptor, sorted by the text shown
+		ColumnCount
+	};
+
+	explicit RuleTableModel(std::shared_ptr<const SARIF> report, QObject* parent = nullptr);
+
+	int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+	void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+	/**
+	 * \brief Only show the rules whose ID contains \a text, ignoring case. An empty string shows them all.
+	 */
+	void SetFilter(const QString& text);
+
+	/**
+	 * \brief Only show the rules with \a tag, a position in SARIF::DistinctTags(), or all of them if it is negative
+	 *
+	 * Combines with SetFilter().
+	 */
+	void SetTag(int tag);
+
+	/**
+	 * \brief The rule ID shown in \a row
+	 */
+	QString Rule(int row) const;
+
+private:
+	/**
+	 * \brief Rebuild the rows from the text and tag filters
+	 */
+	void ApplyFilters();
+
+	/**
+	 * \brief The tags of \a rule, as shown in the tags column
+	 */
+	QString TagsText(uint32_t rule) const;
+
+	std::vector<int> _counts; ///< By rule id
+	QString _filterText;
+	int _tag = -1;
+	int _sortColumn = -1;
+	Qt::SortOrder _sortOrder = Qt::AscendingOrder;
+};
+
+/**
+ * \brief A list of some of the distinct URIs of a report, which can grow as more are found
+ */
+class UriListModel : public IndexRowsModel {
+
+	Q_OBJECT
+
+public:
+
+	/**
+	 * \brief Create an empty list
+	 */
+	explicit UriListModel(std::shared_ptr<const SARIF> report, QObject* parent = nullptr);
+
+	int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+	void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+	/**
+	 * \brief Remove every row
+	 */
+	void Clear();
+
+	/**
+	 * \brief Add rows at the end
+	 * \param uris Positions in SARIF::DistinctUris()
+	 */
+	void Append(const QVector<int>& uris);
+
+	/**
+	 * \brief The URI shown in \a row
+	 */
+	QString Uri(int row) const;
+};
+
+/**
+ * \brief Every result of a report, showing whether the current filters keep or remove it
+ *
+ * The rows are result ids, so a report with a million results costs a few megabytes here. The text of a row is
+ * only produced when a view draws it, and messages are only read from the JSON document then. Sorting by a column
+ * builds that column's permutation of the ids once and reuses it, in either direction, until the report changes.
+ */
+class ResultTableModel : public IndexRowsModel {
+
+	Q_OBJECT
+
+public:
+
+	enum Column {
+		StateColumn,
+		RuleColumn,
+		FileColumn,
+		LineColumn,
+		LevelColumn,
+		MessageColumn, ///< Not sortable: sorting would mean reading every message
+		ColumnCount
+	};
+
+	/**
+	 * \brief Show every result of \a report, all of them kept until SetFilters() is called
+	 */
+	explicit ResultTableModel(std::shared_ptr<const SARIF> report, QObject* parent = nullptr);
+
+	int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+	void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+	/**
+	 * \brief Update the state column for the rule suppressions and location filters of \a profile
+	 */
+	void SetFilters(const SARIF::FilterProfile& profile);
+
+	/**
+	 * \brief Take the state column from \a coverage, which may go on being changed by its owner
+	 * \see CoverageChanged()
+	 */
+	void SetCoverage(std::shared_ptr<const FilterCoverage> coverage);
+
+	/**
+	 * \brief Redraw the state column after the filters in the coverage have changed
+	 */
+	void CoverageChanged();
+
+	/**
+	 * \brief The number of results the current filters keep
+	 */
+	int KeptCount() const;
+
+	/**
+	 * \brief The result id shown in \a row
+	 */
+	size_t Result(int row) const;
+
+private:
+
+	/**
+	 * \brief The result ids in ascending order of \a column, built the first time it is needed
+	 */
+	const std::vector<uint32_t>& Permutation(int column);
+
+	std::shared_ptr<const FilterCoverage> _coverage; ///< Nothing is removed while this is unset
+	std::vector<std::vector<uint32_t>> _permutations; ///< By column, empty until that column is sorted
+	int _sortColumn = -1;
+	Qt::SortOrder _sortOrder = Qt::AscendingOrder;
+};
+
+#endif // _CLEANSARIF_SARIFMODELS_H_
@@ -0,0 +1,182 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "SARIFServer.h"
+#include "Cleaner.h"
+
+#pragma warning(push, 1) 
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#pragma warning(pop)
+
+#include <stdexcept>
+
+SARIFServer::SARIFServer(size_t memoryBudget, QObject* parent) :
+	QObject(parent),
+	_cache(memoryBudget)
+{
+	connect(&_server, &QLocalServer::newConnection, this, &SARIFServer::acceptConnection);
+}
+
+bool SARIFServer::Listen(const QString& name)
+{
+	// A server that crashed may have left its socket file behind, but one that is still running must be left alone:
+	// listening then fails, as the name is in use
+	QLocalSocket probe;
+	probe.connectToServer(name);
+	if (probe.waitForConnected(1000))
+		probe.disconnectFromServer();
+	else
+		QLocalServer::removeServer(name);
+	return _server.listen(name);
+}
+
+QString SARIFServer::ErrorString() const
+{
+	return _server.errorString();
+}
+
+ReportCache& SARIFServer::Cache()
+{
+	return _cache;
+}
+
+void SARIFServer::acceptConnection()
+{
+	while (auto socket = _server.nextPendingConnection()) {
+		connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { readRequests(socket); });
+		connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+	}
+}
+
+void SARIFServer::readRequests(QLocalSocket* socket)
+{
+	while (socket->canReadLine()) {
+		auto line = socket->readLine();
+		QJsonParseError parseError;
+		auto document = QJsonDocument::fromJson(line, &parseError);
+		QJsonObject reply;
+		if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+			reply.insert("ok", false);
+			reply.insert("error", QString::fromLatin1("Request is not a JSON object"));
+		}
+		else {
+			reply = HandleRequest(document.object());
+		}
+		socket->write(QJsonDocument(reply).toJson(QJsonDocument::Compact));
+		socket->write("\n");
+		socket->flush();
+	}
+}
+
+QJsonObject SARIFServer::HandleRequest(const QJsonObject& request)
+{
+	QElapsedTimer timer;
+	timer.start();
+	QJsonObject reply;
+	auto command = request["command"].toString();
+	try {
+		if (command == "status") {
+			reply.insert("reports", static_cast<qint64>(_cache.Size()));
+			reply.insert("memoryUsed", static_cast<qint64>(_cache.MemoryUsed()));
+			reply.insert("memoryBudget", static_cast<qint64>(_cache.MemoryBudget()));
+			reply.insert("ok", true);
+			return reply;
+		}
+
+		auto file = request["file"].toString().toStdString();
+		if (file.empty())
+			throw std::runtime_error("Request has no file");
+		if (command == "evict") {
+			_cache.Evict(file);
+			reply.insert("ok", true);
+			return reply;
+		}
+		if (command != "count" && command != "list" && command != "export")
+			throw std::runtime_error("Unknown command " + command.toStdString());
+
+		bool cached = false;
+		auto report = _cache.Get(file, &cached);
+		auto profile = Cleaner::FilterProfileFromJson(request["filters"].toObject());
+		if (profile.overrideBase) {
+			profile.base = Cleaner::AdjustBase(QString::fromStdString(report->GetBase()),
+				QString::fromStdString(profile.base)).toStdString();
+		}
+		auto baseline = request["baseline"].toString().toStdString();
+		if (!baseline.empty()) {
+			// The baseline is a report like any other, so it is only indexed once, and its fingerprints are only
+			// collected once, while it stays in the cache
+			profile.baseline = _cache.Fingerprints(baseline);
+		}
+
+		// Compiled once here rather than by each query the request makes
+		try {
+			profile.Compile();
+		}
+		catch (const std::regex_error& e) {
+			throw std::runtime_error(std::string("Invalid regular expression in a filter: ") + e.what());
+		}
+
+		if (command == "count") {
+			reply.insert("count", static_cast<qint64>(report->CountResults(profile)));
+		}
+		else if (command == "list") {
+			QJsonArray results;
+			for (const auto& result : report->ListResults(profile, static_cast<size_t>(request["limit"].toInt(0)))) {
+				QJsonObject entry;
+				entry.insert("ruleId", QString::fromStdString(result.first));
+				entry.insert("uri", QString::fromStdString(result.second));
+				results.append(entry);
+			}
+			reply.insert("results", results);
+		}
+		else {
+			auto output = request["output"].toString().toStdString();
+			if (output.empty())
+				throw std::runtime_error("Export request has no output");
+
+			// The cached reports are read from these files, so writing over one would lose it for good
+			auto resolved = [](const std::string& path) {
+				QFileInfo info(QString::fromStdString(path));
+				return info.exists() ? info.canonicalFilePath() : info.absoluteFilePath();
+			};
+			if (resolved(output) == resolved(file) || (!baseline.empty() && resolved(output) == resolved(baseline)))
+				throw std::runtime_error("Export request would overwrite its input " + output);
+			auto statistics = report->ExportProfiles({ std::make_pair(profile, output) }).front();
+			reply.insert("resultsRead", statistics.resultsRead);
+			reply.insert("resultsWritten", statistics.resultsWritten);
+			if (profile.baseline)
+				reply.insert("unchanged", statistics.unchanged);
+		}
+		reply.insert("cached", cached);
+		reply.insert("ok", true);
+	}
+	catch (const std::exception& e) {
+		reply.insert("ok", false);
+		reply.insert("error", QString::fromLocal8Bit(e.what()));
+	}
+	reply.insert("microseconds", static_cast<qint64>(timer.nsecsElapsed() / 1000));
+	return reply;
+}
@@ -0,0 +1,95 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CLEANSARIF_SARIFSERVER_H_
+#define _CLEANSARIF_SARIFSERVER_H_
+
+#pragma warning(push, 1) 
+#include <QObject>
+#include <QLocalServer>
+#include <QJsonObject>
+#pragma warning(pop)
+
+#include "ReportCache.h"
+
+class QLocalSocket;
+
+/**
+ * \brief A local service that answers questions about SARIF files, keeping them loaded between requests
+ *
+ * Clients connect to a local socket (a Unix domain socket, or a named pipe on Windows) and send one JSON
+ * object per line. Each request gets a single-line JSON reply. Every request has a "command" and, except
+ * for "status", a "file":
+ * - "count": the number of results left after applying "filters"
+ * - "list": the rule ID and URI of each remaining result, up to an optional "limit"
+ * - "export": write the filtered file to "output", which may not be the "file" or the "baseline"
+ * - "evict": drop the file from the cache
+ * - "status": the number of cached reports and the memory they use
+ *
+ * "filters" uses the same format as the "xdata" object of a saved filter file. An optional "baseline" names
+ * another report, cached in the same way, whose results are removed. Every reply has "ok" and,
+ * on failure, "error"; replies about a file also report whether it was "cached" and the "microseconds"
+ * taken to answer.
+ * \see SARIFClient
+ */
+class SARIFServer : public QObject {
+
+	Q_OBJECT
+
+public:
+
+	/**
+	 * \brief Create a server that is not yet listening
+	 * \param memoryBudget The approximate number of bytes of loaded reports to keep
+	 */
+	explicit SARIFServer(size_t memoryBudget, QObject* parent = nullptr);
+
+	/**
+	 * \brief Start accepting connections on the local socket \a name, replacing a stale socket left by a server that
+	 * is no longer running
+	 * \returns false on failure, including when another server is answering on \a name, see ErrorString()
+	 */
+	bool Listen(const QString& name);
+
+	QString ErrorString() const;
+
+	/**
+	 * \brief Answer a single request
+	 * \note Requests arriving on the socket are passed here, but it can also be called directly.
+	 */
+	QJsonObject HandleRequest(const QJsonObject& request);
+
+	/**
+	 * \brief The loaded reports
+	 */
+	ReportCache& Cache();
+
+private:
+
+	void acceptConnection();
+	void readRequests(QLocalSocket* socket);
+
+	QLocalServer _server;
+	ReportCache _cache;
+};
+
+#endif // _CLEANSARIF_SARIFSERVER_H_
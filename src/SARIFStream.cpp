@@ -0,0 +1,867 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "SARIFStream.h"
+
+#pragma warning(push, 1) 
+#include <QIODevice>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#pragma warning(pop)
+
+#include <stdexcept>
+#include <algorithm>
+#include <thread>
+#include <map>
+
+namespace {
+	const int ChunkSize = 64 * 1024;
+
+	/**
+	 * \brief Parse a JSON value of any type: QJsonDocument only takes an object or an array
+	 */
+	QJsonValue ParseValue(const QByteArray& raw)
+	{
+		return QJsonDocument::fromJson("{\"value\": " + raw + "}").object().value("value");
+	}
+
+	/**
+	 * \brief Replace the \a index of every artifactLocation within \a value with its entry in \a newIndex
+	 * \returns Whether anything was replaced
+	 */
+	bool RenumberArtifacts(QJsonValue& value, const std::vector<int>& newIndex)
+	{
+		bool changed = false;
+		auto renumberChild = [&newIndex](const QString& key, QJsonValue& child) {
+			if (key == "artifactLocation" && child.isObject()) {
+				auto location = child.toObject();
+				const int index = location.value("index").toInt(-1);
+				if (index < 0 || index >= static_cast<int>(newIndex.size()) || newIndex[index] == index)
+					return false;
+				location.insert("index", newIndex[index]);
+				child = location;
+				return true;
+			}
+			return (child.isObject() || child.isArray()) && RenumberArtifacts(child, newIndex);
+		};
+		if (value.isObject()) {
+			auto object = value.toObject();
+			for (const auto& key : object.keys()) {
+				auto child = object.value(key);
+				if (renumberChild(key, child)) {
+					object.insert(key, child);
+					changed = true;
+				}
+			}
+			if (changed)
+				value = object;
+		}
+		else if (value.isArray()) {
+			auto array = value.toArray();
+			for (int element = 0; element < array.size(); ++element) {
+				auto child = array.at(element);
+				if (renumberChild(QString(), child)) {
+					array.replace(element, child);
+					changed = true;
+				}
+			}
+			if (changed)
+				value = array;
+		}
+		return changed;
+	}
+
+	/**
+	 * \brief Add the \a originalUriBaseIds and \a invocations of \a run, from \a input, to those of \a merged, a run of
+	 * the same tool
+	 * \throws std::runtime_error if the runs give the same base id different values, which would move the results of
+	 * one of them
+	 */
+	void MergeRunMembers(QJsonObject& merged, const QJsonObject& run, const std::string& input)
+	{
+		auto bases = merged.value("originalUriBaseIds").toObject();
+		const auto runBases = run.value("originalUriBaseIds").toObject();
+		for (auto base = runBases.constBegin(); base != runBases.constEnd(); ++base) {
+			if (!bases.contains(base.key()))
+				bases.insert(base.key(), base.value());
+			else if (bases.value(base.key()) != base.value())
+				throw std::runtime_error("The originalUriBaseIds " + base.key().toStdString() + " in " + input +
+					" is not the same as in an earlier run of the same tool");
+		}
+		if (!bases.isEmpty())
+			merged.insert("originalUriBaseIds", bases);
+
+		auto invocations = merged.value("invocations").toArray();
+		for (const auto& invocation : run.value("invocations").toArray())
+			invocations.append(invocation);
+		if (!invocations.isEmpty())
+			merged.insert("invocations", invocations);
+	}
+
+	/**
+	 * \brief Compact JSON for a value of any type
+	 */
+	QByteArray WriteValue(const QJsonValue& value)
+	{
+		if (value.isObject())
+			return QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact);
+		if (value.isArray())
+			return QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact);
+		auto wrapped = QJsonDocument(QJsonObject({ { "value", value } })).toJson(QJsonDocument::Compact);
+		return wrapped.mid(9, wrapped.size() - 10); // Strip {"value": and }
+	}
+}
+
+/**
+ * \brief Buffered output, handed to the device in chunks so that it flows while the input is still arriving
+ */
+class SARIFStreamFilter::Writer {
+public:
+	explicit Writer(QIODevice& device) : _device(device) {}
+
+	void Put(char c)
+	{
+		_buffer.append(c);
+		if (_buffer.size() >= ChunkSize)
+			Flush();
+	}
+
+	void Write(const QByteArray& bytes)
+	{
+		_buffer.append(bytes);
+		if (_buffer.size() >= ChunkSize)
+			Flush();
+	}
+
+	void Flush()
+	{
+		if (_buffer.isEmpty())
+			return;
+		if (_device.write(_buffer) != _buffer.size())
+			throw std::runtime_error("Could not write the output");
+		_buffer.clear();
+	}
+
+private:
+	QIODevice& _device;
+	QByteArray _buffer;
+};
+
+/**
+ * \brief Buffered, forward-only JSON reading, which waits for more data when the buffer runs dry
+ *
+ * Values are never parsed here: they are either copied to a Writer, captured for parsing by the caller, or
+ * skipped, one character at a time.
+ */
+class SARIFStreamFilter::Reader {
+public:
+	explicit Reader(QIODevice& device) : _device(device) {}
+
+	char Peek()
+	{
+		if (_position >= _buffer.size() && !Fill())
+			throw std::runtime_error("Unexpected end of SARIF input");
+		return _buffer[_position];
+	}
+
+	char Get()
+	{
+		char c = Peek();
+		++_position;
+		return c;
+	}
+
+	bool AtEnd()
+	{
+		while (true) {
+			if (_position >= _buffer.size() && !Fill())
+				return true;
+			char c = _buffer[_position];
+			if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+				return false;
+			++_position;
+		}
+	}
+
+	void SkipWhitespace()
+	{
+		while (true) {
+			char c = Peek();
+			if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+				return;
+			++_position;
+		}
+	}
+
+	void Expect(char expected)
+	{
+		SkipWhitespace();
+		if (Get() != expected)
+			throw std::runtime_error(std::string("Malformed SARIF input: expected '") + expected + "'");
+	}
+
+	/**
+	 * \brief Read a string, returning its contents with any escape sequences left as they are
+	 */
+	std::string ReadString()
+	{
+		Expect('"');
+		std::string contents;
+		while (true) {
+			char c = Get();
+			if (c == '"')
+				return contents;
+			contents += c;
+			if (c == '\\')
+				contents += Get();
+		}
+	}
+
+	/**
+	 * \brief Move one complete value to \a out and/or \a capture. If both are null the value is skipped.
+	 */
+	void Transfer(Writer* out, QByteArray* capture)
+	{
+		auto put = [out, capture](char c) {
+			if (out)
+				out->Put(c);
+			if (capture)
+				capture->append(c);
+		};
+		auto transferString = [&]() {
+			put(Get()); // Opening quote
+			while (true) {
+				char c = Get();
+				put(c);
+				if (c == '\\')
+					put(Get());
+				else if (c == '"')
+					return;
+			}
+		};
+
+		SkipWhitespace();
+		char c = Peek();
+		if (c == '"') {
+			transferString();
+		}
+		else if (c == '{' || c == '[') {
+			int depth = 0;
+			do {
+				if (Peek() == '"') {
+					transferString();
+					continue;
+				}
+				c = Get();
+				put(c);
+				if (c == '{' || c == '[')
+					++depth;
+				else if (c == '}' || c == ']')
+					--depth;
+			} while (depth > 0);
+		}
+		else {
+			// A number, true, false or null
+			while (true) {
+				c = Peek();
+				if (c == ',' || c == '}' || c == ']' || c == ' ' || c == '\t' || c == '\n' || c == '\r')
+					return;
+				put(Get());
+			}
+		}
+	}
+
+	/**
+	 * \brief Read an object, calling \a member with each key. \a member must consume the value.
+	 */
+	void ForEachMember(const std::function<void(const std::string&)>& member)
+	{
+		Expect('{');
+		SkipWhitespace();
+		if (Peek() == '}') {
+			Get();
+			return;
+		}
+		while (true) {
+			auto key = ReadString();
+			Expect(':');
+			SkipWhitespace();
+			member(key);
+			SkipWhitespace();
+			char c = Get();
+			if (c == '}')
+				return;
+			if (c != ',')
+				throw std::runtime_error("Malformed SARIF input: expected ',' or '}'");
+		}
+	}
+
+	/**
+	 * \brief Read an array, calling \a element for each entry. \a element must consume the entry.
+	 */
+	void ForEachElement(const std::function<void()>& element)
+	{
+		Expect('[');
+		SkipWhitespace();
+		if (Peek() == ']') {
+			Get();
+			return;
+		}
+		while (true) {
+			SkipWhitespace();
+			element();
+			SkipWhitespace();
+			char c = Get();
+			if (c == ']')
+				return;
+			if (c != ',')
+				throw std::runtime_error("Malformed SARIF input: expected ',' or ']'");
+		}
+	}
+
+private:
+	bool Fill()
+	{
+		_buffer = _device.read(ChunkSize);
+		_position = 0;
+		while (_buffer.isEmpty()) {
+			// Pipes and sockets may simply not have delivered the next chunk yet
+			if (!_device.isSequential() || !_device.waitForReadyRead(-1))
+				return false;
+			_buffer = _device.read(ChunkSize);
+		}
+		return true;
+	}
+
+	QIODevice& _device;
+	QByteArray _buffer;
+	int _position = 0;
+};
+
+SARIFStreamFilter::SARIFStreamFilter(const SARIF::FilterProfile& profile) :
+	_profile(profile)
+{
+	if (!SARIFStreamFilter::CanStream(profile))
+		throw std::runtime_error("Rule pruning, base replacement and expression filters need the whole file, so cannot be applied to a stream");
+	if (!_profile.compiledLocationFilters || _profile.compiledLocationFilters->size() != _profile.locationFilters.size())
+		_profile.Compile();
+	_projection = SARIF::BuildProjection(_profile.projectionPaths);
+}
+
+bool SARIFStreamFilter::CanStream(const SARIF::FilterProfile& profile)
+{
+	return !profile.pruneRules && !profile.overrideBase && profile.expressionFilters.empty();
+}
+
+SARIF::ExportStatistics SARIFStreamFilter::Filter(QIODevice& input, QIODevice& output,
+	std::function<bool(void)> interruptionRequested) const
+{
+	SARIF::ExportStatistics statistics;
+	FingerprintSet seen;
+	Reader in(input);
+	Writer out(output);
+	bool isSARIF = false;
+	bool firstMember = true;
+
+	out.Put('{');
+	in.ForEachMember([&](const std::string& key) {
+		if (!firstMember)
+			out.Put(',');
+		firstMember = false;
+		out.Write("\n  \"" + QByteArray::fromStdString(key) + "\": ");
+		if (key == "$schema") {
+			QByteArray schema;
+			in.Transfer(&out, &schema);
+			isSARIF = schema.contains("sarif");
+		}
+		else if (key == "runs" && in.Peek() == '[') {
+			bool firstRun = true;
+			out.Put('[');
+			in.ForEachElement([&]() {
+				if (!firstRun)
+					out.Put(',');
+				firstRun = false;
+				if (in.Peek() == '{')
+					FilterRun(in, out, statistics, seen, interruptionRequested);
+				else
+					in.Transfer(&out, nullptr);
+			});
+			out.Put(']');
+		}
+		else {
+			in.Transfer(&out, nullptr);
+		}
+	});
+	out.Write("\n}\n");
+	out.Flush();
+
+	if (!in.AtEnd())
+		throw std::runtime_error("Unexpected data after the end of the SARIF input");
+	if (!isSARIF)
+		throw std::runtime_error("Input read, but no SARIF $schema found");
+	return statistics;
+}
+
+FingerprintSet SARIFStreamFilter::Fingerprints(QIODevice& input, std::function<bool(void)> interruptionRequested)
+{
+	FingerprintSet fingerprints;
+	Reader in(input);
+	bool isSARIF = false;
+
+	in.ForEachMember([&](const std::string& key) {
+		if (key == "$schema") {
+			QByteArray schema;
+			in.Transfer(nullptr, &schema);
+			isSARIF = schema.contains("sarif");
+		}
+		else if (key == "runs" && in.Peek() == '[') {
+			in.ForEachElement([&]() {
+				if (in.Peek() != '{') {
+					in.Transfer(nullptr, nullptr);
+					return;
+				}
+				in.ForEachMember([&](const std::string& runKey) {
+					if (runKey != "results" || in.Peek() != '[') {
+						in.Transfer(nullptr, nullptr);
+						return;
+					}
+					in.ForEachElement([&]() {
+						if (interruptionRequested())
+							throw std::runtime_error("Reading the baseline was cancelled");
+						QByteArray raw;
+						in.Transfer(nullptr, &raw);
+						auto document = QJsonDocument::fromJson(raw);
+						if (document.isObject())
+							fingerprints.Insert(SARIF::GetFingerprint(document.object()));
+					});
+				});
+			});
+		}
+		else {
+			in.Transfer(nullptr, nullptr);
+		}
+	});
+
+	if (!in.AtEnd())
+		throw std::runtime_error("Unexpected data after the end of the SARIF input");
+	if (!isSARIF)
+		throw std::runtime_error("Input read, but no SARIF $schema found");
+	return fingerprints;
+}
+
+SARIF::ExportStatistics SARIFStreamFilter::Merge(const std::vector<std::string>& inputs, QIODevice& output,
+	std::function<bool(void)> interruptionRequested) const
+{
+	auto open = [](const std::string& file, QFile& device) {
+		device.setFileName(QString::fromStdString(file));
+		if (!device.open(QIODevice::ReadOnly))
+			throw std::runtime_error("Failed to open " + file);
+	};
+
+	// Everything in an input except its results
+	struct RunHeader {
+		bool isObject = false;
+		std::string tool;
+		QJsonObject members;
+	};
+	struct InputHeader {
+		QByteArray version;
+		QByteArray schema;
+		std::vector<RunHeader> runs;
+	};
+
+	// The first pass skips over the results, so it only holds the small part of each input
+	std::vector<InputHeader> headers(inputs.size());
+	SARIF::ParallelFor(inputs.size(), [&](size_t input) {
+		QFile device;
+		open(inputs[input], device);
+		Reader in(device);
+		auto& header = headers[input];
+		in.ForEachMember([&](const std::string& key) {
+			if (key == "version") {
+				in.Transfer(nullptr, &header.version);
+			}
+			else if (key == "$schema") {
+				in.Transfer(nullptr, &header.schema);
+			}
+			else if (key == "runs" && in.Peek() == '[') {
+				in.ForEachElement([&]() {
+					RunHeader run;
+					run.isObject = in.Peek() == '{';
+					if (!run.isObject) {
+						in.Transfer(nullptr, nullptr);
+						header.runs.push_back(std::move(run));
+						return;
+					}
+					in.ForEachMember([&](const std::string& runKey) {
+						if (interruptionRequested())
+							throw std::runtime_error("Merge was cancelled");
+						QByteArray raw;
+						in.Transfer(nullptr, runKey == "results" ? nullptr : &raw);
+						if (!raw.isEmpty())
+							run.members.insert(QString::fromStdString(runKey), ParseValue(raw));
+					});
+					run.tool = run.members.value("tool").toObject().value("driver").toObject().value("name").toString().toStdString();
+					header.runs.push_back(std::move(run));
+				});
+			}
+			else {
+				in.Transfer(nullptr, nullptr);
+			}
+		});
+		if (!in.AtEnd())
+			throw std::runtime_error("Unexpected data after the end of " + inputs[input]);
+		if (!header.schema.contains("sarif"))
+			throw std::runtime_error("No SARIF $schema found in " + inputs[input]);
+	});
+
+	// Runs of the same tool become one, in the order in which the tools first appear
+	struct MergedPart {
+		size_t input = 0;
+		size_t run = 0;                   ///< The position of the run in the input's runs
+		std::vector<int> ruleIndex;       ///< The position in the merged rules of each of the run's rules
+		std::vector<int> artifactIndex;   ///< The position in the merged artifacts of each of the run's artifacts
+		bool renumberArtifacts = false;   ///< Whether any artifact has moved
+	};
+	struct MergedRun {
+		QJsonObject members;                          ///< Those of the first run of the tool, with the others' merged in
+		QJsonArray rules;
+		std::map<std::string, int> ruleIndex;         ///< The position in \a rules of each rule id
+		QJsonArray artifacts;
+		std::map<std::string, int> artifactIndex;     ///< The position in \a artifacts of each artifact location
+		std::vector<MergedPart> parts;
+	};
+	std::vector<MergedRun> merged;
+	std::map<std::string, size_t> mergedByTool;
+	for (size_t input = 0; input < headers.size(); ++input) {
+		for (size_t run = 0; run < headers[input].runs.size(); ++run) {
+			const auto& header = headers[input].runs[run];
+			if (!header.isObject)
+				continue;
+			auto found = mergedByTool.emplace(header.tool, merged.size());
+			if (found.second) {
+				merged.emplace_back();
+				merged.back().members = header.members;
+				merged.back().members.remove("artifacts");
+			}
+			else {
+				MergeRunMembers(merged[found.first->second].members, header.members, inputs[input]);
+			}
+			auto& target = merged[found.first->second];
+			MergedPart part;
+			part.input = input;
+			part.run = run;
+			for (const auto& rule : header.members.value("tool").toObject().value("driver").toObject().value("rules").toArray()) {
+				auto id = rule.toObject().value("id").toString().toStdString();
+				auto existing = id.empty() ? target.ruleIndex.end() : target.ruleIndex.find(id);
+				if (existing != target.ruleIndex.end()) {
+					part.ruleIndex.push_back(existing->second);
+					continue;
+				}
+				if (!id.empty())
+					target.ruleIndex[id] = target.rules.size();
+				part.ruleIndex.push_back(target.rules.size());
+				target.rules.append(rule);
+			}
+
+			// Artifacts are the same if they have the same location. The new ones can refer to others by index.
+			const auto artifacts = header.members.value("artifacts").toArray();
+			std::vector<int> added;
+			for (int artifact = 0; artifact < artifacts.size(); ++artifact) {
+				auto location = artifacts[artifact].toObject().value("location").toObject();
+				auto uri = location.value("uri").toString();
+				auto key = uri.isEmpty() ? std::string() : (location.value("uriBaseId").toString() + "|" + uri).toStdString();
+				auto existing = key.empty() ? target.artifactIndex.end() : target.artifactIndex.find(key);
+				if (existing != target.artifactIndex.end()) {
+					part.artifactIndex.push_back(existing->second);
+					continue;
+				}
+				if (!key.empty())
+					target.artifactIndex[key] = target.artifacts.size();
+				part.artifactIndex.push_back(target.artifacts.size());
+				target.artifacts.append(QJsonValue());
+				added.push_back(artifact);
+			}
+			for (int artifact = 0; artifact < static_cast<int>(part.artifactIndex.size()); ++artifact)
+				part.renumberArtifacts = part.renumberArtifacts || part.artifactIndex[artifact] != artifact;
+			for (auto artifact : added) {
+				auto artifactObject = artifacts[artifact].toObject();
+				const int parent = artifactObject.value("parentIndex").toInt(-1);
+				if (parent >= 0 && parent < artifacts.size())
+					artifactObject.insert("parentIndex", part.artifactIndex[parent]);
+				auto location = artifactObject.value("location").toObject();
+				const int index = location.value("index").toInt(-1);
+				if (index >= 0 && index < artifacts.size()) {
+					location.insert("index", part.artifactIndex[index]);
+					artifactObject.insert("location", location);
+				}
+				QJsonValue renumbered(artifactObject);
+				if (part.renumberArtifacts)
+					RenumberArtifacts(renumbered, part.artifactIndex);
+				target.artifacts.replace(part.artifactIndex[artifact], renumbered);
+			}
+			target.parts.push_back(std::move(part));
+		}
+	}
+	const QByteArray version = headers.empty() || headers.front().version.isEmpty() ? QByteArray("\"2.1.0\"") : headers.front().version;
+	const QByteArray schema = headers.empty() ? QByteArray("\"https://json.schemastore.org/sarif-2.1.0.json\"") : headers.front().schema;
+	headers.clear();
+
+	// The second pass reads the results of one merged part, filtered and renumbered, ready to write
+	struct ResultBytes {
+		QByteArray bytes;
+		uint64_t fingerprint = 0;
+		std::string rule;
+	};
+	struct PartResults {
+		std::vector<ResultBytes> results;
+		SARIF::ExportStatistics statistics;
+	};
+	const bool project = _profile.projectionMode != SARIF::ProjectionMode::None && !_profile.projectionPaths.empty();
+	auto readPart = [&](const MergedPart& part, PartResults& partResults) {
+		const auto& newIndex = part.ruleIndex;
+		QFile device;
+		open(inputs[part.input], device);
+		Reader in(device);
+		in.ForEachMember([&](const std::string& key) {
+			if (key != "runs" || in.Peek() != '[') {
+				in.Transfer(nullptr, nullptr);
+				return;
+			}
+			size_t run = 0;
+			in.ForEachElement([&]() {
+				if (run++ != part.run || in.Peek() != '{') {
+					in.Transfer(nullptr, nullptr);
+					return;
+				}
+				in.ForEachMember([&](const std::string& runKey) {
+					if (runKey != "results" || in.Peek() != '[') {
+						in.Transfer(nullptr, nullptr);
+						return;
+					}
+					in.ForEachElement([&]() {
+						if (interruptionRequested())
+							throw std::runtime_error("Merge was cancelled");
+						ResultBytes result;
+						in.Transfer(nullptr, &result.bytes);
+						++partResults.statistics.resultsRead;
+						auto document = QJsonDocument::fromJson(result.bytes);
+						if (document.isObject()) {
+							auto resultObject = document.object();
+							if (!Keep(resultObject))
+								return;
+							if (_profile.baseline || _profile.deduplicate) {
+								result.fingerprint = SARIF::GetFingerprint(resultObject);
+								if (_profile.baseline && _profile.baseline->Contains(result.fingerprint)) {
+									++partResults.statistics.unchanged;
+									return;
+								}
+								result.rule = SARIF::GetRule(resultObject);
+							}
+
+							int index = -1;
+							if (resultObject.value("ruleIndex").isDouble())
+								index = resultObject.value("ruleIndex").toInt();
+							else if (resultObject.value("rule").toObject().contains("index"))
+								index = resultObject.value("rule").toObject().value("index").toInt();
+							const bool renumber = index >= 0 && index < static_cast<int>(newIndex.size()) && newIndex[index] != index;
+							if (renumber) {
+								if (resultObject.contains("ruleIndex"))
+									resultObject.insert("ruleIndex", newIndex[index]);
+								if (resultObject.value("rule").toObject().contains("index")) {
+									auto ruleReference = resultObject.value("rule").toObject();
+									ruleReference.insert("index", newIndex[index]);
+									resultObject.insert("rule", ruleReference);
+								}
+							}
+							bool changed = renumber;
+							if (part.renumberArtifacts) {
+								QJsonValue value(resultObject);
+								if (RenumberArtifacts(value, part.artifactIndex)) {
+									resultObject = value.toObject();
+									changed = true;
+								}
+							}
+							if (project) {
+								auto projected = SARIF::Project(resultObject, _projection, _profile.projectionMode, "", partResults.statistics.projectedBytes);
+								result.bytes = QJsonDocument(projected.toObject()).toJson(QJsonDocument::Compact);
+							}
+							else if (changed) {
+								result.bytes = QJsonDocument(resultObject).toJson(QJsonDocument::Compact);
+							}
+						}
+						partResults.results.push_back(std::move(result));
+					});
+				});
+			});
+		});
+	};
+
+	SARIF::ExportStatistics statistics;
+	Writer out(output);
+	out.Write("{\n  \"version\": " + version + ",\n  \"$schema\": " + schema + ",\n  \"runs\": [");
+	const size_t window = std::max(1u, std::thread::hardware_concurrency());
+	for (size_t m = 0; m < merged.size(); ++m) {
+		auto& run = merged[m];
+		if (m > 0)
+			out.Put(',');
+		out.Write("{\n    ");
+		auto tool = run.members.value("tool").toObject();
+		if (!run.rules.isEmpty()) {
+			auto driver = tool.value("driver").toObject();
+			driver.insert("rules", run.rules);
+			tool.insert("driver", driver);
+		}
+		out.Write("\"tool\": " + WriteValue(tool));
+		if (!run.artifacts.isEmpty())
+			run.members.insert("artifacts", run.artifacts);
+		for (auto member = run.members.constBegin(); member != run.members.constEnd(); ++member) {
+			if (member.key() != "tool")
+				out.Write(",\n    \"" + member.key().toUtf8() + "\": " + WriteValue(member.value()));
+		}
+		out.Write(",\n    \"results\": [");
+
+		// Parts are read a window at a time, in parallel, and written in order
+		FingerprintSet seen;
+		bool firstResult = true;
+		for (size_t first = 0; first < run.parts.size(); first += window) {
+			std::vector<PartResults> parts(std::min(window, run.parts.size() - first));
+			SARIF::ParallelFor(parts.size(), [&](size_t part) {
+				readPart(run.parts[first + part], parts[part]);
+			});
+			for (auto& part : parts) {
+				statistics.resultsRead += part.statistics.resultsRead;
+				statistics.unchanged += part.statistics.unchanged;
+				for (const auto& field : part.statistics.projectedBytes)
+					statistics.projectedBytes[field.first] += field.second;
+				for (const auto& result : part.results) {
+					if (_profile.deduplicate && result.fingerprint != 0 && !seen.Insert(result.fingerprint)) {
+						++statistics.duplicates[result.rule];
+						continue;
+					}
+					if (!firstResult)
+						out.Put(',');
+					firstResult = false;
+					out.Write("\n      ");
+					out.Write(result.bytes);
+					++statistics.resultsWritten;
+				}
+			}
+		}
+		out.Write("\n    ]\n  }");
+	}
+	out.Write("]\n}\n");
+	out.Flush();
+	return statistics;
+}
+
+void SARIFStreamFilter::FilterRun(Reader& in, Writer& out, SARIF::ExportStatistics& statistics, FingerprintSet& seen,
+	const std::function<bool(void)>& interruptionRequested) const
+{
+	bool firstMember = true;
+	out.Write("{\n    ");
+	in.ForEachMember([&](const std::string& key) {
+		if (key == "artifacts") {
+			// For now, strip out all of the artifacts
+			in.Transfer(nullptr, nullptr);
+			return;
+		}
+		if (!firstMember)
+			out.Write(",\n    ");
+		firstMember = false;
+		out.Write("\"" + QByteArray::fromStdString(key) + "\": ");
+		if (key == "results" && in.Peek() == '[')
+			FilterResults(in, out, statistics, seen, interruptionRequested);
+		else
+			in.Transfer(&out, nullptr);
+	});
+	out.Write("\n  }");
+}
+
+void SARIFStreamFilter::FilterResults(Reader& in, Writer& out, SARIF::ExportStatistics& statistics, FingerprintSet& seen,
+	const std::function<bool(void)>& interruptionRequested) const
+{
+	const bool project = _profile.projectionMode != SARIF::ProjectionMode::None && !_profile.projectionPaths.empty();
+	bool firstResult = true;
+	out.Put('[');
+	in.ForEachElement([&]() {
+		if (interruptionRequested())
+			throw std::runtime_error("Export was cancelled");
+
+		QByteArray raw;
+		in.Transfer(nullptr, &raw);
+		++statistics.resultsRead;
+		auto document = QJsonDocument::fromJson(raw);
+		if (document.isObject() && !Keep(document.object()))
+			return;
+		// The baseline and duplicates are checked against the results that survived the other filters, as in
+		// SARIF::KeptResults()
+		if (document.isObject() && (_profile.baseline || _profile.deduplicate)) {
+			const auto fingerprint = SARIF::GetFingerprint(document.object());
+			if (_profile.baseline && _profile.baseline->Contains(fingerprint)) {
+				++statistics.unchanged;
+				return;
+			}
+			if (_profile.deduplicate && !seen.Insert(fingerprint)) {
+				++statistics.duplicates[SARIF::GetRule(document.object())];
+				return;
+			}
+		}
+
+		if (!firstResult)
+			out.Put(',');
+		firstResult = false;
+		out.Write("\n      ");
+		if (document.isObject() && project) {
+			auto projected = SARIF::Project(document.object(), _projection, _profile.projectionMode, "", statistics.projectedBytes);
+			out.Write(QJsonDocument(projected.toObject()).toJson(QJsonDocument::Compact));
+		}
+		else {
+			out.Write(raw);
+		}
+		++statistics.resultsWritten;
+	});
+	out.Write("\n    ]");
+}
+
+bool SARIFStreamFilter::Keep(const QJsonObject& result) const
+{
+	if (_profile.minimumLevel != SARIF::Level::None && SARIF::GetLevel(result) < _profile.minimumLevel)
+		return false;
+	if (_profile.minimumRank > 0 && SARIF::GetRank(result) < SARIF::RankThreshold(_profile.minimumRank))
+		return false;
+	if (_profile.lineRanges && !_profile.lineRanges->Overlaps(SARIF::GetArtifactUri(result), SARIF::GetLine(result), SARIF::GetEndLine(result)))
+		return false;
+	auto rule = SARIF::GetRule(result);
+	if (std::find(_profile.suppressedRules.begin(), _profile.suppressedRules.end(), rule) != _profile.suppressedRules.end())
+		return false;
+	if (!_profile.locationFilters.empty()) {
+		auto uri = SARIF::GetArtifactUri(result);
+		for (const auto& regex : *_profile.compiledLocationFilters) {
+			if (std::regex_search(uri, regex))
+				return false;
+		}
+	}
+	return true;
+}
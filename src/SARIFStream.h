@@ -0,0 +1,119 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CLEANSARIF_SARIFSTREAM_H_
+#define _CLEANSARIF_SARIFSTREAM_H_
+
+#include "SARIF.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class QIODevice;
+
+/**
+ * \brief Filters SARIF data as it arrives, without ever holding the whole file in memory
+ *
+ * The input is copied to the output byte for byte, except that the "artifacts" of each run are removed and
+ * each entry in a run's "results" is parsed on its own, filtered, projected and written out immediately.
+ * Memory use is therefore bounded by the largest single result, and output starts as soon as input does,
+ * so this can sit in the middle of a pipe.
+ *
+ * Unlike SARIF::Export(), the order of the input's keys is kept (SARIF producers write "version" first
+ * anyway). Some filters need to see every result before writing anything, so cannot be streamed: see
+ * CanStream().
+ */
+class SARIFStreamFilter
+{
+public:
+
+	/**
+	 * \brief Prepare to filter with \a profile
+	 * \throws std::runtime_error if the profile cannot be applied to a stream
+	 */
+	explicit SARIFStreamFilter(const SARIF::FilterProfile& profile);
+
+	/**
+	 * \brief Whether \a profile can be applied to a stream
+	 *
+	 * Rule pruning needs to know which rules are used before the rules are written, and replacing the base
+	 * needs the common prefix of every result's URI, so neither can be done in a single forward pass. Expression
+	 * filters are evaluated against the load-time index, and can refer to the tags of rule descriptors that may
+	 * come after the results.
+	 */
+	static bool CanStream(const SARIF::FilterProfile& profile);
+
+	/**
+	 * \brief Read SARIF data from \a input until it ends, writing the filtered data to \a output as it goes
+	 * \throws std::runtime_error if the input is not SARIF, or on a read or write error. Some output may
+	 * already have been written.
+	 */
+	SARIF::ExportStatistics Filter(QIODevice& input, QIODevice& output,
+		std::function<bool(void)> interruptionRequested = []() {return false; }) const;
+
+	/**
+	 * \brief Read the fingerprint of every result in the SARIF data in \a input, e.g. to use as a baseline
+	 *
+	 * Only one result is parsed at a time, so a large baseline report costs the memory of its fingerprints alone.
+	 * \throws std::runtime_error if the input is not SARIF, or on a read error
+	 * \see SARIF::FingerprintOf(), SARIF::FilterProfile::baseline
+	 */
+	static FingerprintSet Fingerprints(QIODevice& input,
+		std::function<bool(void)> interruptionRequested = []() {return false; });
+
+	/**
+	 * \brief Merge the SARIF files \a inputs into one report written to \a output, filtering each result as Filter()
+	 * does
+	 *
+	 * The runs of every input are combined by tool: all of the runs whose \a tool.driver.name is the same become one
+	 * run, whose rules are the union of their rules by \a id, and each result's rule index is renumbered to match.
+	 * Likewise the artifacts are the union of their artifacts by location, and each \a artifactLocation.index is
+	 * renumbered to match. The \a invocations of the runs are concatenated and their \a originalUriBaseIds are
+	 * combined; any other member of a merged run is that of the first run of that tool. If the profile deduplicates,
+	 * a result is written once per tool however many inputs contain it.
+	 *
+	 * Each input is read twice, several at a time: first for its tools and rules, then for its results. The results
+	 * are written in the order of \a inputs, and only those of as many inputs as there are cores are held in memory
+	 * at once.
+	 * \throws std::runtime_error if an input cannot be read or is not SARIF, if two runs of a tool give the same
+	 * \a originalUriBaseIds different values, or on a write error. Some output may already have been written.
+	 */
+	SARIF::ExportStatistics Merge(const std::vector<std::string>& inputs, QIODevice& output,
+		std::function<bool(void)> interruptionRequested = []() {return false; }) const;
+
+private:
+
+	class Reader;
+	class Writer;
+
+	void FilterRun(Reader& in, Writer& out, SARIF::ExportStatistics& statistics, FingerprintSet& seen,
+		const std::function<bool(void)>& interruptionRequested) const;
+	void FilterResults(Reader& in, Writer& out, SARIF::ExportStatistics& statistics, FingerprintSet& seen,
+		const std::function<bool(void)>& interruptionRequested) const;
+	bool Keep(const QJsonObject& result) const;
+
+	SARIF::FilterProfile _profile;
+	SARIF::ProjectionNode _projection;
+};
+
+#endif // _CLEANSARIF_SARIFSTREAM_H_
@@ -0,0 +1,132 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(unsigned int threads)
+{
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned int worker = 0; worker < threads; ++worker)
+		_queues.push_back(std::make_unique<Queue>());
+	for (unsigned int worker = 0; worker < threads; ++worker)
+		_threads.emplace_back(&WorkStealingPool::Work, this, worker);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_allDone.wait(lock, [this]() { return _unfinished == 0; });
+		_stopping = true;
+	}
+	_taskAvailable.notify_all();
+	for (auto& thread : _threads)
+		thread.join();
+}
+
+void WorkStealingPool::Submit(std::function<void()> task)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto& queue = *_queues[_nextQueue];
+	_nextQueue = (_nextQueue + 1) % _queues.size();
+	{
+		std::lock_guard<std::mutex> queueLock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+	++_queued;
+	++_unfinished;
+	_taskAvailable.notify_one();
+}
+
+void WorkStealingPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_allDone.wait(lock, [this]() { return _unfinished == 0; });
+	if (_firstError) {
+		auto error = _firstError;
+		_firstError = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+size_t WorkStealingPool::Size() const
+{
+	return _threads.size();
+}
+
+bool WorkStealingPool::Take(size_t worker, std::function<void()>& task)
+{
+	// Newest first from our own queue, to keep its data warm in this core's cache...
+	{
+		auto& own = *_queues[worker];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty()) {
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			--_queued;
+			return true;
+		}
+	}
+	// ...then oldest first from everyone else's
+	for (size_t offset = 1; offset < _queues.size(); ++offset) {
+		auto& victim = *_queues[(worker + offset) % _queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			--_queued;
+			return true;
+		}
+	}
+	return false;
+}
+
+void WorkStealingPool::Work(size_t worker)
+{
+	while (true) {
+		std::function<void()> task;
+		if (!Take(worker, task)) {
+			std::unique_lock<std::mutex> lock(_mutex);
+			_taskAvailable.wait(lock, [this]() { return _stopping || _queued > 0; });
+			if (_stopping && _queued == 0)
+				return;
+			continue;
+		}
+
+		std::exception_ptr error;
+		try {
+			task();
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (error && !_firstError)
+			_firstError = error;
+		if (--_unfinished == 0)
+			_allDone.notify_all();
+	}
+}
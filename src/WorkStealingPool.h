@@ -0,0 +1,100 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef _CLEANSARIF_WORKSTEALINGPOOL_H_
+#define _CLEANSARIF_WORKSTEALINGPOOL_H_
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <exception>
+
+/**
+ * \brief A fixed-size thread pool in which idle workers take tasks from the queues of busy ones
+ *
+ * Each worker has its own queue. Submitted tasks are dealt out to the queues in turn; a worker runs the
+ * newest task from its own queue, and when that is empty it takes the oldest task from another queue.
+ * This keeps every core busy when the tasks vary a lot in size, as SARIF files do.
+ */
+class WorkStealingPool
+{
+public:
+
+	/**
+	 * \brief Start the worker threads
+	 * \param threads The number of workers, or 0 to use one per hardware thread
+	 */
+	explicit WorkStealingPool(unsigned int threads = 0);
+
+	/**
+	 * \brief Finish all submitted tasks and stop the workers
+	 */
+	~WorkStealingPool();
+
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+	/**
+	 * \brief Queue \a task to be run on one of the workers
+	 */
+	void Submit(std::function<void()> task);
+
+	/**
+	 * \brief Block until every submitted task has finished
+	 * \throws The first exception thrown by a task since the last call to Wait()
+	 */
+	void Wait();
+
+	/**
+	 * \brief The number of worker threads
+	 */
+	size_t Size() const;
+
+private:
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	void Work(size_t worker);
+	bool Take(size_t worker, std::function<void()>& task);
+
+	std::vector<std::unique_ptr<Queue>> _queues;
+	std::vector<std::thread> _threads;
+
+	std::mutex _mutex;
+	std::condition_variable _taskAvailable;
+	std::condition_variable _allDone;
+	std::atomic<size_t> _queued{ 0 };
+	size_t _unfinished = 0;
+	size_t _nextQueue = 0;
+	bool _stopping = false;
+	std::exception_ptr _firstError;
+};
+
+#endif // _CLEANSARIF_WORKSTEALINGPOOL_H_
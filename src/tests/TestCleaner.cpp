@@ -25,3 +25,151 @@
 #include "../Cleaner.h"
 #include <QFile>
 #include <QTemporaryFile>
+#include <QDir>
+#include <QJsonObject>
+
+TEST_CASE("Batch cleaning writes every file", "[cleaner]") {
+	QTemporaryFile tempFile;
+	tempFile.open();
+	QString outputDirectory = tempFile.fileName() + "_batch";
+	tempFile.close();
+	QDir().mkpath(outputDirectory);
+
+	SARIF::FilterProfile profile;
+	profile.suppressedRules.push_back("rule1");
+	QStringList infiles{ "SeveralRules.sarif", "RuleIndexes.sarif", "Nonexistent.sarif" };
+	auto summary = Cleaner::CleanBatch(infiles, outputDirectory, profile, 2);
+
+	REQUIRE(summary.files.size() == 3);
+	REQUIRE(summary.failures == 1);
+	REQUIRE(summary.files[0].error.isEmpty());
+	REQUIRE(summary.files[1].error.isEmpty());
+	REQUIRE(!summary.files[2].error.isEmpty());
+	REQUIRE(summary.bytesRead > 0);
+	REQUIRE(summary.files[1].statistics.resultsWritten == 2);
+
+	SARIF cleaned(summary.files[0].outfile.toStdString());
+	REQUIRE(cleaned.GetRules().count("rule1") == 0);
+	QDir(outputDirectory).removeRecursively();
+}
+
+TEST_CASE("Batch cleaning keeps inputs with the same name apart", "[cleaner]") {
+	QTemporaryFile tempFile;
+	tempFile.open();
+	QString root = tempFile.fileName() + "_inputs";
+	QString outputDirectory = tempFile.fileName() + "_batch";
+	tempFile.close();
+	QDir().mkpath(root + "/a");
+	QDir().mkpath(root + "/b");
+	REQUIRE(QFile::copy("SeveralRules.sarif", root + "/a/report.sarif"));
+	REQUIRE(QFile::copy("RuleIndexes.sarif", root + "/b/report.sarif"));
+
+	QStringList infiles{ root + "/a/report.sarif", root + "/b/report.sarif", root + "/b/report.sarif" };
+	auto outfiles = Cleaner::BatchOutputs(infiles, outputDirectory);
+	REQUIRE(outfiles[0] == QDir(outputDirectory).filePath("a/report.sarif"));
+	REQUIRE(outfiles[1] == QDir(outputDirectory).filePath("b/report.sarif"));
+	REQUIRE(outfiles[2] == QDir(outputDirectory).filePath("b/report-2.sarif"));
+	REQUIRE(Cleaner::BatchOutputs({ "SeveralRules.sarif" }, outputDirectory)[0] == QDir(outputDirectory).filePath("SeveralRules.sarif"));
+
+	auto summary = Cleaner::CleanBatch(infiles, outputDirectory, SARIF::FilterProfile(), 2);
+	REQUIRE(summary.failures == 0);
+	REQUIRE(SARIF(outfiles[0].toStdString()).ResultCount() == 3);
+	REQUIRE(SARIF(outfiles[1].toStdString()).GetRules().count("rule3") == 1);
+
+	SARIF::FilterProfile invalid;
+	invalid.locationFilters.push_back("[unclosed");
+	REQUIRE_THROWS(Cleaner::CleanBatch(infiles, outputDirectory, invalid, 2));
+	QDir(root).removeRecursively();
+	QDir(outputDirectory).removeRecursively();
+}
+
+TEST_CASE("Batch cleaning in place keeps the first backup", "[cleaner]") {
+	QTemporaryFile tempFile;
+	tempFile.open();
+	QString root = tempFile.fileName() + "_inplace";
+	tempFile.close();
+	QDir().mkpath(root);
+	QString infile = QDir(root).filePath("report.sarif");
+	REQUIRE(QFile::copy("SeveralRules.sarif", infile));
+	REQUIRE(Cleaner::BatchOutputs({ infile }, root)[0] == infile);
+
+	SARIF::FilterProfile profile;
+	profile.suppressedRules.push_back("rule1");
+	auto first = Cleaner::CleanBatch({ infile }, root, profile, 1);
+	REQUIRE(first.failures == 0);
+	REQUIRE(SARIF((infile + ".backup").toStdString()).ResultCount() == SARIF("SeveralRules.sarif").ResultCount());
+	auto cleaned = SARIF(infile.toStdString()).ResultCount();
+
+	// The second run would back up the already cleaned file over the original
+	profile.suppressedRules.push_back("rule2");
+	auto second = Cleaner::CleanBatch({ infile }, root, profile, 1);
+	REQUIRE(second.failures == 1);
+	REQUIRE(!second.files[0].error.isEmpty());
+	REQUIRE(SARIF(infile.toStdString()).ResultCount() == cleaned);
+	REQUIRE(SARIF((infile + ".backup").toStdString()).ResultCount() == SARIF("SeveralRules.sarif").ResultCount());
+	QDir(root).removeRecursively();
+}
+
+TEST_CASE("Filter files store the threshold", "[cleaner]") {
+	QJsonObject threshold;
+	threshold.insert("level", "warning");
+	threshold.insert("rank", 50);
+	QJsonObject data;
+	data.insert("threshold", threshold);
+	auto profile = Cleaner::FilterProfileFromJson(data);
+	REQUIRE(profile.minimumLevel == SARIF::Level::Warning);
+	REQUIRE(profile.minimumRank == 50);
+	REQUIRE(Cleaner::FilterProfileFromJson(QJsonObject()).minimumLevel == SARIF::Level::None);
+
+	threshold.insert("level", "high");
+	data.insert("threshold", threshold);
+	REQUIRE_THROWS(Cleaner::FilterProfileFromJson(data));
+}
+
+TEST_CASE("Snapshots stay consistent while the Cleaner reloads", "[cleaner]") {
+	// Every snapshot must be one file or the other in its entirety, never a mixture
+	auto signature = [](const SARIF& sarif) {
+		int hits = 0;
+		for (const auto& rule : sarif.GetRules())
+			hits += rule.second;
+		return std::make_pair(sarif.Files().size(), hits);
+	};
+	auto first = signature(SARIF("SmallValidA.sarif"));
+	auto second = signature(SARIF("SeveralRules.sarif"));
+	auto empty = signature(SARIF());
+	REQUIRE(first != second);
+
+	// Writing an output makes the runs read the base and the pruning setting while they are being changed
+	QTemporaryFile tempFile;
+	tempFile.open();
+	QString outfile = tempFile.fileName() + "_snapshot.sarif";
+	tempFile.close();
+
+	Cleaner cleaner;
+	cleaner.SetIncrementalReload(true);
+	bool consistent = true;
+	for (int run = 0; run < 20; ++run) {
+		cleaner.SetInfile(run % 2 == 0 ? "SmallValidA.sarif" : "SeveralRules.sarif");
+		cleaner.SetOutfile(run % 4 < 2 ? outfile : QString());
+		cleaner.start();
+		do {
+			auto current = signature(*cleaner.Snapshot());
+			if (current != first && current != second && current != empty)
+				consistent = false;
+			cleaner.SuppressRule("rule1");
+			cleaner.AddLocationFilter("/Gui/");
+			cleaner.SetBase("/base/");
+			cleaner.SetPruneRules(true);
+			cleaner.UnsuppressRule("rule1");
+			cleaner.RemoveLocationFilter("/Gui/");
+			cleaner.SetBase("/other/base/");
+			cleaner.SetPruneRules(false);
+		} while (!cleaner.wait(0));
+	}
+	QFile::remove(outfile);
+	REQUIRE(consistent);
+	REQUIRE(cleaner.GetFilterProfile().base == "/other/base/");
+	REQUIRE_FALSE(cleaner.GetFilterProfile().pruneRules);
+	REQUIRE(signature(*cleaner.Snapshot()) == second);
+	REQUIRE(cleaner.SuppressedRules().isEmpty());
+}
@@ -0,0 +1,116 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../FilterCoverage.h"
+#include "../SARIF.h"
+
+#include <set>
+
+TEST_CASE("Result bitmaps behave as sets", "[coverage]") {
+	ResultBitmap sparse;
+	ResultBitmap dense;
+	std::set<uint32_t> expected;
+	for (uint32_t id = 0; id < 200000; id += 37) {
+		sparse.Add(id);
+		expected.insert(id);
+	}
+	// More than 4096 ids in one chunk switch it to a bitmap
+	for (uint32_t id = 70000; id < 80000; ++id)
+		dense.Add(id);
+	sparse.Add(37); // Already there
+	sparse.Add(5);  // Out of order
+	expected.insert(5);
+
+	REQUIRE(sparse.Count() == expected.size());
+	REQUIRE(dense.Count() == 10000);
+	REQUIRE(sparse.Contains(5));
+	REQUIRE(!sparse.Contains(6));
+	REQUIRE(dense.Contains(75000));
+
+	std::vector<uint32_t> visited;
+	sparse.ForEach([&visited](uint32_t id) { visited.push_back(id); });
+	REQUIRE(visited == std::vector<uint32_t>(expected.begin(), expected.end()));
+
+	size_t overlap = 0;
+	for (auto id : expected)
+		overlap += (id >= 70000 && id < 80000) ? 1 : 0;
+	REQUIRE(sparse.CountAnd(dense) == overlap);
+	REQUIRE(dense.CountAnd(sparse) == overlap);
+
+	auto both = sparse;
+	both |= dense;
+	REQUIRE(both.Count() == expected.size() + 10000 - overlap);
+	auto reversed = dense;
+	reversed |= sparse;
+	REQUIRE(both == reversed);
+}
+
+TEST_CASE("Coverage counts follow filters as they change", "[coverage]") {
+	auto range = [](uint32_t first, uint32_t last) {
+		ResultBitmap bitmap;
+		for (auto id = first; id < last; ++id)
+			bitmap.Add(id);
+		return bitmap;
+	};
+
+	FilterCoverage coverage(100);
+	auto a = coverage.Add(range(0, 30));
+	auto b = coverage.Add(range(20, 50));
+	REQUIRE(coverage.Removed() == 50);
+	REQUIRE(coverage.Remaining() == 50);
+	REQUIRE(coverage.Matches(a) == 30);
+	REQUIRE(coverage.Marginal(a) == 20);
+	REQUIRE(coverage.Marginal(b) == 20);
+
+	auto c = coverage.Add(range(25, 26));
+	REQUIRE(coverage.Marginal(c) == 0);
+	REQUIRE(coverage.Removed() == 50);
+
+	coverage.Remove(a);
+	REQUIRE(coverage.Removed() == 30);
+	REQUIRE(coverage.Marginal(b) == 29);
+	REQUIRE(coverage.Marginal(a) == 0);
+	REQUIRE(!coverage.IsRemoved(0));
+	REQUIRE(coverage.IsRemoved(25));
+	REQUIRE(coverage.Union() == range(20, 50));
+
+	coverage.Remove(a); // Already gone
+	REQUIRE(coverage.Removed() == 30);
+	REQUIRE_THROWS(coverage.Add(range(90, 110)));
+	REQUIRE(coverage.Removed() == 30);
+}
+
+TEST_CASE("Report coverage agrees with the exported count", "[coverage]") {
+	SARIF sarif("SeveralRules.sarif");
+	SARIF::FilterProfile profile;
+	profile.suppressedRules.push_back("rule2");
+	profile.locationFilters.push_back("Application");
+	auto coverage = sarif.Coverage(profile);
+	REQUIRE(coverage.Remaining() == sarif.CountResults(profile));
+	REQUIRE(coverage.Matches(0) == 1);
+	REQUIRE(coverage.Matches(1) == 3);
+	REQUIRE(coverage.Marginal(1) == 2);
+	REQUIRE(sarif.RuleMatches("rule1").Count() == 2);
+	REQUIRE(sarif.RuleMatches("nonexistent").IsEmpty());
+}
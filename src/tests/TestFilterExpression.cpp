@@ -0,0 +1,163 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../FilterExpression.h"
+
+#include <vector>
+#include <string>
+
+namespace {
+	// Three rules, three files, and every combination of level and line in 0..49
+	struct Report {
+		std::vector<std::string> rules = { "V008", "V501", "V1028" };
+		std::vector<std::vector<std::string>> tags = { {}, { "security" }, { "security", "external/cwe/cwe-190" } };
+		std::vector<std::string> uris = { "/src/Mod/Draft/a.cpp", "/src/App/b.cpp", "/src/tests/c.h" };
+		std::vector<uint32_t> rule, uri, line;
+		std::vector<uint8_t> level;
+
+		Report()
+		{
+			for (uint32_t r = 0; r < 3; ++r)
+				for (uint32_t u = 0; u < 3; ++u)
+					for (uint8_t l = 0; l < 4; ++l)
+						for (uint32_t n = 0; n < 50; ++n) {
+							rule.push_back(r);
+							uri.push_back(u);
+							level.push_back(l);
+							line.push_back(n);
+						}
+		}
+
+		FilterExpression::Program Compile(const FilterExpression& expression, double selectivity) const
+		{
+			std::vector<std::vector<bool>> tables;
+			for (const auto& predicate : expression.Predicates()) {
+				std::vector<bool> table;
+				auto test = [&predicate](const std::string& value) {
+					return predicate.regex ? std::regex_search(value, *predicate.regex) : value == predicate.text;
+				};
+				if (predicate.field == FilterExpression::Field::Rule)
+					for (const auto& r : rules)
+						table.push_back(test(r));
+				else if (predicate.field == FilterExpression::Field::Uri)
+					for (const auto& u : uris)
+						table.push_back(test(u));
+				else if (predicate.field == FilterExpression::Field::Tag)
+					for (const auto& ruleTags : tags) {
+						bool match = false;
+						for (const auto& tag : ruleTags)
+							match = match || FilterExpression::MatchesTag(predicate.text, tag);
+						table.push_back(match);
+					}
+				tables.push_back(table);
+			}
+			return expression.Compile(tables, std::vector<double>(expression.Predicates().size(), selectivity));
+		}
+
+		size_t Count(const std::string& text) const
+		{
+			FilterExpression expression(text);
+			FilterExpression::Columns columns;
+			columns.rule = rule.data();
+			columns.uri = uri.data();
+			columns.line = line.data();
+			columns.level = level.data();
+
+			// The order the operands are tested in must not change the answer
+			size_t counts[2] = { 0, 0 };
+			for (int order = 0; order < 2; ++order) {
+				auto program = Compile(expression, order == 0 ? 0.1 : 0.9);
+				for (size_t result = 0; result < rule.size(); ++result)
+					counts[order] += program.Matches(columns, result);
+			}
+			REQUIRE(counts[0] == counts[1]);
+			return counts[0];
+		}
+	};
+}
+
+TEST_CASE("Filter expressions compare levels and lines", "[expression]") {
+	Report report;
+	REQUIRE(report.Count("level == note") == 450);
+	REQUIRE(report.Count("level >= warning") == 900);
+	REQUIRE(report.Count("level != error") == 1350);
+	REQUIRE(report.Count("line in 1..20") == 720);
+	REQUIRE(report.Count("line < 10") == 360);
+	REQUIRE(report.Count("line < 0") == 0);
+	REQUIRE(report.Count("level > error") == 0);
+	REQUIRE(report.Count("level == note && line in 1..20") == 180);
+}
+
+TEST_CASE("Filter expressions match rules, files and tags", "[expression]") {
+	Report report;
+	REQUIRE(report.Count("rule == V008") == 600);
+	REQUIRE(report.Count("rule != V008") == 1200);
+	REQUIRE(report.Count("rule matches \"^V[0-9]{3}$\"") == 1200);
+	REQUIRE(report.Count("file matches \"/tests/\"") == 600);
+	REQUIRE(report.Count("uri == \"/src/App/b.cpp\"") == 600);
+	REQUIRE(report.Count("tags contains security") == 1200);
+	REQUIRE(report.Count("tags contains cwe-*") == 600);
+	REQUIRE(report.Count("tags contains \"external/*\"") == 600);
+	REQUIRE(report.Count("tags contains cwe") == 0);
+}
+
+TEST_CASE("Filter expressions combine predicates", "[expression]") {
+	Report report;
+	REQUIRE(report.Count("rule == V008 or level == error") == 900);
+	REQUIRE(report.Count("RULE == V008 || LEVEL == ERROR") == 900);
+	REQUIRE(report.Count("not (rule == V008 or level == error)") == 900);
+	REQUIRE(report.Count("!rule == V008 and !level == error") == 900);
+	REQUIRE(report.Count("tags contains security and not file matches \"/tests/\" and (line < 5 or line >= 45)") == 160);
+	REQUIRE(report.Count("not not level == none") == 450);
+}
+
+TEST_CASE("Invalid filter expressions are rejected", "[expression]") {
+	REQUIRE_THROWS(FilterExpression(""));
+	REQUIRE_THROWS(FilterExpression("rule"));
+	REQUIRE_THROWS(FilterExpression("rule = V008"));
+	REQUIRE_THROWS(FilterExpression("severity == note"));
+	REQUIRE_THROWS(FilterExpression("level == high"));
+	REQUIRE_THROWS(FilterExpression("line in 20"));
+	REQUIRE_THROWS(FilterExpression("line > -1"));
+	REQUIRE_THROWS(FilterExpression("(rule == V008"));
+	REQUIRE_THROWS(FilterExpression("rule == V008 and"));
+	REQUIRE_THROWS(FilterExpression("rule == \"V008"));
+	REQUIRE_THROWS(FilterExpression("file matches \"(\""));
+}
+
+TEST_CASE("Tag patterns match whole tags or their last component", "[expression]") {
+	REQUIRE(FilterExpression::MatchesTag("security", "security"));
+	REQUIRE(FilterExpression::MatchesTag("sec?rity", "security"));
+	REQUIRE_FALSE(FilterExpression::MatchesTag("secur", "security"));
+	REQUIRE(FilterExpression::MatchesTag("cwe-*", "external/cwe/cwe-190"));
+	REQUIRE(FilterExpression::MatchesTag("*/cwe/*", "external/cwe/cwe-190"));
+	REQUIRE_FALSE(FilterExpression::MatchesTag("cwe/*", "external/cwe/cwe-190"));
+}
+
+TEST_CASE("Quoted values round trip", "[expression]") {
+	const std::string awkward = "a \"quoted\" back\\slash (and) || more";
+	FilterExpression expression("rule == " + FilterExpression::Quote(awkward));
+	REQUIRE(expression.Predicates().size() == 1);
+	REQUIRE(expression.Predicates().front().text == awkward);
+}
@@ -0,0 +1,92 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../FilterPreview.h"
+#include <QBuffer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <map>
+
+static std::shared_ptr<const SARIF> ReportWithFiles(const QStringList& files)
+{
+	QJsonArray results;
+	for (const auto& file : files) {
+		QJsonObject artifactLocation({ {"uri", file} });
+		QJsonObject physicalLocation({ {"artifactLocation", artifactLocation} });
+		QJsonObject location({ {"physicalLocation", physicalLocation} });
+		results.append(QJsonObject({ {"ruleId", "V008"}, {"locations", QJsonArray({ location })} }));
+	}
+	QJsonObject run({ {"results", results} });
+	QJsonObject root({ {"$schema", "https://json.schemastore.org/sarif-2.1.0.json"}, {"version", "2.1.0"}, {"runs", QJsonArray({ run })} });
+	QBuffer buffer;
+	buffer.setData(QJsonDocument(root).toJson());
+	buffer.open(QIODevice::ReadOnly);
+	auto report = std::make_shared<SARIF>();
+	report->Load(buffer);
+	return report;
+}
+
+TEST_CASE("Filter preview counts matches", "[preview]") {
+	FilterPreview preview(ReportWithFiles({ "/src/App/Application.cpp", "/src/Gui/Application.cpp", "/src/Gui/MainWindow.cpp" }));
+	REQUIRE(preview.Count("/Gui/") == 2);
+	REQUIRE(preview.Count("Application") == 2);
+	REQUIRE(preview.Count("^$") == 0);
+	REQUIRE_THROWS(preview.Count("("));
+}
+
+TEST_CASE("A new preview supersedes the one before", "[preview]") {
+	QStringList files;
+	for (int file = 0; file < 20000; ++file)
+		files.append(QString::fromLatin1("/src/Module%1/File%2.cpp").arg(file % 100).arg(file));
+	auto report = ReportWithFiles(files);
+
+	std::map<int, int> found;
+	std::map<int, int> finished;
+	{
+		FilterPreview preview(report);
+		// Called directly on the worker thread, which only ever runs one preview at a time
+		QObject::connect(&preview, &FilterPreview::matchesFound, &preview, [&found, &report](int generation, const QVector<int>& uris) {
+			for (auto uri : uris) {
+				if (generation > 1 && report->DistinctUris()[uri].find("/Module7/") == std::string::npos)
+					found[-1] = 1;
+			}
+			found[generation] += uris.count();
+		}, Qt::DirectConnection);
+		QObject::connect(&preview, &FilterPreview::finished, &preview, [&finished](int generation, int matches) {
+			finished[generation] = matches;
+		}, Qt::DirectConnection);
+		auto first = preview.Start(".*");
+		auto second = preview.Start("/Module7/");
+		REQUIRE(second != first);
+		REQUIRE(preview.Generation() == second);
+		// The destructor would cancel the second run, so wait for it to finish first
+		preview.Wait();
+		REQUIRE(finished.count(second) == 1);
+		REQUIRE(finished[second] == 200);
+		REQUIRE(found[second] == 200);
+	}
+	REQUIRE(found.count(-1) == 0);
+	REQUIRE(finished.size() <= 2);
+}
@@ -0,0 +1,162 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../FingerprintSet.h"
+#include "../LineRanges.h"
+#include "../SARIF.h"
+#include "../SARIFStream.h"
+
+#include <QFile>
+#include <QBuffer>
+#include <QTemporaryFile>
+
+TEST_CASE("Fingerprint set grows and remembers every value", "[fingerprints]") {
+	FingerprintSet set(4);
+	REQUIRE(set.Size() == 0);
+	for (uint64_t value = 0; value < 1000; ++value)
+		REQUIRE(set.Insert(value * 0x9E3779B97F4A7C15ull));
+	REQUIRE(set.Size() == 1000);
+	for (uint64_t value = 0; value < 1000; ++value) {
+		REQUIRE(set.Contains(value * 0x9E3779B97F4A7C15ull));
+		REQUIRE(!set.Insert(value * 0x9E3779B97F4A7C15ull));
+	}
+	REQUIRE(!set.Contains(12345));
+	REQUIRE(set.Size() == 1000);
+}
+
+TEST_CASE("Results are fingerprinted when the file is loaded", "[fingerprints]") {
+	auto sarif = SARIF("Duplicates.sarif");
+	REQUIRE(sarif.ResultCount() == 8);
+	REQUIRE(sarif.FingerprintOf(0) != 0);
+	REQUIRE(sarif.FingerprintOf(0) == sarif.FingerprintOf(1));
+	REQUIRE(sarif.FingerprintOf(0) != sarif.FingerprintOf(2)); // Another line
+	REQUIRE(sarif.FingerprintOf(0) != sarif.FingerprintOf(7)); // Another message
+
+	// partialFingerprints, when there are any, are used instead of the location
+	REQUIRE(sarif.FingerprintOf(3) == sarif.FingerprintOf(4));
+	REQUIRE(sarif.FingerprintOf(3) != sarif.FingerprintOf(5));
+	REQUIRE(sarif.DuplicateMatches().Count() == 2);
+}
+
+TEST_CASE("Duplicate results are removed after the other filters", "[fingerprints]") {
+	auto sarif = SARIF("Duplicates.sarif");
+	SARIF::FilterProfile profile;
+	REQUIRE(sarif.CountResults(profile) == 8);
+	REQUIRE(sarif.DuplicatesPerRule(profile) == std::vector<int>({ 0, 0, 0 }));
+	profile.deduplicate = true;
+	REQUIRE(sarif.CountResults(profile) == 6);
+	REQUIRE(sarif.DuplicatesPerRule(profile) == std::vector<int>({ 1, 1, 0 }));
+
+	// The first of a pair is removed by another filter, so the second one is kept
+	LineRanges ranges;
+	ranges.Add("src/Gui/MainWindow.cpp", 24, 30);
+	profile.lineRanges = std::make_shared<const LineRanges>(ranges);
+	REQUIRE(sarif.CountResults(profile) == 2);
+	REQUIRE(sarif.DuplicatesPerRule(profile) == std::vector<int>({ 0, 0, 0 }));
+	REQUIRE(sarif.Coverage(profile).Remaining() == 2);
+
+	// Removing the first of rule2's pair leaves the second one as the first with its fingerprint, so the coverage
+	// counts it as kept, as the export does
+	profile.lineRanges.reset();
+	profile.expressionFilters = { "rule == rule2 && line == 20" };
+	REQUIRE(sarif.CountResults(profile) == 5);
+	REQUIRE(sarif.Coverage(profile).Remaining() == 5);
+	auto duplicates = sarif.DuplicateMatches(sarif.ExpressionMatches(profile.expressionFilters[0]));
+	REQUIRE(duplicates.Count() == 1);
+	REQUIRE(!duplicates.Contains(4));
+	profile.expressionFilters.clear();
+
+	profile.lineRanges.reset();
+	sarif.SetFilters(profile);
+	QTemporaryFile tempFile;
+	tempFile.open();
+	auto statistics = sarif.Export(tempFile.fileName().toStdString());
+	REQUIRE(statistics.resultsWritten == 6);
+	REQUIRE(statistics.duplicates.size() == 2);
+	REQUIRE(statistics.duplicates["rule1"] == 1);
+	REQUIRE(statistics.duplicates["rule2"] == 1);
+	SARIF exported(tempFile.fileName().toStdString());
+	REQUIRE(exported.ResultCount() == 6);
+	REQUIRE(exported.DuplicateMatches().Count() == 0);
+}
+
+TEST_CASE("Streaming filter removes duplicate results", "[fingerprints]") {
+	SARIF::FilterProfile profile;
+	profile.deduplicate = true;
+	REQUIRE(SARIFStreamFilter::CanStream(profile));
+	QFile input("Duplicates.sarif");
+	REQUIRE(input.open(QIODevice::ReadOnly));
+	QBuffer output;
+	output.open(QIODevice::WriteOnly);
+	auto statistics = SARIFStreamFilter(profile).Filter(input, output);
+	REQUIRE(statistics.resultsRead == 8);
+	REQUIRE(statistics.resultsWritten == 6);
+	REQUIRE(statistics.duplicates["rule1"] == 1);
+	REQUIRE(statistics.duplicates["rule2"] == 1);
+}
+
+TEST_CASE("Only results missing from the baseline are kept", "[fingerprints]") {
+	// The baseline is the same report without rule2, as if rule2 were new
+	auto sarif = SARIF("Duplicates.sarif");
+	sarif.SuppressRule("rule2");
+	QTemporaryFile baselineFile;
+	baselineFile.open();
+	sarif.Export(baselineFile.fileName().toStdString());
+
+	QFile baselineInput(baselineFile.fileName());
+	REQUIRE(baselineInput.open(QIODevice::ReadOnly));
+	auto baseline = std::make_shared<const FingerprintSet>(SARIFStreamFilter::Fingerprints(baselineInput));
+	REQUIRE(baseline->Size() == 4);
+	REQUIRE(SARIF(baselineFile.fileName().toStdString()).Fingerprints().Size() == 4);
+
+	auto current = SARIF("Duplicates.sarif");
+	REQUIRE(current.BaselineMatches(*baseline).Count() == 5);
+	SARIF::FilterProfile profile;
+	profile.baseline = baseline;
+	REQUIRE(current.CountResults(profile) == 3);
+	profile.deduplicate = true;
+	REQUIRE(current.CountResults(profile) == 2);
+	REQUIRE(current.Coverage(profile).Removed() == 6);
+
+	current.SetFilters(profile);
+	QTemporaryFile tempFile;
+	tempFile.open();
+	auto statistics = current.Export(tempFile.fileName().toStdString());
+	REQUIRE(statistics.resultsWritten == 2);
+	REQUIRE(statistics.unchanged == 5);
+
+	QFile input("Duplicates.sarif");
+	REQUIRE(input.open(QIODevice::ReadOnly));
+	QBuffer output;
+	output.open(QIODevice::WriteOnly);
+	statistics = SARIFStreamFilter(profile).Filter(input, output);
+	REQUIRE(statistics.resultsWritten == 2);
+	REQUIRE(statistics.unchanged == 5);
+	REQUIRE(statistics.duplicates["rule2"] == 1);
+
+	QBuffer notSARIF;
+	notSARIF.setData("{\"runs\": []}");
+	notSARIF.open(QIODevice::ReadOnly);
+	REQUIRE_THROWS(SARIFStreamFilter::Fingerprints(notSARIF));
+}
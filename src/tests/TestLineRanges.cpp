@@ -0,0 +1,171 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../LineRanges.h"
+#include "../SARIF.h"
+#include "../SARIFStream.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QFile>
+#include <QBuffer>
+
+TEST_CASE("Line ranges merge and find files by the end of the URI", "[lines]") {
+	LineRanges ranges;
+	ranges.Add("src/App/Application.cpp", 5, 7);
+	ranges.Add("src/App/Application.cpp", 1, 2);
+	ranges.Add("src/App/Application.cpp", 20, 30);
+	REQUIRE(ranges.Find("src/App/Application.cpp")->size() == 3);
+	ranges.Add("src/App/Application.cpp", 3, 4); // Touches both neighbours
+	REQUIRE(ranges.Find("src/App/Application.cpp")->size() == 2);
+	ranges.Add("App/Application.cpp", 100, 100);
+
+	REQUIRE(ranges.Files() == 2);
+	REQUIRE(ranges.Contains("file:///home/jdoe/repo/src/App/Application.cpp", 1));
+	REQUIRE(ranges.Contains("C:\\repo\\src\\App\\Application.cpp", 7));
+	REQUIRE(!ranges.Contains("/home/jdoe/repo/src/App/Application.cpp", 8));
+	REQUIRE(ranges.Contains("/home/jdoe/repo/src/App/Application.cpp", 25));
+	REQUIRE(!ranges.Contains("/home/jdoe/repo/src/App/Application.cpp", 100)); // The longest match wins
+	REQUIRE(ranges.Contains("/home/jdoe/repo/other/App/Application.cpp", 100));
+	REQUIRE(!ranges.Contains("/home/jdoe/repo/src/Gui/Application.cpp", 1));
+	REQUIRE(ranges.Find("Application.cpp") == nullptr);
+
+	ranges.AddFile("src/Gui/Generated.cpp");
+	REQUIRE(ranges.Contains("/home/jdoe/repo/src/Gui/Generated.cpp", 0));
+	REQUIRE(ranges.Contains("/home/jdoe/repo/src/Gui/Generated.cpp", 123456));
+}
+
+TEST_CASE("Line ranges are read from a unified diff", "[lines]") {
+	const std::string diff =
+		"diff --git a/src/App/Application.cpp b/src/App/Application.cpp\n"
+		"--- a/src/App/Application.cpp\n"
+		"+++ b/src/App/Application.cpp\n"
+		"@@ -10,6 +10,7 @@ void Application::run()\n"
+		" context\n"
+		"-removed\n"
+		"--- a removed line that looks like a header\n"
+		"+added\n"
+		"+added\n"
+		"+++ an added line that looks like a header\n"
+		" context\n"
+		" context\n"
+		"@@ -40 +41,2 @@\n"
+		"-old\n"
+		"+new\n"
+		"+new\n"
+		"\\ No newline at end of file\n"
+		"diff --git a/src/Removed.cpp b/src/Removed.cpp\n"
+		"--- a/src/Removed.cpp\n"
+		"+++ /dev/null\n"
+		"@@ -1,2 +0,0 @@\n"
+		"-gone\n"
+		"-gone\n";
+	auto ranges = LineRanges::FromUnifiedDiff(diff);
+	REQUIRE(ranges.Files() == 1);
+	const auto& changed = *ranges.Find("src/App/Application.cpp");
+	REQUIRE(changed.size() == 2);
+	REQUIRE(changed[0].first == 11);
+	REQUIRE(changed[0].last == 13);
+	REQUIRE(changed[1].first == 41);
+	REQUIRE(changed[1].last == 42);
+	REQUIRE(!ranges.Contains("src/App/Application.cpp", 10));
+	REQUIRE(!ranges.Contains("src/App/Application.cpp", 14));
+	REQUIRE(ranges.Find("src/Removed.cpp") == nullptr);
+}
+
+TEST_CASE("Line ranges are read from JSON", "[lines]") {
+	auto ranges = LineRanges::FromJson(QJsonDocument::fromJson(
+		R"({"src/App/Application.cpp": [[10, 20], 35], "src/Gui/Generated.cpp": []})").object());
+	REQUIRE(ranges.Contains("src/App/Application.cpp", 20));
+	REQUIRE(ranges.Contains("src/App/Application.cpp", 35));
+	REQUIRE(!ranges.Contains("src/App/Application.cpp", 21));
+	REQUIRE(ranges.Contains("src/Gui/Generated.cpp", 0));
+
+	REQUIRE_THROWS(LineRanges::FromJson(QJsonDocument::fromJson(R"({"a.cpp": [[20, 10]]})").object()));
+	REQUIRE_THROWS(LineRanges::FromJson(QJsonDocument::fromJson(R"({"a.cpp": ["10"]})").object()));
+	REQUIRE_THROWS(LineRanges::FromJson(QJsonDocument::fromJson(R"({"a.cpp": 10})").object()));
+}
+
+TEST_CASE("Line ranges restrict export and streaming", "[lines]") {
+	auto ranges = std::make_shared<LineRanges>();
+	ranges->Add("src/Gui/Application.cpp", 5, 15);
+	ranges->Add("App/Application.cpp", 2, 2);
+	SARIF::FilterProfile profile;
+	profile.lineRanges = ranges;
+
+	SARIF sarif("RuleIndexes.sarif");
+	REQUIRE(sarif.LineRangeMatches(*ranges).Count() == 2);
+	REQUIRE(sarif.CountResults(profile) == 1);
+	REQUIRE(sarif.ListResults(profile)[0].first == "rule2");
+	REQUIRE(sarif.Coverage(profile).Removed() == 2);
+
+	QFile input("RuleIndexes.sarif");
+	REQUIRE(input.open(QIODevice::ReadOnly));
+	QBuffer output;
+	output.open(QIODevice::WriteOnly);
+	auto statistics = SARIFStreamFilter(profile).Filter(input, output);
+	REQUIRE(statistics.resultsRead == 3);
+	REQUIRE(statistics.resultsWritten == 1);
+}
+
+TEST_CASE("Line ranges keep results whose region overlaps them", "[lines]") {
+	LineRanges ranges;
+	ranges.Add("src/App/Application.cpp", 10, 10);
+	ranges.Add("src/App/Application.cpp", 30, 40);
+	const auto& fileRanges = *ranges.Find("src/App/Application.cpp");
+	REQUIRE(LineRanges::Overlaps(fileRanges, 8, 12));
+	REQUIRE(LineRanges::Overlaps(fileRanges, 25, 30));
+	REQUIRE(LineRanges::Overlaps(fileRanges, 1, 100));
+	REQUIRE(!LineRanges::Overlaps(fileRanges, 11, 29));
+	REQUIRE(!LineRanges::Overlaps(fileRanges, 41, 50));
+
+	const QByteArray report = R"({"version": "2.1.0", "$schema": "https://json.schemastore.org/sarif-2.1.0.json", "runs": [{"tool": {"driver": {"name": "Made by hand"}}, "results": [
+		{"ruleId": "spans", "message": {"text": "Lines 8 to 12"}, "locations": [{"physicalLocation": {
+			"artifactLocation": {"uri": "/home/jdoe/repo/src/App/Application.cpp"}, "region": {"startLine": 8, "endLine": 12}}}]},
+		{"ruleId": "before", "message": {"text": "Lines 1 to 3"}, "locations": [{"physicalLocation": {
+			"artifactLocation": {"uri": "/home/jdoe/repo/src/App/Application.cpp"}, "region": {"startLine": 1, "endLine": 3}}}]},
+		{"ruleId": "backwards", "message": {"text": "Line 20, ending before it starts"}, "locations": [{"physicalLocation": {
+			"artifactLocation": {"uri": "/home/jdoe/repo/src/App/Application.cpp"}, "region": {"startLine": 20, "endLine": 5}}}]}
+	]}]})";
+	SARIF::FilterProfile profile;
+	profile.lineRanges = std::make_shared<LineRanges>(ranges);
+
+	QBuffer input;
+	input.setData(report);
+	input.open(QIODevice::ReadOnly);
+	SARIF sarif;
+	sarif.Load(input);
+	REQUIRE(sarif.EndLineOf(0) == 12);
+	REQUIRE(sarif.EndLineOf(2) == 20);
+	REQUIRE(sarif.LineRangeMatches(ranges).Count() == 2);
+	REQUIRE(sarif.CountResults(profile) == 1);
+	REQUIRE(sarif.ListResults(profile)[0].first == "spans");
+
+	input.seek(0);
+	QBuffer output;
+	output.open(QIODevice::WriteOnly);
+	auto statistics = SARIFStreamFilter(profile).Filter(input, output);
+	REQUIRE(statistics.resultsRead == 3);
+	REQUIRE(statistics.resultsWritten == 1);
+}
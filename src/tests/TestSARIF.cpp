@@ -24,10 +24,17 @@
 
 #include <QFile>
 #include <QTemporaryFile>
+#include <QBuffer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
 #include "../SARIF.h"
 #include <memory>
 #include <fstream>
 #include <regex>
+#include <algorithm>
+#include <set>
+#include <filesystem>
 
 
 TEST_CASE("Fail on non-existent file", "[sarif]") {
@@ -290,4 +297,501 @@ TEST_CASE("Exported file puts version at the top", "[sarif]") {
 			FAIL("Exported file does not start with the version element");
 		}
 	}
-}
\ No newline at end of file
+}
+
+TEST_CASE("Unused rules are kept by default", "[sarif]") {
+	auto sarif = SARIF("SeveralRules.sarif");
+	sarif.SuppressRule("rule2");
+	QTemporaryFile tempFile;
+	tempFile.open();
+	std::string filename = tempFile.fileName().toStdString() + ".sarif";
+	tempFile.close();
+	sarif.Export(filename);
+	auto sarif2 = SARIF(filename);
+	QFile::remove(QString::fromStdString(filename));
+	REQUIRE(sarif2.Rules().size() == 2);
+}
+
+TEST_CASE("Pruning removes unused rules", "[sarif]") {
+	auto sarif = SARIF("SeveralRules.sarif");
+	sarif.SuppressRule("rule2");
+	sarif.SetPruneRules(true);
+	QTemporaryFile tempFile;
+	tempFile.open();
+	std::string filename = tempFile.fileName().toStdString() + ".sarif";
+	tempFile.close();
+	sarif.Export(filename);
+	auto sarif2 = SARIF(filename);
+	QFile::remove(QString::fromStdString(filename));
+	auto rules = sarif2.Rules();
+	REQUIRE(rules.size() == 1);
+	REQUIRE(std::get<0>(rules.front()) == "rule1");
+}
+
+TEST_CASE("Pruning renumbers ruleIndex", "[sarif]") {
+	auto sarif = SARIF("RuleIndexes.sarif");
+	sarif.SuppressRule("rule1");
+	sarif.SetPruneRules(true);
+	QTemporaryFile tempFile;
+	tempFile.open();
+	std::string filename = tempFile.fileName().toStdString() + ".sarif";
+	tempFile.close();
+	sarif.Export(filename);
+
+	QFile exportedFile(QString::fromStdString(filename));
+	REQUIRE(exportedFile.open(QIODevice::ReadOnly | QIODevice::Text));
+	auto run = QJsonDocument::fromJson(exportedFile.readAll()).object()["runs"].toArray().first().toObject();
+	exportedFile.close();
+	QFile::remove(QString::fromStdString(filename));
+
+	auto rules = run["tool"].toObject()["driver"].toObject()["rules"].toArray();
+	REQUIRE(rules.size() == 2);
+	REQUIRE(rules[0].toObject()["id"].toString() == "rule2");
+	REQUIRE(rules[1].toObject()["id"].toString() == "rule3");
+
+	auto results = run["results"].toArray();
+	REQUIRE(results.size() == 2);
+	for (const auto& result : results) {
+		auto resultObject = result.toObject();
+		auto index = resultObject["ruleIndex"].toInt();
+		REQUIRE(rules[index].toObject()["id"].toString() == resultObject["ruleId"].toString());
+	}
+}
+
+TEST_CASE("Projection drops listed fields", "[sarif]") {
+	auto sarif = SARIF("PVS-freecad-23754_210125.sarif");
+	sarif.SetResultProjection(SARIF::ProjectionMode::Drop, { "relatedLocations", "locations/physicalLocation/region" });
+	QTemporaryFile tempFile;
+	tempFile.open();
+	std::string filename = tempFile.fileName().toStdString() + ".sarif";
+	tempFile.close();
+	auto statistics = sarif.Export(filename);
+
+	QFile exportedFile(QString::fromStdString(filename));
+	REQUIRE(exportedFile.open(QIODevice::ReadOnly | QIODevice::Text));
+	auto run = QJsonDocument::fromJson(exportedFile.readAll()).object()["runs"].toArray().first().toObject();
+	exportedFile.close();
+	QFile::remove(QString::fromStdString(filename));
+
+	auto results = run["results"].toArray();
+	REQUIRE(results.size() == statistics.resultsWritten);
+	for (const auto& result : results) {
+		auto resultObject = result.toObject();
+		REQUIRE(!resultObject.contains("relatedLocations"));
+		REQUIRE(resultObject.contains("message"));
+		auto physicalLocation = resultObject["locations"].toArray().first().toObject()["physicalLocation"].toObject();
+		REQUIRE(physicalLocation.contains("artifactLocation"));
+		REQUIRE(!physicalLocation.contains("region"));
+	}
+	REQUIRE(statistics.projectedBytes["relatedLocations"] > 0);
+	REQUIRE(statistics.projectedBytes["locations/physicalLocation/region"] > 0);
+}
+
+TEST_CASE("Projection keeps only listed fields", "[sarif]") {
+	auto sarif = SARIF("SeveralRules.sarif");
+	sarif.SetResultProjection(SARIF::ProjectionMode::Keep, { "ruleId", "message" });
+	QTemporaryFile tempFile;
+	tempFile.open();
+	std::string filename = tempFile.fileName().toStdString() + ".sarif";
+	tempFile.close();
+	auto statistics = sarif.Export(filename);
+
+	QFile exportedFile(QString::fromStdString(filename));
+	REQUIRE(exportedFile.open(QIODevice::ReadOnly | QIODevice::Text));
+	auto run = QJsonDocument::fromJson(exportedFile.readAll()).object()["runs"].toArray().first().toObject();
+	exportedFile.close();
+	QFile::remove(QString::fromStdString(filename));
+
+	for (const auto& result : run["results"].toArray()) {
+		auto keys = result.toObject().keys();
+		REQUIRE(keys.size() == 2);
+		REQUIRE(keys.contains("ruleId"));
+		REQUIRE(keys.contains("message"));
+	}
+	REQUIRE(statistics.projectedBytes.size() == 2);
+	REQUIRE(statistics.projectedBytes["level"] > 0);
+	REQUIRE(statistics.projectedBytes["locations"] > 0);
+}
+
+TEST_CASE("Export size estimate is close to the real size", "[sarif]") {
+	auto sarif = SARIF("PVS-freecad-23754_210125.sarif");
+	sarif.SuppressRule("V008");
+	auto estimate = sarif.EstimateExportSize();
+	QTemporaryFile tempFile;
+	tempFile.open();
+	std::string filename = tempFile.fileName().toStdString() + ".sarif";
+	tempFile.close();
+	sarif.Export(filename);
+	auto actual = QFile(QString::fromStdString(filename)).size();
+	QFile::remove(QString::fromStdString(filename));
+	REQUIRE(estimate > actual * 0.9);
+	REQUIRE(estimate < actual * 1.1);
+}
+
+TEST_CASE("Per-rule and per-directory sizes add up", "[sarif]") {
+	auto sarif = SARIF("PVS-freecad-23754_210125.sarif");
+	auto total = sarif.EstimateExportSize();
+	size_t ruleTotal = 0;
+	for (const auto& rule : sarif.BytesByRule())
+		ruleTotal += rule.second;
+	size_t directoryTotal = 0;
+	for (const auto& directory : sarif.BytesByDirectory())
+		directoryTotal += directory.second;
+	REQUIRE(ruleTotal == directoryTotal);
+	REQUIRE(ruleTotal < total);
+}
+
+TEST_CASE("Size budget plan fits the budget", "[sarif]") {
+	auto sarif = SARIF("PVS-freecad-23754_210125.sarif");
+	auto budget = sarif.EstimateExportSize() / 2;
+	auto plan = sarif.PlanSizeBudget(budget);
+	REQUIRE(plan.fits);
+	REQUIRE(plan.plannedBytes <= budget);
+	REQUIRE(plan.rulesToDrop.size() + plan.directoriesToDrop.size() > 0);
+
+	sarif.ApplySizeBudgetPlan(plan);
+	REQUIRE(sarif.EstimateExportSize() == plan.plannedBytes);
+	REQUIRE(sarif.PlanSizeBudget(budget).rulesToDrop.empty());
+}
+
+TEST_CASE("Directory filters match only that directory", "[sarif]") {
+	auto sarif = SARIF("RuleIndexes.sarif");
+	auto regex = sarif.DirectoryFilter("/home/jdoe/repo/src/Gui");
+	REQUIRE(sarif.AddLocationFilter(regex) == 2);
+	sarif.SetBase("/somewhere/else/");
+	REQUIRE(std::regex_search(std::string("/somewhere/else/src/Gui/MainWindow.cpp"), std::regex(regex)));
+	REQUIRE(!std::regex_search(std::string("/somewhere/else/src/Gui/Sub/MainWindow.cpp"), std::regex(regex)));
+	REQUIRE(!std::regex_search(std::string("/somewhere/else/src/App/Application.cpp"), std::regex(regex)));
+}
+
+TEST_CASE("Directory filters for the base and for names the base cuts through stay anchored", "[sarif]") {
+	auto sarif = SARIF("RuleIndexes.sarif");
+	REQUIRE(sarif.GetBase() == "/home/jdoe/repo/src/");
+	auto regex = sarif.DirectoryFilter("/home/jdoe/repo/src");
+	REQUIRE(sarif.AddLocationFilter(regex) == 0);
+	REQUIRE(std::regex_search(std::string("/home/jdoe/repo/src/main.cpp"), std::regex(regex)));
+	REQUIRE(!std::regex_search(std::string("/home/jdoe/repo/src/Gui/MainWindow.cpp"), std::regex(regex)));
+	REQUIRE(!std::regex_search(std::string("/elsewhere/main.cpp"), std::regex(regex)));
+
+	// With files in Gui and Geo, the base ends part way through their names
+	QBuffer input;
+	input.setData(R"({"version": "2.1.0", "$schema": "https://json.schemastore.org/sarif-2.1.0.json", "runs": [{
+		"tool": {"driver": {"name": "Made by hand"}}, "results": [
+		{"ruleId": "rule1", "message": {"text": "In Gui"}, "locations": [{"physicalLocation": {"artifactLocation": {"uri": "/repo/src/Gui/A.cpp"}}}]},
+		{"ruleId": "rule1", "message": {"text": "In Geo"}, "locations": [{"physicalLocation": {"artifactLocation": {"uri": "/repo/src/Geo/B.cpp"}}}]}
+	]}]})");
+	input.open(QIODevice::ReadOnly);
+	SARIF cut;
+	cut.Load(input);
+	REQUIRE(cut.GetBase() == "/repo/src/G");
+	regex = cut.DirectoryFilter("/repo/src/Gui");
+	REQUIRE(cut.AddLocationFilter(regex) == 1);
+	REQUIRE(std::regex_search(std::string("/somewhere/else/Gui/A.cpp"), std::regex(regex)));
+	REQUIRE(!std::regex_search(std::string("/repo/src/Tools/ui/C.cpp"), std::regex(regex)));
+	REQUIRE(std::regex_search(std::string("A.cpp"), std::regex(cut.DirectoryFilter(""))));
+	REQUIRE(!std::regex_search(std::string("/repo/A.cpp"), std::regex(cut.DirectoryFilter(""))));
+}
+
+TEST_CASE("Split by directory writes one file per component", "[sarif]") {
+	auto sarif = SARIF("RuleIndexes.sarif");
+	sarif.SetPruneRules(true);
+	QTemporaryFile tempFile;
+	tempFile.open();
+	std::string filename = tempFile.fileName().toStdString() + ".sarif";
+	tempFile.close();
+	auto outputs = sarif.ExportSplit(filename, SARIF::SplitMode::ByDirectory);
+
+	// The base is /home/jdoe/repo/src/, so the results are split between App and Gui
+	REQUIRE(outputs.size() == 2);
+	REQUIRE(outputs[0].second.resultsWritten == 1);
+	REQUIRE(outputs[1].second.resultsWritten == 2);
+	auto app = SARIF(outputs[0].first);
+	auto gui = SARIF(outputs[1].first);
+	QFile::remove(QString::fromStdString(outputs[0].first));
+	QFile::remove(QString::fromStdString(outputs[1].first));
+	REQUIRE(app.Rules().size() == 1);
+	REQUIRE(gui.Rules().size() == 2);
+	REQUIRE(app.Files().size() == 1);
+	REQUIRE(gui.Files().size() == 2);
+}
+
+TEST_CASE("Split by directory keeps components with the same file name apart", "[sarif]") {
+	QBuffer input;
+	input.setData(R"({"version": "2.1.0", "$schema": "https://json.schemastore.org/sarif-2.1.0.json", "runs": [{
+		"tool": {"driver": {"name": "Made by hand"}}, "results": [
+		{"ruleId": "rule1", "message": {"text": "A"}, "locations": [{"physicalLocation": {"artifactLocation": {"uri": "/repo/src dir/A.cpp"}}}]},
+		{"ruleId": "rule1", "message": {"text": "B"}, "locations": [{"physicalLocation": {"artifactLocation": {"uri": "/repo/src_dir/B.cpp"}}}]},
+		{"ruleId": "rule1", "message": {"text": "C"}, "locations": [{"physicalLocation": {"artifactLocation": {"uri": "/repo/Src_Dir/C.cpp"}}}]}
+	]}]})");
+	input.open(QIODevice::ReadOnly);
+	SARIF sarif;
+	sarif.Load(input);
+	QTemporaryFile tempFile;
+	tempFile.open();
+	std::string filename = tempFile.fileName().toStdString() + ".sarif";
+	tempFile.close();
+	auto outputs = sarif.ExportSplit(filename, SARIF::SplitMode::ByDirectory);
+
+	REQUIRE(outputs.size() == 3);
+	std::set<std::string> names;
+	for (const auto& output : outputs) {
+		auto name = std::filesystem::path(output.first).filename().string();
+		std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		names.insert(name);
+		REQUIRE(output.second.resultsWritten == 1);
+		REQUIRE(SARIF(output.first).ResultCount() == 1);
+		QFile::remove(QString::fromStdString(output.first));
+	}
+	REQUIRE(names.size() == 3);
+}
+
+TEST_CASE("Split by size keeps each file under the limit", "[sarif]") {
+	auto sarif = SARIF("PVS-freecad-23754_210125.sarif");
+	sarif.SetPruneRules(true);
+	QTemporaryFile tempFile;
+	tempFile.open();
+	std::string filename = tempFile.fileName().toStdString() + ".sarif";
+	tempFile.close();
+	const size_t maximumBytes = 300 * 1024;
+	auto outputs = sarif.ExportSplit(filename, SARIF::SplitMode::BySize, maximumBytes);
+	REQUIRE(outputs.size() > 1);
+
+	int totalResults = 0;
+	for (const auto& output : outputs) {
+		QFile part(QString::fromStdString(output.first));
+		REQUIRE(part.size() < maximumBytes * 1.1);
+		REQUIRE_NOTHROW(SARIF(output.first));
+		totalResults += output.second.resultsWritten;
+		QFile::remove(QString::fromStdString(output.first));
+	}
+	REQUIRE(totalResults == outputs.front().second.resultsRead);
+}
+
+
+TEST_CASE("Several filter profiles are written from one load", "[sarif]") {
+	auto sarif = SARIF("RuleIndexes.sarif");
+	QTemporaryFile tempFile;
+	tempFile.open();
+	std::string filename = tempFile.fileName().toStdString();
+	tempFile.close();
+
+	SARIF::FilterProfile withoutGui;
+	withoutGui.locationFilters.push_back("/Gui/");
+	SARIF::FilterProfile withoutRule1;
+	withoutRule1.suppressedRules.push_back("rule1");
+	withoutRule1.overrideBase = true;
+	withoutRule1.base = "/changed/";
+	auto statistics = sarif.ExportProfiles({
+		std::make_pair(withoutGui, filename + "_1.sarif"),
+		std::make_pair(withoutRule1, filename + "_2.sarif") });
+
+	REQUIRE(statistics.size() == 2);
+	REQUIRE(statistics[0].resultsWritten == 1);
+	REQUIRE(statistics[1].resultsWritten == 2);
+	auto first = SARIF(filename + "_1.sarif");
+	auto second = SARIF(filename + "_2.sarif");
+	QFile::remove(QString::fromStdString(filename + "_1.sarif"));
+	QFile::remove(QString::fromStdString(filename + "_2.sarif"));
+	REQUIRE(first.Files().size() == 1);
+	REQUIRE(second.GetRules().count("rule1") == 0);
+	REQUIRE(second.GetBase().rfind("/changed/", 0) == 0);
+
+	// The object's own filters are untouched
+	REQUIRE(sarif.SuppressedRules().empty());
+	REQUIRE(sarif.LocationFilters().empty());
+}
+
+TEST_CASE("Reloading an appended file only indexes the new results", "[sarif]") {
+	QFile original("RuleIndexes.sarif");
+	REQUIRE(original.open(QIODevice::ReadOnly));
+	auto document = QJsonDocument::fromJson(original.readAll()).object();
+	QTemporaryFile tempFile;
+	tempFile.open();
+	std::string filename = tempFile.fileName().toStdString();
+	tempFile.close();
+	auto save = [&filename](const QJsonObject& root) {
+		QFile file(QString::fromStdString(filename));
+		file.open(QIODevice::WriteOnly);
+		file.write(QJsonDocument(root).toJson());
+	};
+
+	save(document);
+	auto sarif = SARIF(filename);
+	sarif.SuppressRule("rule1");
+	auto before = sarif.CountResults(sarif.Filters());
+	auto resultsBefore = sarif.ListResults(SARIF::FilterProfile()).size();
+
+	// Append a copy of the last result, in a different directory
+	auto runs = document["runs"].toArray();
+	auto run = runs.first().toObject();
+	auto results = run["results"].toArray();
+	auto extra = results.last().toObject();
+	extra["locations"] = QJsonArray({ QJsonObject({ {"physicalLocation", QJsonObject({
+		{"artifactLocation", QJsonObject({ {"uri", "/home/jdoe/elsewhere/New.cpp"} })} })} }) });
+	results.append(extra);
+	run["results"] = results;
+	runs[0] = run;
+	document["runs"] = runs;
+	save(document);
+
+	REQUIRE(sarif.Reload(filename) == resultsBefore);
+	REQUIRE(sarif.ListResults(SARIF::FilterProfile()).size() == resultsBefore + 1);
+	REQUIRE(sarif.CountResults(sarif.Filters()) == before + 1);
+	REQUIRE(sarif.GetBase() == "/home/jdoe/");
+	REQUIRE(sarif.SuppressedRules().size() == 1);
+
+	// Once the first result changes, nothing can be reused
+	results[0] = extra;
+	run["results"] = results;
+	runs[0] = run;
+	document["runs"] = runs;
+	save(document);
+	REQUIRE(sarif.Reload(filename) == 0);
+	QFile::remove(QString::fromStdString(filename));
+}
+
+TEST_CASE("Filter analysis finds dead, redundant and similar filters", "[sarif]") {
+	SARIF sarif("SeveralRules.sarif");
+	SARIF::FilterProfile profile;
+	profile.suppressedRules = { "rule1", "rule3" };
+	profile.locationFilters = { "Application", "App/", "NoSuchFile" };
+	auto analysis = sarif.AnalyzeFilters(profile);
+
+	REQUIRE(analysis.filters.size() == 5);
+	REQUIRE(analysis.results == 3);
+	REQUIRE(analysis.removed == 3);
+	REQUIRE(analysis.dead == std::vector<size_t>({ 1, 4 }));
+	REQUIRE(analysis.redundant == std::vector<size_t>({ 0, 3 }));
+	REQUIRE(analysis.overlap[0][2] == 2);
+	REQUIRE(analysis.overlap[2][0] == 2);
+	REQUIRE(analysis.overlap[2][2] == 3);
+
+	// rule1 is inside both file filters, which match the same results as each other, so only the later one is
+	// reported as contained in the earlier one
+	std::vector<std::pair<size_t, size_t>> subsumed = { {0, 2}, {0, 3}, {3, 2} };
+	REQUIRE(analysis.subsumed == subsumed);
+	std::vector<std::pair<size_t, size_t>> similar = { {0, 2}, {0, 3} };
+	REQUIRE(analysis.similar == similar);
+	REQUIRE(sarif.AnalyzeFilters(profile, 0).similar.empty());
+
+	profile.locationFilters.push_back("(");
+	REQUIRE_THROWS(sarif.AnalyzeFilters(profile));
+}
+
+TEST_CASE("Filter analysis reports only one of two identical filters as redundant", "[sarif]") {
+	SARIF sarif("SeveralRules.sarif");
+	SARIF::FilterProfile profile;
+	profile.locationFilters = { "App/", "Gui/", "App/" };
+	auto analysis = sarif.AnalyzeFilters(profile);
+	REQUIRE(analysis.redundant == std::vector<size_t>({ 2 }));
+	REQUIRE(analysis.filters[0].unique == 0);
+	REQUIRE(analysis.filters[2].unique == 0);
+}
+
+TEST_CASE("A filter profile is applied in one pass", "[sarif]") {
+	auto sarif = SARIF("PVS-freecad-23754_210125.sarif");
+	SARIF::FilterProfile profile;
+	profile.suppressedRules = { "V008", "NoSuchRule" };
+	profile.locationFilters = { "^.*Mod/Draft/.*\\.cpp$", "NoSuchFile" };
+	auto hits = sarif.ApplyFilterProfile(profile);
+	REQUIRE(hits == std::vector<int>{ 6, 0, 9, 0 });
+	REQUIRE(sarif.SuppressedRules() == profile.suppressedRules);
+	REQUIRE(sarif.LocationFilters() == profile.locationFilters);
+
+	SARIF::FilterProfile invalid;
+	invalid.suppressedRules = { "V009" };
+	invalid.locationFilters = { "(" };
+	REQUIRE_THROWS(sarif.ApplyFilterProfile(invalid));
+	REQUIRE(sarif.SuppressedRules().size() == 2);
+}
+
+TEST_CASE("Expression filters use rule tags, levels and lines", "[sarif]") {
+	auto sarif = SARIF("PVS-freecad-23754_210125.sarif");
+	REQUIRE(sarif.ExpressionHits("level == note && line in 1..20") == 2);
+	REQUIRE(sarif.ExpressionHits("tags contains cwe-*") == 1564);
+	REQUIRE(sarif.ExpressionHits("tags contains cwe-190") == 21);
+	REQUIRE(sarif.AddExpressionFilter("rule == V008 or level == error") == 104);
+	REQUIRE(sarif.ExpressionFilters().size() == 1);
+	auto kept = sarif.KeptResults(sarif.Filters());
+	REQUIRE(std::count(kept.begin(), kept.end(), true) == 1829 - 104);
+
+	REQUIRE_THROWS(sarif.AddExpressionFilter("level == high"));
+	REQUIRE(sarif.ExpressionFilters().size() == 1);
+	sarif.RemoveExpressionFilter("rule == V008 or level == error");
+	REQUIRE(sarif.ExpressionFilters().empty());
+}
+
+TEST_CASE("Rule tags are indexed when the file is loaded", "[sarif]") {
+	auto sarif = SARIF("PVS-freecad-23754_210125.sarif");
+	const auto& tags = sarif.DistinctTags();
+	REQUIRE(tags.size() == 47);
+	auto security = std::find(tags.begin(), tags.end(), "security");
+	REQUIRE(security != tags.end());
+	auto tag = static_cast<uint32_t>(security - tags.begin());
+	REQUIRE(sarif.RulesWithTag(tag).Count() == 84);
+	REQUIRE(sarif.ResultsPerTag()[tag] == 1564);
+	REQUIRE(sarif.RulesMatchingTag("cwe-682").Count() == 7);
+	REQUIRE(sarif.TagMatches("cwe-682").Count() == 590);
+	REQUIRE(sarif.TagMatches("cwe-190").Count() == 21);
+	REQUIRE(sarif.TagMatches("no-such-tag").Count() == 0);
+}
+
+TEST_CASE("Level and rank threshold", "[sarif]") {
+	auto sarif = SARIF("Ranked.sarif");
+	REQUIRE(sarif.RankOf(0) == 95);
+	REQUIRE(sarif.RankOf(2) == 30);
+	REQUIRE(sarif.RankOf(3) == SARIF::Unranked);
+
+	// Results without a rank are never removed by the rank
+	REQUIRE(sarif.ThresholdHits(SARIF::Level::None, 0) == 0);
+	REQUIRE(sarif.ThresholdHits(SARIF::Level::Warning, 0) == 1);
+	REQUIRE(sarif.ThresholdHits(SARIF::Level::Error, 0) == 4);
+	REQUIRE(sarif.ThresholdHits(SARIF::Level::None, 61) == 2);
+	REQUIRE(sarif.ThresholdHits(SARIF::Level::None, 100) == 4);
+	REQUIRE(sarif.ThresholdHits(SARIF::Level::Warning, 61) == 3);
+	REQUIRE(sarif.ThresholdMatches(SARIF::Level::Warning, 61).Count() == 3);
+
+	REQUIRE(sarif.SetThreshold(SARIF::Level::Warning, 61) == 3);
+	REQUIRE(sarif.CountResults(sarif.Filters()) == 2);
+	REQUIRE(sarif.Coverage(sarif.Filters()).Removed() == 3);
+
+	QTemporaryFile tempFile;
+	tempFile.open();
+	sarif.Export(tempFile.fileName().toStdString());
+	SARIF exported(tempFile.fileName().toStdString());
+	REQUIRE(exported.ResultCount() == 2);
+	REQUIRE(exported.LevelOf(0) == SARIF::Level::Error);
+	REQUIRE(exported.RankOf(1) == SARIF::Unranked);
+
+	REQUIRE(SARIF::LevelFromName("note") == SARIF::Level::Note);
+	REQUIRE(SARIF::LevelName(SARIF::Level::Error) == "error");
+	REQUIRE_THROWS(SARIF::LevelFromName("high"));
+
+	auto pvs = SARIF("PVS-freecad-23754_210125.sarif");
+	REQUIRE(pvs.ThresholdHits(SARIF::Level::Warning, 0) == 1236);
+	REQUIRE(pvs.ThresholdHits(SARIF::Level::Error, 0) == 1725);
+}
+
+TEST_CASE("Rules and files cover every run", "[sarif]") {
+	QBuffer input;
+	input.setData(R"({"version": "2.1.0", "$schema": "https://json.schemastore.org/sarif-2.1.0.json", "runs": [{
+		"tool": {"driver": {"name": "First", "rules": [{"id": "rule1", "shortDescription": {"text": "One"}}]}}, "results": [
+		{"ruleId": "rule1", "message": {"text": "A"}, "locations": [{"physicalLocation": {"artifactLocation": {"uri": "/repo/src/A.cpp"}}}]}
+	]}, {
+		"tool": {"driver": {"name": "Second", "rules": [{"id": "rule1", "shortDescription": {"text": "Again"}},
+			{"id": "rule2", "shortDescription": {"text": "Two"}}]}}, "results": [
+		{"ruleId": "rule1", "message": {"text": "B"}, "locations": [{"physicalLocation": {"artifactLocation": {"uri": "/repo/src/B.cpp"}}}]},
+		{"ruleId": "rule2", "message": {"text": "C"}, "locations": [{"physicalLocation": {"artifactLocation": {"uri": "/repo/src/B.cpp"}}}]}
+	]}]})");
+	input.open(QIODevice::ReadOnly);
+	SARIF sarif;
+	sarif.Load(input);
+
+	auto rules = sarif.Rules();
+	REQUIRE(rules.size() == 2);
+	REQUIRE(std::get<0>(rules[0]) == "rule1");
+	REQUIRE(std::get<1>(rules[0]) == "One");
+	REQUIRE(std::get<0>(rules[1]) == "rule2");
+	REQUIRE(sarif.GetRules() == std::map<std::string, int>{ {"rule1", 2}, {"rule2", 1} });
+	REQUIRE(sarif.Files() == std::set<std::string>{ "/repo/src/A.cpp", "/repo/src/B.cpp" });
+}
@@ -0,0 +1,112 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../SARIFModels.h"
+
+#include <algorithm>
+
+TEST_CASE("Rule model sorts and filters by id", "[models]") {
+	auto report = std::make_shared<const SARIF>("SeveralRules.sarif");
+	RuleTableModel model(report);
+	REQUIRE(model.rowCount() == 2);
+	REQUIRE(model.columnCount() == RuleTableModel::ColumnCount);
+
+	model.sort(RuleTableModel::CountColumn, Qt::AscendingOrder);
+	REQUIRE(model.Rule(0) == "rule2");
+	REQUIRE(model.data(model.index(1, RuleTableModel::CountColumn)).toInt() == 2);
+	model.sort(RuleTableModel::RuleColumn, Qt::DescendingOrder);
+	REQUIRE(model.data(model.index(0, RuleTableModel::RuleColumn)).toString() == "rule2");
+
+	// Filtering keeps the sort order
+	model.SetFilter("RULE");
+	REQUIRE(model.rowCount() == 2);
+	REQUIRE(model.Rule(0) == "rule2");
+	model.SetFilter("1");
+	REQUIRE(model.rowCount() == 1);
+	REQUIRE(model.Rule(0) == "rule1");
+	model.SetFilter("");
+	REQUIRE(model.rowCount() == 2);
+}
+
+TEST_CASE("Rule model groups rules by tag", "[models]") {
+	auto report = std::make_shared<const SARIF>("PVS-freecad-23754_210125.sarif");
+	RuleTableModel model(report);
+	const auto& tags = report->DistinctTags();
+	auto security = static_cast<int>(std::find(tags.begin(), tags.end(), "security") - tags.begin());
+	auto all = model.rowCount();
+	model.SetTag(security);
+	REQUIRE(model.rowCount() == 84);
+	REQUIRE(model.data(model.index(0, RuleTableModel::TagsColumn)).toString().contains("security"));
+	model.SetTag(-1);
+	REQUIRE(model.rowCount() == all);
+
+	model.sort(RuleTableModel::TagsColumn, Qt::AscendingOrder);
+	for (int row = 1; row < model.rowCount(); ++row)
+		REQUIRE(model.data(model.index(row - 1, RuleTableModel::TagsColumn)).toString() <= model.data(model.index(row, RuleTableModel::TagsColumn)).toString());
+	model.sort(RuleTableModel::TagsColumn, Qt::DescendingOrder);
+	REQUIRE(model.data(model.index(0, RuleTableModel::TagsColumn)).toString() >= model.data(model.index(all - 1, RuleTableModel::TagsColumn)).toString());
+	REQUIRE(model.data(model.index(0, RuleTableModel::TagsColumn)).toString() != model.data(model.index(all - 1, RuleTableModel::TagsColumn)).toString());
+}
+
+TEST_CASE("URI model grows as rows are appended", "[models]") {
+	auto report = std::make_shared<const SARIF>("RuleIndexes.sarif");
+	UriListModel model(report);
+	REQUIRE(model.rowCount() == 0);
+	model.Append({ 2, 0 });
+	REQUIRE(model.rowCount() == 2);
+	REQUIRE(model.Uri(0).toStdString() == report->DistinctUris()[2]);
+	model.sort(0, Qt::AscendingOrder);
+	REQUIRE(model.Uri(0).toStdString() == report->DistinctUris()[0]);
+	model.Clear();
+	REQUIRE(model.rowCount() == 0);
+}
+
+TEST_CASE("Result model shows what the filters keep", "[models]") {
+	auto report = std::make_shared<const SARIF>("SeveralRules.sarif");
+	ResultTableModel model(report);
+	REQUIRE(model.rowCount() == 3);
+	REQUIRE(model.KeptCount() == 3);
+	REQUIRE(model.data(model.index(2, ResultTableModel::MessageColumn)).toString() == "This is the second rule");
+	REQUIRE(model.data(model.index(0, ResultTableModel::LineColumn)).toInt() == 1);
+	REQUIRE(model.data(model.index(0, ResultTableModel::LevelColumn)).toString() == "Error");
+
+	SARIF::FilterProfile profile;
+	profile.suppressedRules.push_back("rule1");
+	model.SetFilters(profile);
+	REQUIRE(model.KeptCount() == 1);
+	REQUIRE(model.data(model.index(0, ResultTableModel::StateColumn)).toString() == "Removed");
+	REQUIRE(model.data(model.index(2, ResultTableModel::StateColumn)).toString() == "Kept");
+
+	// Sorting by state follows later changes to the filters
+	model.sort(ResultTableModel::StateColumn, Qt::DescendingOrder);
+	REQUIRE(model.Result(0) == 2);
+	profile.suppressedRules = { "rule2" };
+	model.SetFilters(profile);
+	REQUIRE(model.Result(2) == 2);
+
+	model.sort(ResultTableModel::RuleColumn, Qt::DescendingOrder);
+	REQUIRE(model.data(model.index(0, ResultTableModel::RuleColumn)).toString() == "rule2");
+	model.sort(ResultTableModel::RuleColumn, Qt::AscendingOrder);
+	REQUIRE(model.Result(0) == 0);
+}
@@ -0,0 +1,127 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../SARIFServer.h"
+#include <QJsonArray>
+#include <QCoreApplication>
+
+TEST_CASE("Server counts and lists filtered results", "[server]") {
+	SARIFServer server(1024 * 1024 * 1024);
+
+	QJsonObject request;
+	request.insert("command", "count");
+	request.insert("file", "RuleIndexes.sarif");
+	auto reply = server.HandleRequest(request);
+	REQUIRE(reply["ok"].toBool());
+	REQUIRE(reply["count"].toInt() == 3);
+	REQUIRE(!reply["cached"].toBool());
+
+	QJsonObject filters;
+	QJsonObject ruleFilter;
+	ruleFilter.insert("rule", "rule1");
+	filters.insert("ruleFilters", QJsonArray{ ruleFilter });
+	request.insert("filters", filters);
+	request.insert("command", "list");
+	reply = server.HandleRequest(request);
+	REQUIRE(reply["ok"].toBool());
+	REQUIRE(reply["cached"].toBool());
+	auto results = reply["results"].toArray();
+	REQUIRE(results.size() == 2);
+	REQUIRE(results[0].toObject()["ruleId"].toString() == "rule2");
+}
+
+TEST_CASE("Server reports bad requests", "[server]") {
+	SARIFServer server(1024 * 1024);
+	QJsonObject request;
+	request.insert("command", "count");
+	request.insert("file", "Nonexistent.sarif");
+	REQUIRE(!server.HandleRequest(request)["ok"].toBool());
+	request.insert("command", "frobnicate");
+	request.insert("file", "RuleIndexes.sarif");
+	REQUIRE(!server.HandleRequest(request)["ok"].toBool());
+
+	QJsonObject filters;
+	QJsonObject fileFilter;
+	fileFilter.insert("regex", "[unclosed");
+	filters.insert("fileFilters", QJsonArray{ fileFilter });
+	request.insert("command", "count");
+	request.insert("filters", filters);
+	REQUIRE(!server.HandleRequest(request)["ok"].toBool());
+}
+
+TEST_CASE("Server does not export over its inputs", "[server]") {
+	SARIFServer server(1024 * 1024 * 1024);
+	const auto original = SARIF("RuleIndexes.sarif").ResultCount();
+
+	QJsonObject request;
+	request.insert("command", "export");
+	request.insert("file", "RuleIndexes.sarif");
+	request.insert("output", "./RuleIndexes.sarif");
+	REQUIRE(!server.HandleRequest(request)["ok"].toBool());
+	request.insert("baseline", "SeveralRules.sarif");
+	request.insert("output", "SeveralRules.sarif");
+	REQUIRE(!server.HandleRequest(request)["ok"].toBool());
+	REQUIRE(SARIF("RuleIndexes.sarif").ResultCount() == original);
+}
+
+TEST_CASE("Server does not take over the socket of a running server", "[server]") {
+	const QString name = QString::fromLatin1("cleansarif-test-%1").arg(QCoreApplication::applicationPid());
+	SARIFServer running(1024 * 1024);
+	REQUIRE(running.Listen(name));
+	SARIFServer second(1024 * 1024);
+	REQUIRE(!second.Listen(name));
+}
+
+TEST_CASE("Report cache evicts the least recently used report", "[server]") {
+	ReportCache cache(1024 * 1024 * 1024);
+	auto first = cache.Get("RuleIndexes.sarif");
+	auto second = cache.Get("SeveralRules.sarif");
+	REQUIRE(cache.Size() == 2);
+
+	// Touch the first report, then shrink the budget so only one fits
+	bool cached = false;
+	cache.Get("RuleIndexes.sarif", &cached);
+	REQUIRE(cached);
+	cache.SetMemoryBudget(first->MemoryFootprint());
+	REQUIRE(cache.Size() == 1);
+	cache.Get("RuleIndexes.sarif", &cached);
+	REQUIRE(cached);
+	cache.Get("SeveralRules.sarif", &cached);
+	REQUIRE(!cached);
+}
+
+TEST_CASE("Report cache keeps the fingerprints of a report with it", "[server]") {
+	ReportCache cache(1024 * 1024 * 1024);
+	auto report = cache.Get("Duplicates.sarif");
+	const size_t reportCost = cache.MemoryUsed();
+	auto fingerprints = cache.Fingerprints("Duplicates.sarif");
+	REQUIRE(fingerprints->Size() > 0);
+	REQUIRE(fingerprints->Contains(report->FingerprintOf(0)));
+	REQUIRE(cache.MemoryUsed() > reportCost);
+	REQUIRE(cache.Fingerprints("Duplicates.sarif") == fingerprints);
+
+	cache.Evict("Duplicates.sarif");
+	REQUIRE(cache.MemoryUsed() == 0);
+	REQUIRE(cache.Fingerprints("Duplicates.sarif") != fingerprints);
+}
@@ -0,0 +1,170 @@
+// MIT License
+//
+// Copyright(c) 2021 Chris Hennes <chennes@pioneerlibrarysystem.org>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "../SARIFStream.h"
+#include <QFile>
+#include <QBuffer>
+#include <QTemporaryFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+TEST_CASE("Streaming filter matches the loaded filter", "[stream]") {
+	SARIF::FilterProfile profile;
+	profile.suppressedRules.push_back("rule2");
+	profile.locationFilters.push_back("MainWindow");
+
+	QFile input("RuleIndexes.sarif");
+	REQUIRE(input.open(QIODevice::ReadOnly));
+	QBuffer output;
+	output.open(QIODevice::WriteOnly);
+	auto statistics = SARIFStreamFilter(profile).Filter(input, output);
+	output.close();
+	REQUIRE(statistics.resultsRead == 3);
+	REQUIRE(statistics.resultsWritten == 1);
+
+	// The output must be valid SARIF, with the same results as a normal export
+	output.open(QIODevice::ReadOnly);
+	SARIF streamed;
+	REQUIRE_NOTHROW(streamed.Load(output));
+	SARIF loaded("RuleIndexes.sarif");
+	REQUIRE(streamed.GetRules() == std::map<std::string, int>{ {"rule1", 1} });
+	REQUIRE(streamed.CountResults(SARIF::FilterProfile()) == loaded.CountResults(profile));
+	REQUIRE(streamed.Files().size() == 1);
+}
+
+TEST_CASE("Streaming filter applies the threshold", "[stream]") {
+	SARIF::FilterProfile profile;
+	profile.minimumLevel = SARIF::Level::Warning;
+	profile.minimumRank = 61;
+	REQUIRE(SARIFStreamFilter::CanStream(profile));
+
+	QFile input("Ranked.sarif");
+	REQUIRE(input.open(QIODevice::ReadOnly));
+	QBuffer output;
+	output.open(QIODevice::WriteOnly);
+	auto statistics = SARIFStreamFilter(profile).Filter(input, output);
+	REQUIRE(statistics.resultsRead == 5);
+	REQUIRE(statistics.resultsWritten == 2);
+}
+
+TEST_CASE("Streaming filter rejects what it cannot stream", "[stream]") {
+	SARIF::FilterProfile profile;
+	profile.pruneRules = true;
+	REQUIRE(!SARIFStreamFilter::CanStream(profile));
+	REQUIRE_THROWS(SARIFStreamFilter(profile));
+
+	SARIF::FilterProfile expressions;
+	expressions.expressionFilters.push_back("level == note");
+	REQUIRE(!SARIFStreamFilter::CanStream(expressions));
+
+	QBuffer notSARIF;
+	notSARIF.setData("{\"runs\": []}");
+	notSARIF.open(QIODevice::ReadOnly);
+	QBuffer output;
+	output.open(QIODevice::WriteOnly);
+	REQUIRE_THROWS(SARIFStreamFilter(SARIF::FilterProfile()).Filter(notSARIF, output));
+}
+
+TEST_CASE("Merging combines the runs of each tool and renumbers their rules", "[stream]") {
+	QBuffer output;
+	output.open(QIODevice::WriteOnly);
+	auto statistics = SARIFStreamFilter(SARIF::FilterProfile()).Merge({ "Ranked.sarif", "MergeRules.sarif", "SmallValidB.sarif" }, output);
+	output.close();
+	REQUIRE(statistics.resultsRead == 8);
+	REQUIRE(statistics.resultsWritten == 8);
+
+	auto runs = QJsonDocument::fromJson(output.data()).object()["runs"].toArray();
+	REQUIRE(runs.size() == 2);
+	auto run = runs[0].toObject();
+	REQUIRE(run["artifacts"].toArray().size() == 1);
+	REQUIRE(run["invocations"].toArray().size() == 1);
+	auto rules = run["tool"].toObject()["driver"].toObject()["rules"].toArray();
+	REQUIRE(rules.size() == 4);
+	REQUIRE(rules[3].toObject()["id"].toString() == "rule4");
+	auto results = run["results"].toArray();
+	REQUIRE(results.size() == 7);
+	REQUIRE(results[5].toObject()["ruleIndex"].toInt() == 3);
+	REQUIRE(results[6].toObject()["ruleIndex"].toInt() == 0);
+	REQUIRE(runs[1].toObject()["results"].toArray().size() == 1);
+
+	output.open(QIODevice::ReadOnly);
+	SARIF merged;
+	merged.Load(output);
+	REQUIRE(merged.ResultCount() == 8);
+}
+
+TEST_CASE("Merging combines the artifacts and invocations of each tool", "[stream]") {
+	QBuffer output;
+	output.open(QIODevice::WriteOnly);
+	SARIFStreamFilter(SARIF::FilterProfile()).Merge({ "MergeRules.sarif", "MergeArtifacts.sarif" }, output);
+	output.close();
+
+	auto runs = QJsonDocument::fromJson(output.data()).object()["runs"].toArray();
+	REQUIRE(runs.size() == 1);
+	auto run = runs[0].toObject();
+	auto artifacts = run["artifacts"].toArray();
+	REQUIRE(artifacts.size() == 2);
+	REQUIRE(artifacts[0].toObject()["location"].toObject()["uri"].toString().endsWith("TopoShape.cpp"));
+	REQUIRE(artifacts[1].toObject()["location"].toObject()["uri"].toString().endsWith("Feature.cpp"));
+	REQUIRE(run["invocations"].toArray().size() == 2);
+	REQUIRE(run["originalUriBaseIds"].toObject().keys() == QStringList{ "SRCROOT" });
+
+	auto results = run["results"].toArray();
+	REQUIRE(results.size() == 4);
+	for (const auto& result : results) {
+		auto location = result.toObject()["locations"].toArray()[0].toObject()["physicalLocation"].toObject()["artifactLocation"].toObject();
+		auto artifact = artifacts[location["index"].toInt()].toObject()["location"].toObject();
+		REQUIRE(artifact["uri"].toString() == location["uri"].toString());
+	}
+
+	QFile original("MergeArtifacts.sarif");
+	REQUIRE(original.open(QIODevice::ReadOnly));
+	auto conflicting = original.readAll().replace("file:///home/jdoe/repo/", "file:///home/jdoe/other/");
+	QTemporaryFile conflictingFile;
+	REQUIRE(conflictingFile.open());
+	conflictingFile.write(conflicting);
+	conflictingFile.close();
+	QBuffer failed;
+	failed.open(QIODevice::WriteOnly);
+	REQUIRE_THROWS(SARIFStreamFilter(SARIF::FilterProfile()).Merge({ "MergeRules.sarif", conflictingFile.fileName().toStdString() }, failed));
+}
+
+TEST_CASE("Merging can remove duplicates across the inputs", "[stream]") {
+	SARIF::FilterProfile profile;
+	profile.deduplicate = true;
+	QBuffer output;
+	output.open(QIODevice::WriteOnly);
+	auto statistics = SARIFStreamFilter(profile).Merge({ "Ranked.sarif", "Duplicates.sarif" }, output);
+	REQUIRE(statistics.resultsRead == 13);
+	REQUIRE(statistics.resultsWritten == 9);
+	REQUIRE(statistics.duplicates["rule1"] == 2);
+	REQUIRE(statistics.duplicates["rule2"] == 1);
+	REQUIRE(statistics.duplicates["rule3"] == 1);
+
+	QBuffer failed;
+	failed.open(QIODevice::WriteOnly);
+	REQUIRE_THROWS(SARIFStreamFilter(profile).Merge({ "Ranked.sarif", "NotSARIF.sarif" }, failed));
+	REQUIRE_THROWS(SARIFStreamFilter(profile).Merge({ "DoesNotExist.sarif" }, failed));
+}